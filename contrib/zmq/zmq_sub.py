@@ -23,6 +23,7 @@ zmqSubSocket.setsockopt(zmq.SUBSCRIBE, b"rawtxlock")
 zmqSubSocket.setsockopt(zmq.SUBSCRIBE, b"rawgovernancevote")
 zmqSubSocket.setsockopt(zmq.SUBSCRIBE, b"rawgovernanceobject")
 zmqSubSocket.setsockopt(zmq.SUBSCRIBE, b"rawinstantsenddoublespend")
+zmqSubSocket.setsockopt(zmq.SUBSCRIBE, b"txlocklatency")
 zmqSubSocket.connect("tcp://127.0.0.1:%i" % port)
 
 try:
@@ -72,6 +73,9 @@ try:
         elif topic == "hashinstantsenddoublespend":
             print('- HASH IS DOUBLE SPEND ('+sequence+') -')
             print(binascii.hexlify(body).decode("utf-8"))
+        elif topic == "txlocklatency":
+            print('- TX LOCK LATENCY ('+sequence+') -')
+            print(binascii.hexlify(body[:32]).decode("utf-8") + ' ' + str(struct.unpack('<q', body[32:40])[0]) + ' ms')
 
 except KeyboardInterrupt:
     zmqContext.destroy()
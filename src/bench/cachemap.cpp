@@ -0,0 +1,109 @@
+// Copyright (c) 2014-2018 The Polis Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "cachemap.h"
+#include "cachemultimap.h"
+#include "random.h"
+
+static const uint32_t CACHE_SIZE = 100000;
+
+static std::vector<uint256> CreateKeys(size_t nCount)
+{
+    std::vector<uint256> vecKeys(nCount);
+    for (auto& key : vecKeys) {
+        key = GetRandHash();
+    }
+    return vecKeys;
+}
+
+// Fills an empty cache, every iteration starts over with a fresh one
+static void CacheMapInsert(benchmark::State& state)
+{
+    std::vector<uint256> vecKeys = CreateKeys(CACHE_SIZE);
+    while (state.KeepRunning()) {
+        CacheMap<uint256, int> cmap(CACHE_SIZE);
+        for (size_t i = 0; i < vecKeys.size(); i++) {
+            cmap.Insert(vecKeys[i], i);
+        }
+    }
+}
+
+// Looks up existing and missing keys in a full cache
+static void CacheMapLookup(benchmark::State& state)
+{
+    std::vector<uint256> vecKeys = CreateKeys(CACHE_SIZE);
+    std::vector<uint256> vecMissing = CreateKeys(CACHE_SIZE);
+    CacheMap<uint256, int> cmap(CACHE_SIZE);
+    for (size_t i = 0; i < vecKeys.size(); i++) {
+        cmap.Insert(vecKeys[i], i);
+    }
+
+    int nFound = 0;
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < vecKeys.size(); i++) {
+            nFound += cmap.HasKey(vecKeys[i]);
+            nFound += cmap.HasKey(vecMissing[i]);
+        }
+    }
+    assert(nFound != 0);
+}
+
+// Keeps inserting into a full cache, so that every insert evicts the oldest item
+static void CacheMapEvict(benchmark::State& state)
+{
+    std::vector<uint256> vecKeys = CreateKeys(CACHE_SIZE * 2);
+    CacheMap<uint256, int> cmap(CACHE_SIZE);
+    for (size_t i = 0; i < CACHE_SIZE; i++) {
+        cmap.Insert(vecKeys[i], i);
+    }
+
+    size_t nPos = CACHE_SIZE;
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < CACHE_SIZE; i++) {
+            // the key at nPos was evicted CACHE_SIZE inserts ago
+            cmap.Insert(vecKeys[nPos], i);
+            nPos = (nPos + 1) % vecKeys.size();
+        }
+    }
+}
+
+// Same as CacheMapEvict, with several values per key like orphan votes for the same object
+static void CacheMultiMapEvict(benchmark::State& state)
+{
+    std::vector<uint256> vecKeys = CreateKeys(CACHE_SIZE / 10);
+    CacheMultiMap<uint256, int> cmmap(CACHE_SIZE);
+
+    int nValue = 0;
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < CACHE_SIZE; i++) {
+            cmmap.Insert(vecKeys[i % vecKeys.size()], nValue++);
+        }
+    }
+}
+
+// Thousands of orphan votes for one object, erased one by one like CheckOrphanVotes does once the votes are processed
+static void CacheMultiMapOneKey(benchmark::State& state)
+{
+    const int nValues = 10000;
+    const uint256 key = GetRandHash();
+    while (state.KeepRunning()) {
+        CacheMultiMap<uint256, int> cmmap(CACHE_SIZE);
+        for (int i = 0; i < nValues; i++) {
+            cmmap.Insert(key, i);
+        }
+        std::vector<int> vecValues;
+        cmmap.GetAll(key, vecValues);
+        for (int nValue : vecValues) {
+            cmmap.Erase(key, nValue);
+        }
+        assert(!cmmap.HasKey(key));
+    }
+}
+
+BENCHMARK(CacheMapInsert);
+BENCHMARK(CacheMapLookup);
+BENCHMARK(CacheMapEvict);
+BENCHMARK(CacheMultiMapEvict);
+BENCHMARK(CacheMultiMapOneKey);
@@ -5,8 +5,10 @@
 #include "bench.h"
 #include "coins.h"
 #include "policy/policy.h"
+#include "random.h"
 #include "wallet/crypter.h"
 
+#include <unordered_map>
 #include <vector>
 
 // FIXME: Dedup with SetupDummyInputs in test/transaction_tests.cpp.
@@ -84,4 +86,94 @@ static void CCoinsCaching(benchmark::State& state)
     }
 }
 
+// The node based map CCoinsMap used to be, to compare with
+typedef std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher> CCoinsNodeMap;
+
+// Cache entries for a block's worth of new P2PKH outputs
+static const size_t CACHE_ENTRIES = 100000;
+
+static std::vector<COutPoint> CreateOutpoints()
+{
+    std::vector<COutPoint> vOutpoints;
+    for (size_t i = 0; i < CACHE_ENTRIES; i++) {
+        vOutpoints.emplace_back(GetRandHash(), i % 2);
+    }
+    return vOutpoints;
+}
+
+template <typename Map>
+static void FillCoinsMap(Map& map, const std::vector<COutPoint>& vOutpoints)
+{
+    CScript script = CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, 1) << OP_EQUALVERIFY << OP_CHECKSIG;
+    for (const COutPoint& outpoint : vOutpoints) {
+        Coin coin(CTxOut(COIN, script), 1, false, false);
+        auto inserted = map.emplace(std::piecewise_construct, std::forward_as_tuple(outpoint), std::forward_as_tuple(std::move(coin)));
+        inserted.first->second.flags = CCoinsCacheEntry::DIRTY | CCoinsCacheEntry::FRESH;
+    }
+}
+
+// Adding the coins of a block to an empty cache, like AddCoin does
+template <typename Map>
+static void CoinsMapInsert(benchmark::State& state)
+{
+    std::vector<COutPoint> vOutpoints = CreateOutpoints();
+    while (state.KeepRunning()) {
+        Map map;
+        FillCoinsMap(map, vOutpoints);
+    }
+}
+
+// Looking up cached coins in a different order than they were added, half of the lookups miss
+template <typename Map>
+static void CoinsMapLookup(benchmark::State& state)
+{
+    std::vector<COutPoint> vOutpoints = CreateOutpoints();
+    Map map;
+    FillCoinsMap(map, vOutpoints);
+    for (size_t i = 0; i < CACHE_ENTRIES; i += 2) {
+        vOutpoints[i].hash = GetRandHash();
+    }
+    std::random_shuffle(vOutpoints.begin(), vOutpoints.end(), GetRandInt);
+
+    while (state.KeepRunning()) {
+        size_t nFound = 0;
+        for (const COutPoint& outpoint : vOutpoints) {
+            nFound += map.count(outpoint);
+        }
+        assert(nFound == CACHE_ENTRIES / 2);
+    }
+}
+
+// Walking and emptying the cache like BatchWrite does when the cache is flushed
+template <typename Map>
+static void CoinsMapFlush(benchmark::State& state)
+{
+    std::vector<COutPoint> vOutpoints = CreateOutpoints();
+    while (state.KeepRunning()) {
+        Map map;
+        FillCoinsMap(map, vOutpoints);
+        CAmount nValue = 0;
+        for (auto it = map.begin(); it != map.end();) {
+            if (it->second.flags & CCoinsCacheEntry::DIRTY)
+                nValue += it->second.coin.out.nValue;
+            auto itOld = it++;
+            map.erase(itOld);
+        }
+        assert(nValue == (CAmount)CACHE_ENTRIES * COIN);
+    }
+}
+
+static void CoinsMapInsertFlat(benchmark::State& state) { CoinsMapInsert<CCoinsMap>(state); }
+static void CoinsMapInsertNode(benchmark::State& state) { CoinsMapInsert<CCoinsNodeMap>(state); }
+static void CoinsMapLookupFlat(benchmark::State& state) { CoinsMapLookup<CCoinsMap>(state); }
+static void CoinsMapLookupNode(benchmark::State& state) { CoinsMapLookup<CCoinsNodeMap>(state); }
+static void CoinsMapFlushFlat(benchmark::State& state) { CoinsMapFlush<CCoinsMap>(state); }
+static void CoinsMapFlushNode(benchmark::State& state) { CoinsMapFlush<CCoinsNodeMap>(state); }
+
 BENCHMARK(CCoinsCaching);
+BENCHMARK(CoinsMapInsertFlat);
+BENCHMARK(CoinsMapInsertNode);
+BENCHMARK(CoinsMapLookupFlat);
+BENCHMARK(CoinsMapLookupNode);
+BENCHMARK(CoinsMapFlushFlat);
+BENCHMARK(CoinsMapFlushNode);
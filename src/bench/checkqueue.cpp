@@ -6,6 +6,7 @@
 #include "util.h"
 #include "validation.h"
 #include "checkqueue.h"
+#include "crypto/sha256.h"
 #include "prevector.h"
 #include <vector>
 #include <boost/thread/thread.hpp>
@@ -99,5 +100,54 @@ static void CCheckQueueSpeedPrevectorJob(benchmark::State& state)
     tg.interrupt_all();
     tg.join_all();
 }
+
+// This Benchmark shows how the CheckQueue scales with the number of threads
+// (including the master, like -par) for checks that take a few microseconds,
+// about as long as a fast script verification.
+static void CCheckQueueScaling(benchmark::State& state, int nThreads)
+{
+    struct HashingJob {
+        uint256 hash;
+        bool operator()()
+        {
+            for (int i = 0; i < 16; i++)
+                CSHA256().Write(hash.begin(), hash.size()).Finalize(hash.begin());
+            return true;
+        }
+        void swap(HashingJob& x){std::swap(hash, x.hash);};
+    };
+    CCheckQueue<HashingJob> queue {QUEUE_BATCH_SIZE};
+    boost::thread_group tg;
+    for (auto x = 0; x < nThreads - 1; ++x) {
+       tg.create_thread([&]{queue.Thread();});
+    }
+    while (state.KeepRunning()) {
+        CCheckQueueControl<HashingJob> control(&queue);
+        std::vector<std::vector<HashingJob>> vBatches(BATCHES);
+        for (auto& vChecks : vBatches) {
+            vChecks.resize(BATCH_SIZE);
+            control.Add(vChecks);
+        }
+        control.Wait();
+    }
+    tg.interrupt_all();
+    tg.join_all();
+}
+
+static void CCheckQueueScaling1(benchmark::State& state) { CCheckQueueScaling(state, 1); }
+static void CCheckQueueScaling2(benchmark::State& state) { CCheckQueueScaling(state, 2); }
+static void CCheckQueueScaling4(benchmark::State& state) { CCheckQueueScaling(state, 4); }
+static void CCheckQueueScaling8(benchmark::State& state) { CCheckQueueScaling(state, 8); }
+static void CCheckQueueScaling16(benchmark::State& state) { CCheckQueueScaling(state, 16); }
+static void CCheckQueueScaling32(benchmark::State& state) { CCheckQueueScaling(state, 32); }
+static void CCheckQueueScaling64(benchmark::State& state) { CCheckQueueScaling(state, 64); }
+
 BENCHMARK(CCheckQueueSpeed);
 BENCHMARK(CCheckQueueSpeedPrevectorJob);
+BENCHMARK(CCheckQueueScaling1);
+BENCHMARK(CCheckQueueScaling2);
+BENCHMARK(CCheckQueueScaling4);
+BENCHMARK(CCheckQueueScaling8);
+BENCHMARK(CCheckQueueScaling16);
+BENCHMARK(CCheckQueueScaling32);
+BENCHMARK(CCheckQueueScaling64);
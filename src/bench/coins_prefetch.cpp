@@ -0,0 +1,109 @@
+// Copyright (c) 2014-2018 The Polis Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "coins.h"
+#include "ctpl.h"
+#include "random.h"
+#include "txdb.h"
+#include "util.h"
+#include "validation.h"
+
+#include <boost/filesystem.hpp>
+
+// Coins in the database, and transactions with two inputs and two outputs per block
+static const size_t DB_COINS = 200000;
+static const size_t BLOCK_TXES = 1000;
+
+static CScript RandomScript()
+{
+    uint160 hash;
+    GetRandBytes(hash.begin(), hash.size());
+    return CScript() << OP_DUP << OP_HASH160 << ToByteVector(hash) << OP_EQUALVERIFY << OP_CHECKSIG;
+}
+
+// An on-disk coins database in a temporary data directory, and a block spending some of its coins
+class CoinsPrefetchSetup
+{
+public:
+    boost::filesystem::path pathTemp;
+    std::unique_ptr<CCoinsViewDB> db;
+    std::vector<CTransaction> vtx;
+    std::vector<COutPoint> vSpent;
+
+    CoinsPrefetchSetup()
+    {
+        ClearDatadirCache();
+        pathTemp = boost::filesystem::temp_directory_path() / strprintf("bench_polis_%lu_%i", (unsigned long)GetTime(), (int)GetRand(100000));
+        boost::filesystem::create_directories(pathTemp);
+        ForceSetArg("-datadir", pathTemp.string());
+
+        // a small LevelDB cache, so that most reads miss it like on a node with a large UTXO set
+        db.reset(new CCoinsViewDB(1 << 20, false, true));
+        std::vector<COutPoint> vCoins;
+        {
+            CCoinsViewCache cache(db.get());
+            for (size_t i = 0; i < DB_COINS; i++) {
+                vCoins.emplace_back(GetRandHash(), i % 4);
+                cache.AddCoin(vCoins.back(), Coin(CTxOut(COIN, RandomScript()), 1, false, false), false);
+            }
+            cache.SetBestBlock(GetRandHash());
+            cache.Flush();
+        }
+
+        std::random_shuffle(vCoins.begin(), vCoins.end(), GetRandInt);
+        for (size_t i = 0; i < BLOCK_TXES; i++) {
+            CMutableTransaction tx;
+            tx.vin.resize(2);
+            tx.vin[0].prevout = vCoins[2 * i];
+            tx.vin[1].prevout = vCoins[2 * i + 1];
+            tx.vout.assign(2, CTxOut(COIN, RandomScript()));
+            vtx.emplace_back(tx);
+            vSpent.push_back(tx.vin[0].prevout);
+            vSpent.push_back(tx.vin[1].prevout);
+        }
+    }
+
+    ~CoinsPrefetchSetup()
+    {
+        db.reset();
+        boost::filesystem::remove_all(pathTemp);
+        ClearDatadirCache();
+    }
+};
+
+// What ConnectBlock does with the coins of every transaction
+static void ConnectTxes(CCoinsViewCache& viewTip, const std::vector<CTransaction>& vtx)
+{
+    CCoinsViewCache view(&viewTip);
+    for (const CTransaction& tx : vtx) {
+        assert(view.HaveInputs(tx));
+        UpdateCoins(tx, view, 2);
+    }
+}
+
+// Every coin is read from the database when ConnectBlock first accesses it
+static void CoinsConnectBlockSerial(benchmark::State& state)
+{
+    CoinsPrefetchSetup setup;
+    while (state.KeepRunning()) {
+        CCoinsViewCache viewTip(setup.db.get());
+        ConnectTxes(viewTip, setup.vtx);
+    }
+}
+
+// The spent coins are read ahead in key order on a few threads, like ConnectTip does
+static void CoinsConnectBlockPrefetch(benchmark::State& state)
+{
+    CoinsPrefetchSetup setup;
+    ctpl::thread_pool pool(std::max(1, std::min(GetNumCores(), MAX_COINS_PREFETCH_THREADS)));
+    while (state.KeepRunning()) {
+        CCoinsViewCache viewTip(setup.db.get());
+        viewTip.PrefetchCoins(setup.vSpent, &pool);
+        ConnectTxes(viewTip, setup.vtx);
+    }
+}
+
+BENCHMARK(CoinsConnectBlockSerial);
+BENCHMARK(CoinsConnectBlockPrefetch);
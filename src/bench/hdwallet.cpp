@@ -0,0 +1,59 @@
+// Copyright (c) 2014-2018 The Polis Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "chainparams.h"
+#include "random.h"
+#include "wallet/wallet.h"
+
+// Keys derived per iteration, keys/second is KEYS_PER_ITERATION divided by the average iteration time
+static const size_t KEYS_PER_ITERATION = 1000;
+
+static void SetupHDWallet(CWallet& wallet)
+{
+    SelectParams(CBaseChainParams::MAIN);
+
+    std::vector<unsigned char> vchSeed(32);
+    GetStrongRandBytes(vchSeed.data(), vchSeed.size());
+    CHDChain hdChain;
+    hdChain.SetSeed(SecureVector(vchSeed.begin(), vchSeed.end()), true);
+
+    LOCK(wallet.cs_wallet);
+    wallet.SetHDChain(hdChain, true);
+}
+
+// One key per call, like GenerateNewKey does, so every key pays for deriving the change key from the seed
+static void HDDeriveKeysSingle(benchmark::State& state)
+{
+    CWallet wallet;
+    SetupHDWallet(wallet);
+    CKeyMetadata metadata(GetTime());
+
+    LOCK(wallet.cs_wallet);
+    while (state.KeepRunning()) {
+        std::vector<CPubKey> vecPubKeys;
+        for (size_t i = 0; i < KEYS_PER_ITERATION; i++) {
+            wallet.DeriveNewChildKeys(metadata, 0, false, 1, vecPubKeys);
+        }
+        assert(vecPubKeys.size() == KEYS_PER_ITERATION);
+    }
+}
+
+// One batch per iteration, like TopUpKeyPool does, children are derived in parallel
+static void HDDeriveKeysBatch(benchmark::State& state)
+{
+    CWallet wallet;
+    SetupHDWallet(wallet);
+    CKeyMetadata metadata(GetTime());
+
+    LOCK(wallet.cs_wallet);
+    while (state.KeepRunning()) {
+        std::vector<CPubKey> vecPubKeys;
+        wallet.DeriveNewChildKeys(metadata, 0, false, KEYS_PER_ITERATION, vecPubKeys);
+        assert(vecPubKeys.size() == KEYS_PER_ITERATION);
+    }
+}
+
+BENCHMARK(HDDeriveKeysSingle);
+BENCHMARK(HDDeriveKeysBatch);
@@ -0,0 +1,75 @@
+// Copyright (c) 2014-2018 The Polis Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "instantx.h"
+#include "random.h"
+
+static const int LOCK_REQUESTS = 1000;
+static const int INPUTS_PER_REQUEST = 4;
+
+static CMutableTransaction CreateLockRequestTx()
+{
+    CMutableTransaction tx;
+    tx.vin.resize(INPUTS_PER_REQUEST);
+    for (auto& txin : tx.vin) {
+        txin.prevout = COutPoint(GetRandHash(), 0);
+    }
+    tx.vout.resize(1);
+    tx.vout[0].nValue = COIN;
+    return tx;
+}
+
+// Replays a burst of lock requests, each of them followed by the votes of all quorum members for all of its inputs,
+// against the same kind of tables CInstantSend keeps its lock state in
+static void InstantSendLockBurst(benchmark::State& state)
+{
+    std::vector<CTxLockRequest> vecRequests;
+    for (int i = 0; i < LOCK_REQUESTS; i++) {
+        vecRequests.emplace_back(CreateLockRequestTx());
+    }
+    std::vector<COutPoint> vecMasternodes;
+    for (int i = 0; i < COutPointLock::SIGNATURES_TOTAL; i++) {
+        vecMasternodes.emplace_back(GetRandHash(), 0);
+    }
+    std::vector<CTxLockVote> vecVotes;
+    for (const auto& txLockRequest : vecRequests) {
+        for (const auto& txin : txLockRequest.tx->vin) {
+            for (const auto& outpointMasternode : vecMasternodes) {
+                vecVotes.emplace_back(txLockRequest.GetHash(), txin.prevout, outpointMasternode, uint256(), uint256());
+            }
+        }
+    }
+
+    while (state.KeepRunning()) {
+        std::unordered_map<uint256, CTxLockCandidate, SaltedTxidHasher> mapTxLockCandidates;
+        std::unordered_map<COutPoint, std::set<uint256>, SaltedOutpointHasher> mapVotedOutpoints;
+        std::unordered_map<COutPoint, uint256, SaltedOutpointHasher> mapLockedOutpoints;
+
+        for (const auto& txLockRequest : vecRequests) {
+            CTxLockCandidate txLockCandidate(txLockRequest);
+            for (const auto& txin : txLockRequest.tx->vin) {
+                txLockCandidate.AddOutPointLock(txin.prevout);
+            }
+            mapTxLockCandidates.emplace(txLockRequest.GetHash(), txLockCandidate);
+        }
+
+        for (const auto& vote : vecVotes) {
+            auto it = mapTxLockCandidates.find(vote.GetTxHash());
+            assert(it != mapTxLockCandidates.end());
+            CTxLockCandidate& txLockCandidate = it->second;
+            if (txLockCandidate.HasMasternodeVoted(vote.GetOutpoint(), vote.GetMasternodeOutpoint())) continue;
+            txLockCandidate.AddVote(vote);
+            mapVotedOutpoints[vote.GetOutpoint()].insert(vote.GetTxHash());
+            if (txLockCandidate.IsAllOutPointsReady()) {
+                for (const auto& pair : txLockCandidate.mapOutPointLocks) {
+                    mapLockedOutpoints.emplace(pair.first, vote.GetTxHash());
+                }
+            }
+        }
+        assert(mapLockedOutpoints.size() == (size_t)LOCK_REQUESTS * INPUTS_PER_REQUEST);
+    }
+}
+
+BENCHMARK(InstantSendLockBurst);
@@ -0,0 +1,169 @@
+// Copyright (c) 2014-2018 The Polis Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "arith_uint256.h"
+#include "chainparams.h"
+#include "clientversion.h"
+#include "kernel.h"
+#include "random.h"
+#include "util.h"
+#include "validation.h"
+
+#include <boost/filesystem.hpp>
+
+#include <limits>
+
+// Proof-of-stake blocks checked per run, each of them stakes a coin of its own block
+static const size_t STAKE_BLOCKS = 200;
+// Blocks after the staked coins, the stake modifiers are taken from up to a selection interval later
+static const size_t MODIFIER_BLOCKS = 100;
+static const CAmount STAKE_VALUE = 1000 * COIN;
+
+// A chain of blocks with staked coins on disk and in the UTXO set, and blocks staking each of them
+class PosAssumeValidSetup
+{
+public:
+    boost::filesystem::path pathTemp;
+    std::vector<CBlockIndex> vIndex;
+    std::vector<CBlock> vStakeBlocks;
+    BlockMap mapBlockIndexOld;
+    CChain chainActiveOld;
+    CCoinsViewCache* pcoinsTipOld;
+    CCoinsView viewDummy;
+
+    PosAssumeValidSetup()
+    {
+        SelectParams(CBaseChainParams::MAIN);
+        const Consensus::Params& consensusParams = Params().GetConsensus();
+        ClearDatadirCache();
+        pathTemp = boost::filesystem::temp_directory_path() / strprintf("bench_polis_%lu_%i", (unsigned long)GetTime(), (int)GetRand(100000));
+        boost::filesystem::create_directories(pathTemp);
+        ForceSetArg("-datadir", pathTemp.string());
+
+        mapBlockIndexOld.swap(mapBlockIndex);
+        chainActiveOld.SetTip(chainActive.Tip());
+        chainActive.SetTip(NULL);
+        pcoinsTipOld = pcoinsTip;
+        pcoinsTip = new CCoinsViewCache(&viewDummy);
+
+        uint160 keyID;
+        GetRandBytes(keyID.begin(), keyID.size());
+        const CScript scriptStake = CScript() << OP_DUP << OP_HASH160 << ToByteVector(keyID) << OP_EQUALVERIFY << OP_CHECKSIG;
+
+        // every block on disk has a coinbase and a coinstake, whose second output is staked later on,
+        // all of them after the stake protocol and minimum stake value changes
+        const unsigned int nTimeStart = consensusParams.nPosMitigationSwitchTime + 60;
+        const size_t nBlocks = STAKE_BLOCKS + MODIFIER_BLOCKS;
+        vIndex.resize(nBlocks);
+        std::vector<CBlock> vBlocks(STAKE_BLOCKS);
+        unsigned int nOffset = 0;
+        for (size_t i = 0; i < nBlocks; i++) {
+            CBlockIndex& index = vIndex[i];
+            index.nHeight = i;
+            index.nTime = nTimeStart + 60 * i;
+            index.pprev = i ? &vIndex[i - 1] : NULL;
+            index.SetStakeModifier(GetRand(std::numeric_limits<uint64_t>::max()), true);
+            uint256 hash = GetRandHash();
+            if (i < STAKE_BLOCKS) {
+                CMutableTransaction txCoinBase;
+                txCoinBase.vin.resize(1);
+                txCoinBase.vin[0].prevout.SetNull();
+                txCoinBase.vin[0].scriptSig = CScript() << (int)i << OP_0;
+                txCoinBase.vout.resize(1);
+                txCoinBase.vout[0].SetEmpty();
+                CMutableTransaction txCoinStake;
+                txCoinStake.vin.resize(1);
+                txCoinStake.vin[0].prevout = COutPoint(GetRandHash(), 1);
+                txCoinStake.vout.resize(2);
+                txCoinStake.vout[0].SetEmpty();
+                txCoinStake.vout[1] = CTxOut(STAKE_VALUE, scriptStake);
+
+                CBlock& block = vBlocks[i];
+                block.nTime = index.nTime;
+                block.vtx.push_back(MakeTransactionRef(std::move(txCoinBase)));
+                block.vtx.push_back(MakeTransactionRef(std::move(txCoinStake)));
+                CDiskBlockPos pos(0, nOffset);
+                assert(WriteBlockToDisk(block, pos, Params().MessageStart()));
+                nOffset = pos.nPos + ::GetSerializeSize(block, SER_DISK, CLIENT_VERSION);
+                index.nFile = pos.nFile;
+                index.nDataPos = pos.nPos;
+                index.nStatus |= BLOCK_HAVE_DATA;
+                hash = block.GetHash();
+                pcoinsTip->AddCoin(COutPoint(block.vtx[1]->GetHash(), 1), Coin(block.vtx[1]->vout[1], i, false, true), false);
+            }
+            index.phashBlock = &mapBlockIndex.emplace(hash, &index).first->first;
+            index.BuildSkip();
+        }
+        chainActive.SetTip(&vIndex.back());
+
+        // one day after the last block, with a target the kernel of the coin's weight just meets
+        const unsigned int nTimeStake = vIndex.back().nTime + 60 * 60 * 24;
+        for (size_t i = 0; i < STAKE_BLOCKS; i++) {
+            CMutableTransaction txCoinBase;
+            txCoinBase.vin.resize(1);
+            txCoinBase.vin[0].prevout.SetNull();
+            txCoinBase.vout.resize(1);
+            txCoinBase.vout[0].SetEmpty();
+            CMutableTransaction txCoinStake;
+            txCoinStake.vin.resize(1);
+            txCoinStake.vin[0].prevout = COutPoint(vBlocks[i].vtx[1]->GetHash(), 1);
+            txCoinStake.vout.resize(2);
+            txCoinStake.vout[0].SetEmpty();
+            txCoinStake.vout[1] = CTxOut(STAKE_VALUE + COIN, scriptStake);
+
+            CBlock block;
+            block.vtx.push_back(MakeTransactionRef(std::move(txCoinBase)));
+            block.vtx.push_back(MakeTransactionRef(std::move(txCoinStake)));
+            uint256 hashProofOfStake;
+            for (block.nTime = nTimeStake + i; ; block.nTime++) {
+                int64_t nTimeWeight = std::min<int64_t>(block.nTime - vIndex[i].nTime, consensusParams.nStakeMaxAge - CurrentMinStakeAge(block.nTime));
+                arith_uint256 bnCoinDayWeight = STAKE_VALUE * nTimeWeight / COIN / 200;
+                arith_uint256 bnTargetPerCoinDay = ~arith_uint256();
+                bnTargetPerCoinDay /= bnCoinDayWeight;
+                block.nBits = bnTargetPerCoinDay.GetCompact();
+                if (CheckProofOfStake(block, hashProofOfStake))
+                    break;
+            }
+            vStakeBlocks.push_back(block);
+        }
+    }
+
+    ~PosAssumeValidSetup()
+    {
+        delete pcoinsTip;
+        pcoinsTip = pcoinsTipOld;
+        chainActive.SetTip(chainActiveOld.Tip());
+        mapBlockIndex.swap(mapBlockIndexOld);
+        boost::filesystem::remove_all(pathTemp);
+        ClearDatadirCache();
+    }
+};
+
+// The kernel of every block is checked against its target, which reads the block of the staked coin twice
+static void PosCheckKernelFull(benchmark::State& state)
+{
+    PosAssumeValidSetup setup;
+    while (state.KeepRunning()) {
+        for (const CBlock& block : setup.vStakeBlocks) {
+            uint256 hashProofOfStake;
+            assert(CheckProofOfStake(block, hashProofOfStake));
+        }
+    }
+}
+
+// Below the assumed valid block only the kernel hash is computed, from the UTXO set and the block index
+static void PosCheckKernelAssumeValid(benchmark::State& state)
+{
+    PosAssumeValidSetup setup;
+    while (state.KeepRunning()) {
+        for (const CBlock& block : setup.vStakeBlocks) {
+            uint256 hashProofOfStake;
+            assert(CheckProofOfStake(block, hashProofOfStake, true));
+        }
+    }
+}
+
+BENCHMARK(PosCheckKernelFull);
+BENCHMARK(PosCheckKernelAssumeValid);
@@ -0,0 +1,107 @@
+// Copyright (c) 2014-2018 The Polis Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "privatesend.h"
+#include "privatesend-client.h"
+#include "random.h"
+#include "wallet/wallet.h"
+
+#include <algorithm>
+
+// Our mixed coins, each of them went through MAX_PRIVATESEND_ROUNDS mixing transactions
+static const size_t MIXED_COINS = 1000;
+// Our inputs per mixing transaction, every one of them also has twice as many inputs and outputs of others
+static const size_t COINS_PER_MIX = 10;
+
+static CScript RandomScript()
+{
+    uint160 hash;
+    GetRandBytes(hash.begin(), hash.size());
+    return CScript() << OP_DUP << OP_HASH160 << ToByteVector(hash) << OP_EQUALVERIFY << OP_CHECKSIG;
+}
+
+static COutPoint AddTx(CWallet& wallet, CMutableTransaction& tx)
+{
+    CWalletTx wtx(&wallet, MakeTransactionRef(std::move(tx)));
+    wallet.LoadToWallet(wtx);
+    return COutPoint(wtx.GetHash(), 0);
+}
+
+// Denominates MIXED_COINS coins and mixes them MAX_PRIVATESEND_ROUNDS times, returns the mixed outputs
+static std::vector<COutPoint> CreateMixedWallet(CWallet& wallet)
+{
+    CPrivateSend::InitStandardDenominations();
+    const CAmount nDenom = CPrivateSend::GetStandardDenominations()[1];
+
+    CKey key;
+    key.MakeNewKey(true);
+    LOCK(wallet.cs_wallet);
+    wallet.AddKeyPubKey(key, key.GetPubKey());
+    const CScript scriptOurs = GetScriptForDestination(key.GetPubKey().GetID());
+
+    CMutableTransaction txDenominate;
+    txDenominate.vin.resize(1);
+    txDenominate.vin[0].prevout = COutPoint(GetRandHash(), 0);
+    txDenominate.vout.assign(MIXED_COINS, CTxOut(nDenom, scriptOurs));
+    COutPoint outpointDenominate = AddTx(wallet, txDenominate);
+
+    std::vector<COutPoint> vecCoins;
+    for (size_t i = 0; i < MIXED_COINS; i++) {
+        vecCoins.emplace_back(outpointDenominate.hash, i);
+    }
+
+    for (int nRound = 0; nRound < MAX_PRIVATESEND_ROUNDS; nRound++) {
+        // coins meet different coins in every round
+        std::random_shuffle(vecCoins.begin(), vecCoins.end(), GetRandInt);
+        std::vector<COutPoint> vecMixed;
+        for (size_t i = 0; i < vecCoins.size(); i += COINS_PER_MIX) {
+            CMutableTransaction txMix;
+            for (size_t j = i; j < i + COINS_PER_MIX; j++) {
+                txMix.vin.emplace_back(vecCoins[j]);
+                txMix.vin.emplace_back(COutPoint(GetRandHash(), 0));
+                txMix.vin.emplace_back(COutPoint(GetRandHash(), 0));
+                txMix.vout.emplace_back(nDenom, scriptOurs);
+                txMix.vout.emplace_back(nDenom, RandomScript());
+                txMix.vout.emplace_back(nDenom, RandomScript());
+            }
+            COutPoint outpointMix = AddTx(wallet, txMix);
+            for (size_t n = 0; n < COINS_PER_MIX * 3; n += 3) {
+                vecMixed.emplace_back(outpointMix.hash, n);
+            }
+        }
+        vecCoins.swap(vecMixed);
+    }
+    return vecCoins;
+}
+
+// Rounds of all mixed coins with nothing cached, the whole mixing history is walked once
+static void PrivateSendRoundsCold(benchmark::State& state)
+{
+    CWallet wallet;
+    std::vector<COutPoint> vecCoins = CreateMixedWallet(wallet);
+
+    while (state.KeepRunning()) {
+        wallet.ClearPrivateSendRounds();
+        for (const COutPoint& outpoint : vecCoins) {
+            assert(wallet.GetRealOutpointPrivateSendRounds(outpoint) == MAX_PRIVATESEND_ROUNDS);
+        }
+    }
+}
+
+// Rounds of all mixed coins once they are cached, like repeated balance and coin control updates
+static void PrivateSendRoundsCached(benchmark::State& state)
+{
+    CWallet wallet;
+    std::vector<COutPoint> vecCoins = CreateMixedWallet(wallet);
+
+    while (state.KeepRunning()) {
+        for (const COutPoint& outpoint : vecCoins) {
+            assert(wallet.GetRealOutpointPrivateSendRounds(outpoint) == MAX_PRIVATESEND_ROUNDS);
+        }
+    }
+}
+
+BENCHMARK(PrivateSendRoundsCold);
+BENCHMARK(PrivateSendRoundsCached);
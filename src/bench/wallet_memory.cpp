@@ -0,0 +1,75 @@
+// Copyright (c) 2014-2018 The Polis Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "random.h"
+#include "wallet/wallet.h"
+
+static const size_t WALLET_TX_COUNT = 100000;
+
+// Two inputs and two P2PKH outputs with the size of typical signed transactions, every tenth has a comment
+static std::vector<CWalletTx> CreateWalletTxes(size_t nCount)
+{
+    std::vector<CWalletTx> vecWtx;
+    vecWtx.reserve(nCount);
+    for (size_t i = 0; i < nCount; i++) {
+        CMutableTransaction tx;
+        tx.vin.resize(2);
+        for (CTxIn& txin : tx.vin) {
+            txin.prevout = COutPoint(GetRandHash(), 0);
+            txin.scriptSig = CScript() << std::vector<unsigned char>(72, 0) << std::vector<unsigned char>(33, 0);
+        }
+        tx.vout.resize(2);
+        for (CTxOut& txout : tx.vout) {
+            uint160 hash;
+            GetRandBytes(hash.begin(), hash.size());
+            txout.nValue = COIN;
+            txout.scriptPubKey = CScript() << OP_DUP << OP_HASH160 << ToByteVector(hash) << OP_EQUALVERIFY << OP_CHECKSIG;
+        }
+        vecWtx.emplace_back(nullptr, MakeTransactionRef(std::move(tx)));
+        CWalletTx& wtx = vecWtx.back();
+        wtx.nOrderPos = i;
+        wtx.nTimeReceived = i;
+        if (i % 10 == 0)
+            wtx.mapValue["comment"] = "payment for invoice " + std::to_string(i);
+    }
+    return vecWtx;
+}
+
+// Loads a synthetic wallet like LoadWallet does, only the transactions take memory so far
+static void WalletTxLoad(benchmark::State& state)
+{
+    std::vector<CWalletTx> vecWtx = CreateWalletTxes(WALLET_TX_COUNT);
+
+    while (state.KeepRunning()) {
+        CWallet wallet;
+        LOCK(wallet.cs_wallet);
+        for (const CWalletTx& wtx : vecWtx) {
+            wallet.LoadToWallet(wtx);
+        }
+    }
+}
+
+// Computes the amounts of every transaction like listtransactions does, which allocates their caches
+static void WalletTxAmounts(benchmark::State& state)
+{
+    std::vector<CWalletTx> vecWtx = CreateWalletTxes(WALLET_TX_COUNT);
+    CWallet wallet;
+    LOCK(wallet.cs_wallet);
+    for (const CWalletTx& wtx : vecWtx) {
+        wallet.LoadToWallet(wtx);
+    }
+
+    while (state.KeepRunning()) {
+        CAmount nTotal = 0;
+        for (auto& pair : wallet.mapWallet) {
+            pair.second.MarkDirty();
+            nTotal += pair.second.GetDebit(ISMINE_ALL) + pair.second.GetCredit(ISMINE_ALL);
+        }
+        assert(nTotal == 0);
+    }
+}
+
+BENCHMARK(WalletTxLoad);
+BENCHMARK(WalletTxAmounts);
@@ -5,10 +5,18 @@
 #ifndef CACHEMAP_H_
 #define CACHEMAP_H_
 
-#include <map>
-#include <list>
+#include <algorithm>
 #include <cstddef>
-
+#include <functional>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+#include "hash.h"
+#include "primitives/transaction.h"
+#include "random.h"
 #include "serialize.h"
 
 /**
@@ -38,6 +46,362 @@ struct CacheItem
     }
 };
 
+/**
+ * Hashes cache keys. Hashes of uint256 and COutPoint keys are salted as these usually come from the network
+ */
+class CacheKeyHasher
+{
+private:
+    uint64_t k0, k1;
+
+public:
+    CacheKeyHasher()
+        : k0(GetRand(std::numeric_limits<uint64_t>::max())),
+          k1(GetRand(std::numeric_limits<uint64_t>::max()))
+    {}
+
+    size_t operator()(const uint256& key) const
+    {
+        return SipHashUint256(k0, k1, key);
+    }
+
+    size_t operator()(const COutPoint& key) const
+    {
+        return SipHashUint256Extra(k0, k1, key.hash, key.n);
+    }
+
+    template<typename T>
+    size_t operator()(const T& key) const
+    {
+        return std::hash<T>()(key);
+    }
+};
+
+/**
+ * Hash table with an intrusive LRU list running through its entries, this is the storage of CacheMap
+ * and CacheMultiMap. Entries are allocated in slabs and recycled through a free list, so once the
+ * table has grown to its working size inserting, touching and evicting items doesn't allocate.
+ * Iterating goes from the most recently added item (front) to the least recently added one (back),
+ * erasing an item only invalidates iterators pointing to it.
+ */
+template<typename K, typename V, typename Hasher = CacheKeyHasher>
+class CacheTable
+{
+public:
+    typedef CacheItem<K,V> item_t;
+
+private:
+    struct Node
+    {
+        Node* pPrev;
+        Node* pNext;
+    };
+
+    /// Items are constructed in place as values are not necessarily assignable (e.g. CGovernanceVote)
+    struct Entry : public Node
+    {
+        typename std::aligned_storage<sizeof(item_t), alignof(item_t)>::type storage;
+        size_t nHash;
+        Entry* pPrevInBucket;
+        Entry* pNextInBucket;
+
+        item_t& Item() { return *reinterpret_cast<item_t*>(&storage); }
+        const item_t& Item() const { return *reinterpret_cast<const item_t*>(&storage); }
+    };
+
+    static const size_t MIN_BUCKETS = 16;
+    static const size_t MIN_SLAB_ENTRIES = 8;
+    static const size_t MAX_SLAB_ENTRIES = 4096;
+
+    Hasher hasher;
+    Node head;
+    size_t nSize;
+    std::vector<Entry*> vecBuckets;
+    std::vector<std::unique_ptr<Entry[]> > vecSlabs;
+    size_t nNextSlabEntries;
+    Entry* pFreeList;
+
+public:
+    class const_iterator
+    {
+        friend class CacheTable;
+
+    private:
+        const Node* pNode;
+
+    public:
+        explicit const_iterator(const Node* pNodeIn) : pNode(pNodeIn) {}
+
+        const item_t& operator*() const { return static_cast<const Entry*>(pNode)->Item(); }
+        const item_t* operator->() const { return &static_cast<const Entry*>(pNode)->Item(); }
+
+        const_iterator& operator++() { pNode = pNode->pNext; return *this; }
+        const_iterator operator++(int) { const_iterator it(*this); pNode = pNode->pNext; return it; }
+        const_iterator& operator--() { pNode = pNode->pPrev; return *this; }
+        const_iterator operator--(int) { const_iterator it(*this); pNode = pNode->pPrev; return it; }
+
+        bool operator==(const const_iterator& other) const { return pNode == other.pNode; }
+        bool operator!=(const const_iterator& other) const { return pNode != other.pNode; }
+    };
+
+    CacheTable()
+        : hasher(),
+          nSize(0),
+          vecBuckets(),
+          vecSlabs(),
+          nNextSlabEntries(MIN_SLAB_ENTRIES),
+          pFreeList(nullptr)
+    {
+        head.pPrev = head.pNext = &head;
+    }
+
+    ~CacheTable()
+    {
+        Clear();
+    }
+
+    CacheTable(const CacheTable& other)
+        : CacheTable()
+    {
+        hasher = other.hasher;
+        for (const item_t& item : other) {
+            PushBack(item.key, item.value);
+        }
+    }
+
+    CacheTable& operator=(const CacheTable& other)
+    {
+        if (this != &other) {
+            Clear();
+            hasher = other.hasher;
+            for (const item_t& item : other) {
+                PushBack(item.key, item.value);
+            }
+        }
+        return *this;
+    }
+
+    size_t size() const { return nSize; }
+    bool empty() const { return nSize == 0; }
+
+    const_iterator begin() const { return const_iterator(head.pNext); }
+    const_iterator end() const { return const_iterator(&head); }
+
+    size_t Hash(const K& key) const { return hasher(key); }
+
+    /// Returns the most recently added item with the given key
+    const item_t* Find(const K& key, size_t nHash) const
+    {
+        for (const Entry* pEntry = GetBucket(nHash); pEntry; pEntry = pEntry->pNextInBucket) {
+            if (pEntry->nHash == nHash && pEntry->Item().key == key) {
+                return &pEntry->Item();
+            }
+        }
+        return nullptr;
+    }
+
+    const item_t* Find(const K& key) const { return Find(key, Hash(key)); }
+
+    bool Contains(const K& key, const V& value, size_t nHash) const
+    {
+        return FindEntry(key, value, nHash) != nullptr;
+    }
+
+    /// Calls func for every item with the given key
+    template<typename Func>
+    void ForEach(const K& key, Func&& func) const
+    {
+        size_t nHash = Hash(key);
+        for (const Entry* pEntry = GetBucket(nHash); pEntry; pEntry = pEntry->pNextInBucket) {
+            if (pEntry->nHash == nHash && pEntry->Item().key == key) {
+                func(pEntry->Item());
+            }
+        }
+    }
+
+    const_iterator PushFront(const K& key, const V& value, size_t nHash)
+    {
+        Entry* pEntry = Link(key, value, nHash);
+        LinkAfter(&head, pEntry);
+        return const_iterator(pEntry);
+    }
+
+    void PushBack(const K& key, const V& value)
+    {
+        Entry* pEntry = Link(key, value, Hash(key));
+        LinkAfter(head.pPrev, pEntry);
+    }
+
+    void PopBack()
+    {
+        if (nSize != 0) {
+            Remove(static_cast<Entry*>(head.pPrev));
+        }
+    }
+
+    /// Erases all items with the given key, returns the number of erased items
+    size_t Erase(const K& keyIn)
+    {
+        // keyIn might refer to one of the items we are about to remove
+        const K key = keyIn;
+        size_t nHash = Hash(key);
+        size_t nErased = 0;
+        Entry* pEntry = GetBucket(nHash);
+        while (pEntry) {
+            Entry* pNext = pEntry->pNextInBucket;
+            if (pEntry->nHash == nHash && pEntry->Item().key == key) {
+                Remove(pEntry);
+                ++nErased;
+            }
+            pEntry = pNext;
+        }
+        return nErased;
+    }
+
+    bool Erase(const K& key, const V& value)
+    {
+        Entry* pEntry = FindEntry(key, value, Hash(key));
+        if (!pEntry) {
+            return false;
+        }
+        Remove(pEntry);
+        return true;
+    }
+
+    void Erase(const_iterator it)
+    {
+        Remove(static_cast<Entry*>(const_cast<Node*>(it.pNode)));
+    }
+
+    /// Removes all items and releases all memory
+    void Clear()
+    {
+        for (Node* pNode = head.pNext; pNode != &head; pNode = pNode->pNext) {
+            static_cast<Entry*>(pNode)->Item().~item_t();
+        }
+        head.pPrev = head.pNext = &head;
+        nSize = 0;
+        vecBuckets.clear();
+        vecSlabs.clear();
+        nNextSlabEntries = MIN_SLAB_ENTRIES;
+        pFreeList = nullptr;
+    }
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        // same format as std::list<item_t>
+        WriteCompactSize(s, nSize);
+        for (const item_t& item : *this) {
+            ::Serialize(s, item);
+        }
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        Clear();
+        unsigned int nCount = ReadCompactSize(s);
+        for (unsigned int i = 0; i < nCount; i++) {
+            item_t item;
+            ::Unserialize(s, item);
+            PushBack(item.key, item.value);
+        }
+    }
+
+private:
+    Entry* GetBucket(size_t nHash) const
+    {
+        return vecBuckets.empty() ? nullptr : vecBuckets[nHash & (vecBuckets.size() - 1)];
+    }
+
+    Entry* FindEntry(const K& key, const V& value, size_t nHash) const
+    {
+        for (Entry* pEntry = GetBucket(nHash); pEntry; pEntry = pEntry->pNextInBucket) {
+            if (pEntry->nHash == nHash && pEntry->Item().key == key && pEntry->Item().value == value) {
+                return pEntry;
+            }
+        }
+        return nullptr;
+    }
+
+    void LinkAfter(Node* pPos, Entry* pEntry)
+    {
+        pEntry->pPrev = pPos;
+        pEntry->pNext = pPos->pNext;
+        pPos->pNext->pPrev = pEntry;
+        pPos->pNext = pEntry;
+    }
+
+    void LinkBucket(Entry* pEntry)
+    {
+        Entry*& pBucket = vecBuckets[pEntry->nHash & (vecBuckets.size() - 1)];
+        pEntry->pPrevInBucket = nullptr;
+        pEntry->pNextInBucket = pBucket;
+        if (pBucket) {
+            pBucket->pPrevInBucket = pEntry;
+        }
+        pBucket = pEntry;
+    }
+
+    /// Takes an entry from the free list and puts it into its bucket, the caller links it into the LRU list
+    Entry* Link(const K& key, const V& value, size_t nHash)
+    {
+        if (nSize >= vecBuckets.size()) {
+            Rehash(std::max(vecBuckets.size() * 2, size_t(MIN_BUCKETS)));
+        }
+        if (!pFreeList) {
+            AllocateSlab();
+        }
+        Entry* pEntry = pFreeList;
+        pFreeList = pEntry->pNextInBucket;
+
+        new (&pEntry->storage) item_t(key, value);
+        pEntry->nHash = nHash;
+        LinkBucket(pEntry);
+        ++nSize;
+        return pEntry;
+    }
+
+    void Remove(Entry* pEntry)
+    {
+        pEntry->pPrev->pNext = pEntry->pNext;
+        pEntry->pNext->pPrev = pEntry->pPrev;
+
+        if (pEntry->pPrevInBucket) {
+            pEntry->pPrevInBucket->pNextInBucket = pEntry->pNextInBucket;
+        } else {
+            vecBuckets[pEntry->nHash & (vecBuckets.size() - 1)] = pEntry->pNextInBucket;
+        }
+        if (pEntry->pNextInBucket) {
+            pEntry->pNextInBucket->pPrevInBucket = pEntry->pPrevInBucket;
+        }
+
+        pEntry->Item().~item_t();
+        pEntry->pNextInBucket = pFreeList;
+        pFreeList = pEntry;
+        --nSize;
+    }
+
+    void Rehash(size_t nBuckets)
+    {
+        vecBuckets.assign(nBuckets, nullptr);
+        for (Node* pNode = head.pNext; pNode != &head; pNode = pNode->pNext) {
+            LinkBucket(static_cast<Entry*>(pNode));
+        }
+    }
+
+    void AllocateSlab()
+    {
+        std::unique_ptr<Entry[]> slab(new Entry[nNextSlabEntries]);
+        for (size_t i = 0; i < nNextSlabEntries; i++) {
+            slab[i].pNextInBucket = pFreeList;
+            pFreeList = &slab[i];
+        }
+        vecSlabs.push_back(std::move(slab));
+        nNextSlabEntries = std::min(nNextSlabEntries * 2, size_t(MAX_SLAB_ENTRIES));
+    }
+};
 
 /**
  * Map like container that keeps the N most recently added items
@@ -50,44 +414,29 @@ public:
 
     typedef CacheItem<K,V> item_t;
 
-    typedef std::list<item_t> list_t;
-
-    typedef typename list_t::iterator list_it;
+    typedef CacheTable<K,V> list_t;
 
     typedef typename list_t::const_iterator list_cit;
 
-    typedef std::map<K, list_it> map_t;
-
-    typedef typename map_t::iterator map_it;
-
-    typedef typename map_t::const_iterator map_cit;
-
 private:
     size_type nMaxSize;
 
     list_t listItems;
 
-    map_t mapIndex;
-
 public:
     CacheMap(size_type nMaxSizeIn = 0)
         : nMaxSize(nMaxSizeIn),
-          listItems(),
-          mapIndex()
+          listItems()
     {}
 
     CacheMap(const CacheMap<K,V>& other)
         : nMaxSize(other.nMaxSize),
-          listItems(other.listItems),
-          mapIndex()
-    {
-        RebuildIndex();
-    }
+          listItems(other.listItems)
+    {}
 
     void Clear()
     {
-        mapIndex.clear();
-        listItems.clear();
+        listItems.Clear();
     }
 
     void SetMaxSize(size_type nMaxSizeIn)
@@ -105,41 +454,35 @@ public:
 
     bool Insert(const K& key, const V& value)
     {
-        if(mapIndex.find(key) != mapIndex.end()) {
+        size_t nHash = listItems.Hash(key);
+        if(listItems.Find(key, nHash)) {
             return false;
         }
         if(listItems.size() == nMaxSize) {
-            PruneLast();
+            listItems.PopBack();
         }
-        listItems.push_front(item_t(key, value));
-        mapIndex.emplace(key, listItems.begin());
+        listItems.PushFront(key, value, nHash);
         return true;
     }
 
     bool HasKey(const K& key) const
     {
-        return (mapIndex.find(key) != mapIndex.end());
+        return listItems.Find(key) != nullptr;
     }
 
     bool Get(const K& key, V& value) const
     {
-        map_cit it = mapIndex.find(key);
-        if(it == mapIndex.end()) {
+        const item_t* pItem = listItems.Find(key);
+        if(!pItem) {
             return false;
         }
-        item_t& item = *(it->second);
-        value = item.value;
+        value = pItem->value;
         return true;
     }
 
     void Erase(const K& key)
     {
-        map_it it = mapIndex.find(key);
-        if(it == mapIndex.end()) {
-            return;
-        }
-        listItems.erase(it->second);
-        mapIndex.erase(it);
+        listItems.Erase(key);
     }
 
     const list_t& GetItemList() const {
@@ -150,7 +493,6 @@ public:
     {
         nMaxSize = other.nMaxSize;
         listItems = other.listItems;
-        RebuildIndex();
         return *this;
     }
 
@@ -161,28 +503,6 @@ public:
     {
         READWRITE(nMaxSize);
         READWRITE(listItems);
-        if(ser_action.ForRead()) {
-            RebuildIndex();
-        }
-    }
-
-private:
-    void PruneLast()
-    {
-        if(listItems.empty()) {
-            return;
-        }
-        item_t& item = listItems.back();
-        mapIndex.erase(item.key);
-        listItems.pop_back();
-    }
-
-    void RebuildIndex()
-    {
-        mapIndex.clear();
-        for(list_it it = listItems.begin(); it != listItems.end(); ++it) {
-            mapIndex.emplace(it->key, it);
-        }
     }
 };
 
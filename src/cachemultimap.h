@@ -5,10 +5,11 @@
 #ifndef CACHEMULTIMAP_H_
 #define CACHEMULTIMAP_H_
 
+#include <algorithm>
 #include <cstddef>
 #include <map>
-#include <list>
-#include <set>
+#include <unordered_map>
+#include <vector>
 
 #include "serialize.h"
 
@@ -25,19 +26,18 @@ public:
 
     typedef CacheItem<K,V> item_t;
 
-    typedef std::list<item_t> list_t;
-
-    typedef typename list_t::iterator list_it;
+    typedef CacheTable<K,V> list_t;
 
     typedef typename list_t::const_iterator list_cit;
 
-    typedef std::map<V,list_it> it_map_t;
+    /// Items of one key by value, so that keys with many values don't need to be scanned
+    typedef std::map<V,list_cit> it_map_t;
 
     typedef typename it_map_t::iterator it_map_it;
 
     typedef typename it_map_t::const_iterator it_map_cit;
 
-    typedef std::map<K, it_map_t> map_t;
+    typedef std::unordered_map<K, it_map_t, CacheKeyHasher> map_t;
 
     typedef typename map_t::iterator map_it;
 
@@ -57,7 +57,7 @@ public:
           mapIndex()
     {}
 
-    CacheMultiMap(const CacheMap<K,V>& other)
+    CacheMultiMap(const CacheMultiMap<K,V>& other)
         : nMaxSize(other.nMaxSize),
           listItems(other.listItems),
           mapIndex()
@@ -68,7 +68,7 @@ public:
     void Clear()
     {
         mapIndex.clear();
-        listItems.clear();
+        listItems.Clear();
     }
 
     void SetMaxSize(size_type nMaxSizeIn)
@@ -87,75 +87,73 @@ public:
     bool Insert(const K& key, const V& value)
     {
         map_it mit = mapIndex.find(key);
-        if(mit == mapIndex.end()) {
-            mit = mapIndex.emplace(key, it_map_t()).first;
-        }
-        it_map_t& mapIt = mit->second;
-
-        if(mapIt.count(value) > 0) {
+        if(mit != mapIndex.end() && mit->second.count(value) > 0) {
             // Don't insert duplicates
             return false;
         }
 
         if(listItems.size() == nMaxSize) {
             PruneLast();
+            // the pruned item might have been the last one of this key
+            mit = mapIndex.find(key);
+        }
+        if(mit == mapIndex.end()) {
+            mit = mapIndex.emplace(key, it_map_t()).first;
         }
-        listItems.push_front(item_t(key, value));
-        mapIt.emplace(value, listItems.begin());
+        mit->second.emplace(value, listItems.PushFront(key, value, listItems.Hash(key)));
         return true;
     }
 
     bool HasKey(const K& key) const
     {
-        return (mapIndex.find(key) != mapIndex.end());
+        return mapIndex.find(key) != mapIndex.end();
     }
 
+    /// Returns the smallest value for the given key
     bool Get(const K& key, V& value) const
     {
-        map_cit it = mapIndex.find(key);
-        if(it == mapIndex.end()) {
+        map_cit mit = mapIndex.find(key);
+        if(mit == mapIndex.end()) {
             return false;
         }
-        const it_map_t& mapIt = it->second;
-        const item_t& item = *(mapIt.begin()->second);
-        value = item.value;
+        value = mit->second.begin()->second->value;
         return true;
     }
 
-    bool GetAll(const K& key, std::vector<V>& vecValues)
+    /// Appends all values for the given key in ascending order
+    bool GetAll(const K& key, std::vector<V>& vecValues) const
     {
         map_cit mit = mapIndex.find(key);
         if(mit == mapIndex.end()) {
             return false;
         }
-        const it_map_t& mapIt = mit->second;
-
-        for(it_map_cit it = mapIt.begin(); it != mapIt.end(); ++it) {
-            const item_t& item = *(it->second);
-            vecValues.push_back(item.value);
+        for(it_map_cit it = mit->second.begin(); it != mit->second.end(); ++it) {
+            vecValues.push_back(it->second->value);
         }
         return true;
     }
 
-    void GetKeys(std::vector<K>& vecKeys)
+    /// Appends all distinct keys in ascending order
+    void GetKeys(std::vector<K>& vecKeys) const
     {
-        for(map_cit it = mapIndex.begin(); it != mapIndex.end(); ++it) {
-            vecKeys.push_back(it->first);
+        size_t nOldSize = vecKeys.size();
+        for(map_cit mit = mapIndex.begin(); mit != mapIndex.end(); ++mit) {
+            vecKeys.push_back(mit->first);
         }
+        std::sort(vecKeys.begin() + nOldSize, vecKeys.end());
     }
 
-    void Erase(const K& key)
+    void Erase(const K& keyIn)
     {
+        // keyIn might refer to one of the items we are about to remove
+        const K key = keyIn;
         map_it mit = mapIndex.find(key);
         if(mit == mapIndex.end()) {
             return;
         }
-        it_map_t& mapIt = mit->second;
-
-        for(it_map_it it = mapIt.begin(); it != mapIt.end(); ++it) {
-            listItems.erase(it->second);
+        for(it_map_it it = mit->second.begin(); it != mit->second.end(); ++it) {
+            listItems.Erase(it->second);
         }
-
         mapIndex.erase(mit);
     }
 
@@ -165,26 +163,24 @@ public:
         if(mit == mapIndex.end()) {
             return;
         }
-        it_map_t& mapIt = mit->second;
-
-        it_map_it it = mapIt.find(value);
-        if(it == mapIt.end()) {
+        it_map_it it = mit->second.find(value);
+        if(it == mit->second.end()) {
             return;
         }
-
-        listItems.erase(it->second);
-        mapIt.erase(it);
-
-        if(mapIt.empty()) {
+        // key and value might refer to the item itself, so it is removed from the table last
+        list_cit itItem = it->second;
+        mit->second.erase(it);
+        if(mit->second.empty()) {
             mapIndex.erase(mit);
         }
+        listItems.Erase(itItem);
     }
 
     const list_t& GetItemList() const {
         return listItems;
     }
 
-    CacheMap<K,V>& operator=(const CacheMap<K,V>& other)
+    CacheMultiMap<K,V>& operator=(const CacheMultiMap<K,V>& other)
     {
         nMaxSize = other.nMaxSize;
         listItems = other.listItems;
@@ -210,37 +206,21 @@ private:
         if(listItems.empty()) {
             return;
         }
-
-        list_it lit = listItems.end();
-        --lit;
-        item_t& item = *lit;
-
-        map_it mit = mapIndex.find(item.key);
-
-        if(mit != mapIndex.end()) {
-            it_map_t& mapIt = mit->second;
-
-            mapIt.erase(item.value);
-
-            if(mapIt.empty()) {
-                mapIndex.erase(item.key);
-            }
+        list_cit itLast = listItems.end();
+        --itLast;
+        map_it mit = mapIndex.find(itLast->key);
+        mit->second.erase(itLast->value);
+        if(mit->second.empty()) {
+            mapIndex.erase(mit);
         }
-
-        listItems.pop_back();
+        listItems.PopBack();
     }
 
     void RebuildIndex()
     {
         mapIndex.clear();
-        for(list_it lit = listItems.begin(); lit != listItems.end(); ++lit) {
-            item_t& item = *lit;
-            map_it mit = mapIndex.find(item.key);
-            if(mit == mapIndex.end()) {
-                mit = mapIndex.emplace(item.key, it_map_t()).first;
-            }
-            it_map_t& mapIt = mit->second;
-            mapIt.emplace(item.value, lit);
+        for(list_cit it = listItems.begin(); it != listItems.end(); ++it) {
+            mapIndex[it->key].emplace(it->value, it);
         }
     }
 };
@@ -6,9 +6,11 @@
 #define BITCOIN_CHECKQUEUE_H
 
 #include <algorithm>
+#include <atomic>
+#include <deque>
+#include <memory>
 #include <vector>
 
-#include <boost/foreach.hpp>
 #include <boost/thread/condition_variable.hpp>
 #include <boost/thread/locks.hpp>
 #include <boost/thread/mutex.hpp>
@@ -16,6 +18,9 @@
 template <typename T>
 class CCheckQueueControl;
 
+/** Workers beyond that many share their queues */
+static const unsigned int MAX_CHECKQUEUE_WORKER_QUEUES = 64;
+
 /** 
  * Queue for verifications that have to be performed.
   * The verifications are represented by a type T, which must provide an
@@ -25,12 +30,31 @@ class CCheckQueueControl;
   * onto the queue, where they are processed by N-1 worker threads. When
   * the master is done adding work, it temporarily joins the worker pool
   * as an N'th worker, until all jobs are done.
+  *
+  * Every worker has a queue of its own, which the master spreads the
+  * added verifications over. Workers take batches from the back of their
+  * own queue, and steal from the front of the others once it's empty, so
+  * that they only contend for a lock when they run out of work. The
+  * remaining verifications and the result are counted without any lock.
   */
 template <typename T>
 class CCheckQueue
 {
 private:
-    //! Mutex to protect the inner state
+    //! A worker's verifications, its owner takes from the back and the others steal from the front
+    struct WorkerQueue
+    {
+        boost::mutex mutex;
+        std::deque<T> queue;
+        //! Size of the queue, to skip empty ones without locking them
+        std::atomic<size_t> nSize;
+
+        WorkerQueue() : nSize(0) {}
+    };
+
+    std::vector<std::unique_ptr<WorkerQueue>> vWorkerQueues;
+
+    //! Mutex for the workers and the master to wait on the conditions below
     boost::mutex mutex;
 
     //! Worker threads block on this when out of work
@@ -39,90 +63,121 @@ private:
     //! Master thread blocks on this when out of work
     boost::condition_variable condMaster;
 
-    //! The queue of elements to be processed.
-    //! As the order of booleans doesn't matter, it is used as a LIFO (stack)
-    std::vector<T> queue;
+    //! The number of worker threads (excluding the master) which have started, the first ones own a queue each
+    std::atomic<int> nWorkers;
 
-    //! The number of workers (including the master) that are idle.
-    int nIdle;
+    //! The number of workers (including the master) that are idle or about to be.
+    std::atomic<int> nIdle;
 
-    //! The total number of workers (including the master).
-    int nTotal;
+    //! The number of verifications in the queues, may briefly be off while they are moved in or out.
+    std::atomic<int> nQueued;
 
     //! The temporary evaluation result.
-    bool fAllOk;
+    std::atomic<bool> fAllOk;
 
     /**
      * Number of verifications that haven't completed yet.
      * This includes elements that are no longer queued, but still in the
      * worker's own batches.
      */
-    unsigned int nTodo;
-
-    //! Whether we're shutting down.
-    bool fQuit;
+    std::atomic<unsigned int> nTodo;
 
     //! The maximum number of elements to be processed in one batch
     unsigned int nBatchSize;
 
+    //! The queue the master adds the next batch to, only used by the master
+    unsigned int nNextQueue;
+
+    //! The number of queues which may have been added to
+    unsigned int GetActiveQueues() const
+    {
+        return std::max(1U, std::min((unsigned int)nWorkers, (unsigned int)vWorkerQueues.size()));
+    }
+
+    /**
+     * Move a batch of verifications into vChecks, from the back of the queue nQueue first, and from the front
+     * of the other queues otherwise. Returns false if there was nothing to take.
+     */
+    bool Take(std::vector<T>& vChecks, unsigned int nQueue)
+    {
+        const unsigned int nQueues = GetActiveQueues();
+        for (unsigned int i = 0; i < nQueues; i++) {
+            const bool fOwn = i == 0;
+            WorkerQueue& worker = *vWorkerQueues[(nQueue + i) % nQueues];
+            if (worker.nSize == 0)
+                continue;
+            boost::unique_lock<boost::mutex> lock(worker.mutex);
+            std::deque<T>& queue = worker.queue;
+            if (queue.empty())
+                continue;
+            // Decide how many work units to process now.
+            // * Leave some of the own queue to the idle workers, which will instantly start stealing it.
+            // * Steal half of another queue, so that its owner and the thief finish approximately simultaneously.
+            // * Don't do batches smaller than 1 (duh), or larger than nBatchSize.
+            const unsigned int nSize = queue.size();
+            const unsigned int nNow = std::max(1U, std::min(nBatchSize, fOwn ? nSize / (nIdle + 1) : nSize / 2));
+            vChecks.resize(nNow);
+            for (unsigned int j = 0; j < nNow; j++) {
+                // swap jobs out of the queue instead of copying, to hold the lock as short as possible
+                if (fOwn) {
+                    vChecks[j].swap(queue.back());
+                    queue.pop_back();
+                } else {
+                    vChecks[j].swap(queue.front());
+                    queue.pop_front();
+                }
+            }
+            worker.nSize = queue.size();
+            lock.unlock();
+            nQueued -= nNow;
+            return true;
+        }
+        return false;
+    }
+
     /** Internal function that does bulk of the verification work. */
     bool Loop(bool fMaster = false)
     {
         boost::condition_variable& cond = fMaster ? condMaster : condWorker;
+        // the master has no queue of its own, it starts with the first one
+        const unsigned int nQueue = fMaster ? 0 : (unsigned int)(nWorkers++) % vWorkerQueues.size();
         std::vector<T> vChecks;
         vChecks.reserve(nBatchSize);
-        unsigned int nNow = 0;
-        bool fOk = true;
         do {
-            {
-                boost::unique_lock<boost::mutex> lock(mutex);
-                // first do the clean-up of the previous loop run (allowing us to do it in the same critsect)
-                if (nNow) {
-                    fAllOk &= fOk;
-                    nTodo -= nNow;
-                    if (nTodo == 0 && !fMaster)
-                        // We processed the last element; inform the master it can exit and return the result
-                        condMaster.notify_one();
-                } else {
-                    // first iteration
-                    nTotal++;
-                }
-                // logically, the do loop starts here
-                while (queue.empty()) {
-                    if ((fMaster || fQuit) && nTodo == 0) {
-                        nTotal--;
-                        bool fRet = fAllOk;
-                        // reset the status for new work later
-                        if (fMaster)
-                            fAllOk = true;
-                        // return the current status
-                        return fRet;
-                    }
-                    nIdle++;
-                    cond.wait(lock); // wait
-                    nIdle--;
-                }
-                // Decide how many work units to process now.
-                // * Do not try to do everything at once, but aim for increasingly smaller batches so
-                //   all workers finish approximately simultaneously.
-                // * Try to account for idle jobs which will instantly start helping.
-                // * Don't do batches smaller than 1 (duh), or larger than nBatchSize.
-                nNow = std::max(1U, std::min(nBatchSize, (unsigned int)queue.size() / (nTotal + nIdle + 1)));
-                vChecks.resize(nNow);
-                for (unsigned int i = 0; i < nNow; i++) {
-                    // We want the lock on the mutex to be as short as possible, so swap jobs from the global
-                    // queue to the local batch vector instead of copying.
-                    vChecks[i].swap(queue.back());
-                    queue.pop_back();
-                }
+            if (Take(vChecks, nQueue)) {
                 // Check whether we need to do work at all
-                fOk = fAllOk;
+                bool fOk = fAllOk;
+                // execute work
+                for (T& check : vChecks)
+                    if (fOk)
+                        fOk = check();
+                const unsigned int nNow = vChecks.size();
+                // the checks are destroyed before they count as done, see test_CheckQueue_FrozenCleanup
+                vChecks.clear();
+                if (!fOk)
+                    fAllOk = false;
+                if (nTodo.fetch_sub(nNow) == nNow && !fMaster) {
+                    // We processed the last element; inform the master it can exit and return the result
+                    boost::unique_lock<boost::mutex> lock(mutex);
+                    condMaster.notify_one();
+                }
+                continue;
             }
-            // execute work
-            BOOST_FOREACH (T& check, vChecks)
-                if (fOk)
-                    fOk = check();
-            vChecks.clear();
+
+            boost::unique_lock<boost::mutex> lock(mutex);
+            if (fMaster && nTodo == 0) {
+                bool fRet = fAllOk;
+                // reset the status for new work later
+                fAllOk = true;
+                // return the current status
+                return fRet;
+            }
+            // Add() notifies the idle workers after queueing, and the last worker the master after nTodo reaches
+            // zero, both while holding the mutex, so neither can get lost between these checks and the wait.
+            nIdle++;
+            if (nQueued <= 0)
+                cond.wait(lock); // wait
+            nIdle--;
         } while (true);
     }
 
@@ -131,7 +186,12 @@ public:
     boost::mutex ControlMutex;
 
     //! Create a new check queue
-    CCheckQueue(unsigned int nBatchSizeIn) : nIdle(0), nTotal(0), fAllOk(true), nTodo(0), fQuit(false), nBatchSize(nBatchSizeIn) {}
+    CCheckQueue(unsigned int nBatchSizeIn) : nWorkers(0), nIdle(0), nQueued(0), fAllOk(true), nTodo(0), nBatchSize(nBatchSizeIn), nNextQueue(0)
+    {
+        for (unsigned int i = 0; i < MAX_CHECKQUEUE_WORKER_QUEUES; i++) {
+            vWorkerQueues.emplace_back(new WorkerQueue());
+        }
+    }
 
     //! Worker thread
     void Thread()
@@ -148,16 +208,30 @@ public:
     //! Add a batch of checks to the queue
     void Add(std::vector<T>& vChecks)
     {
-        boost::unique_lock<boost::mutex> lock(mutex);
-        BOOST_FOREACH (T& check, vChecks) {
-            queue.push_back(T());
-            check.swap(queue.back());
-        }
+        if (vChecks.empty())
+            return;
+        // count them before any worker can take them
         nTodo += vChecks.size();
-        if (vChecks.size() == 1)
-            condWorker.notify_one();
-        else if (vChecks.size() > 1)
-            condWorker.notify_all();
+        // spread the checks evenly over the queues of the workers, starting after where the last batch went
+        const unsigned int nQueues = GetActiveQueues();
+        const size_t nPerQueue = (vChecks.size() + nQueues - 1) / nQueues;
+        for (size_t i = 0; i < vChecks.size(); i += nPerQueue) {
+            WorkerQueue& worker = *vWorkerQueues[nNextQueue++ % nQueues];
+            boost::unique_lock<boost::mutex> lock(worker.mutex);
+            for (size_t j = i; j < std::min(i + nPerQueue, vChecks.size()); j++) {
+                worker.queue.push_back(T());
+                vChecks[j].swap(worker.queue.back());
+            }
+            worker.nSize = worker.queue.size();
+        }
+        nQueued += vChecks.size();
+        if (nIdle > 0) {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            if (vChecks.size() == 1)
+                condWorker.notify_one();
+            else
+                condWorker.notify_all();
+        }
     }
 
     ~CCheckQueue()
@@ -7,8 +7,11 @@
 #include "consensus/consensus.h"
 #include "memusage.h"
 #include "random.h"
+#include "ctpl.h"
 
+#include <algorithm>
 #include <assert.h>
+#include <future>
 #include <boost/foreach.hpp>
 
 bool CCoinsView::GetCoin(const COutPoint &outpoint, Coin &coin) const { return false; }
@@ -56,6 +59,56 @@ CCoinsMap::iterator CCoinsViewCache::FetchCoin(const COutPoint &outpoint) const
     return ret;
 }
 
+void CCoinsViewCache::PrefetchCoins(std::vector<COutPoint> vOutpoints, ctpl::thread_pool* pool) {
+    // the database is ordered by outpoint, so neighbouring reads mostly hit the same blocks
+    std::sort(vOutpoints.begin(), vOutpoints.end());
+    vOutpoints.erase(std::unique(vOutpoints.begin(), vOutpoints.end()), vOutpoints.end());
+    vOutpoints.erase(std::remove_if(vOutpoints.begin(), vOutpoints.end(), [this](const COutPoint& outpoint) {
+        return cacheCoins.count(outpoint) != 0;
+    }), vOutpoints.end());
+    if (vOutpoints.empty())
+        return;
+
+    std::vector<Coin> vCoins(vOutpoints.size());
+    std::vector<char> vFound(vOutpoints.size(), 0);
+    auto readRange = [&](size_t nBegin, size_t nEnd) {
+        for (size_t i = nBegin; i < nEnd; i++) {
+            vFound[i] = base->GetCoin(vOutpoints[i], vCoins[i]);
+        }
+    };
+
+    size_t nThreads = pool ? std::min((size_t)pool->size(), vOutpoints.size() / MIN_PREFETCH_COINS_PER_THREAD) : 0;
+    if (nThreads <= 1) {
+        readRange(0, vOutpoints.size());
+    } else {
+        // contiguous ranges, so that every thread reads its part of the key space in order
+        size_t nPerThread = (vOutpoints.size() + nThreads - 1) / nThreads;
+        std::vector<std::future<void> > vFutures;
+        for (size_t nBegin = 0; nBegin < vOutpoints.size(); nBegin += nPerThread) {
+            size_t nEnd = std::min(nBegin + nPerThread, vOutpoints.size());
+            vFutures.emplace_back(pool->push([&readRange, nBegin, nEnd](int) { readRange(nBegin, nEnd); }));
+        }
+        // all of them must be done before an exception leaves this frame
+        for (auto& future : vFutures) {
+            future.wait();
+        }
+        for (auto& future : vFutures) {
+            future.get();
+        }
+    }
+
+    for (size_t i = 0; i < vOutpoints.size(); i++) {
+        if (!vFound[i])
+            continue;
+        CCoinsMap::iterator ret = cacheCoins.emplace(std::piecewise_construct, std::forward_as_tuple(vOutpoints[i]), std::forward_as_tuple(std::move(vCoins[i]))).first;
+        if (ret->second.coin.IsSpent()) {
+            // same as in FetchCoin
+            ret->second.flags = CCoinsCacheEntry::FRESH;
+        }
+        cachedCoinsUsage += ret->second.coin.DynamicMemoryUsage();
+    }
+}
+
 bool CCoinsViewCache::GetCoin(const COutPoint &outpoint, Coin &coin) const {
     CCoinsMap::const_iterator it = FetchCoin(outpoint);
     if (it != cacheCoins.end()) {
@@ -101,7 +101,7 @@ class SaltedOutpointHasher
 {
 private:
     /** Salt */
-    const uint64_t k0, k1;
+    uint64_t k0, k1;
 
 public:
     SaltedOutpointHasher();
@@ -135,7 +135,18 @@ struct CCoinsCacheEntry
     explicit CCoinsCacheEntry(Coin&& coin_) : coin(std::move(coin_)), flags(0) {}
 };
 
-typedef std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher> CCoinsMap;
+/**
+ * The cache entries are kept inline in one array, see flat_hash_map. Adding an entry may move all the
+ * others, so references to cached coins are only valid until the next coin is fetched or added.
+ */
+typedef flat_hash_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher> CCoinsMap;
+
+namespace ctpl {
+    class thread_pool;
+}
+
+/** PrefetchCoins only uses another thread for at least that many coins */
+static const size_t MIN_PREFETCH_COINS_PER_THREAD = 64;
 
 /** Cursor for iterating over CoinsView state */
 class CCoinsViewCursor
@@ -253,6 +264,13 @@ public:
      */
     const Coin& AccessCoin(const COutPoint &output) const;
 
+    /**
+     * Load the given coins which aren't cached yet from the backing view at once, in key order and split
+     * over the threads of pool (if any) instead of one by one as they are accessed. Only for backing views
+     * allowing concurrent GetCoin calls, like CCoinsViewDB, which don't change while this runs.
+     */
+    void PrefetchCoins(std::vector<COutPoint> vOutpoints, ctpl::thread_pool* pool = NULL);
+
     /**
      * Add a coin. Set potential_overwrite to true if a non-pruned version may
      * already exist.
@@ -9,15 +9,29 @@ CEvoDB* evoDb;
 CEvoDB::CEvoDB(size_t nCacheSize, bool fMemory, bool fWipe) :
     db(fMemory ? "" : (GetDataDir() / "evodb"), nCacheSize, fMemory, fWipe),
     rootBatch(db),
-    rootDBTransaction(db, rootBatch),
+    flushDBTransaction(db, rootBatch),
+    rootDBTransaction(flushDBTransaction, flushDBTransaction),
     curDBTransaction(rootDBTransaction, rootDBTransaction)
 {
 }
 
 bool CEvoDB::CommitRootTransaction()
 {
+    PrepareCommit();
+    return WriteCommitted();
+}
+
+void CEvoDB::PrepareCommit()
+{
+    LOCK(cs);
     assert(curDBTransaction.IsClean());
     rootDBTransaction.Commit();
+}
+
+bool CEvoDB::WriteCommitted()
+{
+    LOCK(cs);
+    flushDBTransaction.Commit();
     bool ret = db.WriteBatch(rootBatch);
     rootBatch.Clear();
     return ret;
@@ -17,11 +17,14 @@ private:
     CCriticalSection cs;
     CDBWrapper db;
 
-    typedef CDBTransaction<CDBWrapper, CDBBatch> RootTransaction;
+    typedef CDBTransaction<CDBWrapper, CDBBatch> FlushTransaction;
+    typedef CDBTransaction<FlushTransaction, FlushTransaction> RootTransaction;
     typedef CDBTransaction<RootTransaction, RootTransaction> CurTransaction;
     typedef CScopedDBTransaction<RootTransaction, RootTransaction> ScopedTransaction;
 
     CDBBatch rootBatch;
+    // committed by PrepareCommit but not written to disk yet
+    FlushTransaction flushDBTransaction;
     RootTransaction rootDBTransaction;
     CurTransaction curDBTransaction;
 
@@ -70,6 +73,13 @@ public:
 
     bool CommitRootTransaction();
 
+    /**
+     * Split CommitRootTransaction, so that the write can happen on another thread together with
+     * the coins database. The prepared changes are still visible to reads until they are written.
+     */
+    void PrepareCommit();
+    bool WriteCommitted();
+
     bool VerifyBestBlock(const uint256& hash);
     void WriteBestBlock(const uint256& hash);
 };
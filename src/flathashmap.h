@@ -0,0 +1,308 @@
+// Copyright (c) 2014-2018 The Polis Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef FLATHASHMAP_H
+#define FLATHASHMAP_H
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <new>
+#include <stdint.h>
+#include <type_traits>
+#include <utility>
+
+/**
+ * Hash map with open addressing and linear probing, which keeps all entries in one array instead of
+ * allocating a node per entry. Every slot has a control byte in a separate array, which is either empty,
+ * deleted or 7 bits of the hash of the slot's key, so that probing mostly compares bytes instead of keys.
+ *
+ * Implements the part of the std::unordered_map interface used for CCoinsMap. The differences are:
+ * - Inserting may move all entries, which invalidates iterators, pointers and references to them.
+ * - Erasing leaves a tombstone behind, other iterators stay valid, so erasing while iterating works.
+ * - clear() frees the storage, like a swap with an empty map would.
+ */
+template <typename K, typename T, typename Hash = std::hash<K> >
+class flat_hash_map
+{
+public:
+    typedef K key_type;
+    typedef T mapped_type;
+    typedef std::pair<const K, T> value_type;
+    typedef size_t size_type;
+
+private:
+    // enumerators rather than static members, which would need a definition when bound to a reference
+    enum : uint8_t {
+        CTRL_EMPTY = 0x80,
+        CTRL_DELETED = 0xfe,
+    };
+    enum : size_t {
+        //! Full and deleted slots together are kept below MAX_LOAD_NUM/MAX_LOAD_DEN of the capacity
+        MAX_LOAD_NUM = 7,
+        MAX_LOAD_DEN = 8,
+        MIN_CAPACITY = 16,
+    };
+
+    uint8_t* pctrl;
+    value_type* pslots;
+    //! zero or a power of two
+    size_t nCapacity;
+    size_t nSize;
+    size_t nDeleted;
+    Hash hasher;
+
+    static bool IsFull(uint8_t ctrl) { return ctrl < CTRL_EMPTY; }
+    static uint8_t GetTag(size_t nHash) { return nHash & 0x7f; }
+    size_t GetStart(size_t nHash) const { return (nHash >> 7) & (nCapacity - 1); }
+
+    /** Slot of the key or nCapacity if it's not there */
+    size_t FindSlot(const K& key, size_t nHash) const
+    {
+        if (nSize == 0)
+            return nCapacity;
+        const size_t nMask = nCapacity - 1;
+        const uint8_t tag = GetTag(nHash);
+        for (size_t i = GetStart(nHash); ; i = (i + 1) & nMask) {
+            if (pctrl[i] == CTRL_EMPTY)
+                return nCapacity;
+            if (pctrl[i] == tag && pslots[i].first == key)
+                return i;
+        }
+    }
+
+    /** First empty or deleted slot on the key's probe sequence, there always is one below the maximum load */
+    size_t FindFreeSlot(size_t nHash) const
+    {
+        const size_t nMask = nCapacity - 1;
+        size_t i = GetStart(nHash);
+        while (IsFull(pctrl[i])) {
+            i = (i + 1) & nMask;
+        }
+        return i;
+    }
+
+    void Allocate(size_t nCapacityIn)
+    {
+        nCapacity = nCapacityIn;
+        pctrl = nCapacity ? new uint8_t[nCapacity] : nullptr;
+        pslots = nCapacity ? static_cast<value_type*>(::operator new(nCapacity * sizeof(value_type))) : nullptr;
+        std::fill(pctrl, pctrl + nCapacity, (uint8_t)CTRL_EMPTY);
+        nSize = 0;
+        nDeleted = 0;
+    }
+
+    void Release()
+    {
+        for (size_t i = 0; i < nCapacity; i++) {
+            if (IsFull(pctrl[i]))
+                pslots[i].~value_type();
+        }
+        delete[] pctrl;
+        ::operator delete(pslots);
+        pctrl = nullptr;
+        pslots = nullptr;
+        nCapacity = 0;
+        nSize = 0;
+        nDeleted = 0;
+    }
+
+    /** Move all entries into new storage, which also drops the tombstones */
+    void Rehash(size_t nCapacityNew)
+    {
+        uint8_t* pctrlOld = pctrl;
+        value_type* pslotsOld = pslots;
+        size_t nCapacityOld = nCapacity;
+        size_t nSizeOld = nSize;
+        Allocate(nCapacityNew);
+        for (size_t i = 0; i < nCapacityOld; i++) {
+            if (!IsFull(pctrlOld[i]))
+                continue;
+            size_t nHash = hasher(pslotsOld[i].first);
+            size_t j = FindFreeSlot(nHash);
+            new (&pslots[j]) value_type(std::move(pslotsOld[i]));
+            pctrl[j] = GetTag(nHash);
+            pslotsOld[i].~value_type();
+        }
+        nSize = nSizeOld;
+        delete[] pctrlOld;
+        ::operator delete(pslotsOld);
+    }
+
+    /** Make sure there is room for one more entry */
+    void ReserveOne()
+    {
+        if ((nSize + nDeleted + 1) * MAX_LOAD_DEN <= nCapacity * MAX_LOAD_NUM)
+            return;
+        // grow if the map would be more than half full without the tombstones, otherwise only drop those
+        if ((nSize + 1) * MAX_LOAD_DEN * 2 > nCapacity * MAX_LOAD_NUM) {
+            Rehash(std::max<size_t>(MIN_CAPACITY, nCapacity * 2));
+        } else {
+            Rehash(nCapacity);
+        }
+    }
+
+    template <bool IsConst>
+    class iterator_base
+    {
+    private:
+        friend class flat_hash_map;
+        template <bool> friend class iterator_base;
+        typedef typename std::conditional<IsConst, const flat_hash_map, flat_hash_map>::type map_type;
+
+        map_type* pmap;
+        size_t nPos;
+
+        iterator_base(map_type* pmapIn, size_t nPosIn) : pmap(pmapIn), nPos(nPosIn) {}
+
+        iterator_base& SkipFree()
+        {
+            while (nPos < pmap->nCapacity && !IsFull(pmap->pctrl[nPos])) {
+                nPos++;
+            }
+            return *this;
+        }
+
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef typename flat_hash_map::value_type value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef typename std::conditional<IsConst, const value_type*, value_type*>::type pointer;
+        typedef typename std::conditional<IsConst, const value_type&, value_type&>::type reference;
+
+        iterator_base() : pmap(nullptr), nPos(0) {}
+        // iterator to const_iterator, a copy for iterator itself
+        iterator_base(const iterator_base<false>& other) : pmap(other.pmap), nPos(other.nPos) {}
+
+        reference operator*() const { return pmap->pslots[nPos]; }
+        pointer operator->() const { return &pmap->pslots[nPos]; }
+        iterator_base& operator++() { nPos++; return SkipFree(); }
+        iterator_base operator++(int) { iterator_base ret = *this; ++*this; return ret; }
+        bool operator==(const iterator_base& other) const { return nPos == other.nPos; }
+        bool operator!=(const iterator_base& other) const { return nPos != other.nPos; }
+    };
+
+public:
+    typedef iterator_base<false> iterator;
+    typedef iterator_base<true> const_iterator;
+
+    flat_hash_map() : pctrl(nullptr), pslots(nullptr), nCapacity(0), nSize(0), nDeleted(0) {}
+
+    flat_hash_map(const flat_hash_map& other) : hasher(other.hasher)
+    {
+        Allocate(other.nCapacity);
+        for (size_t i = 0; i < nCapacity; i++) {
+            if (IsFull(other.pctrl[i]))
+                new (&pslots[i]) value_type(other.pslots[i]);
+            pctrl[i] = other.pctrl[i];
+        }
+        nSize = other.nSize;
+        nDeleted = other.nDeleted;
+    }
+
+    flat_hash_map(flat_hash_map&& other) : flat_hash_map()
+    {
+        swap(other);
+    }
+
+    flat_hash_map& operator=(flat_hash_map other)
+    {
+        swap(other);
+        return *this;
+    }
+
+    ~flat_hash_map()
+    {
+        Release();
+    }
+
+    void swap(flat_hash_map& other)
+    {
+        std::swap(pctrl, other.pctrl);
+        std::swap(pslots, other.pslots);
+        std::swap(nCapacity, other.nCapacity);
+        std::swap(nSize, other.nSize);
+        std::swap(nDeleted, other.nDeleted);
+        std::swap(hasher, other.hasher);
+    }
+
+    iterator begin() { return iterator(this, 0).SkipFree(); }
+    iterator end() { return iterator(this, nCapacity); }
+    const_iterator begin() const { return const_iterator(this, 0).SkipFree(); }
+    const_iterator end() const { return const_iterator(this, nCapacity); }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+
+    bool empty() const { return nSize == 0; }
+    size_type size() const { return nSize; }
+    //! Number of slots, each of them takes sizeof(value_type) + 1 bytes
+    size_type capacity() const { return nCapacity; }
+
+    iterator find(const K& key) { return iterator(this, FindSlot(key, hasher(key))); }
+    const_iterator find(const K& key) const { return const_iterator(this, FindSlot(key, hasher(key))); }
+    size_type count(const K& key) const { return FindSlot(key, hasher(key)) != nCapacity; }
+
+    /** Constructs the entry up front like std::unordered_map may do, it's dropped if the key is there already */
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args)
+    {
+        value_type value(std::forward<Args>(args)...);
+        size_t nHash = hasher(value.first);
+        size_t i = FindSlot(value.first, nHash);
+        if (i != nCapacity)
+            return std::make_pair(iterator(this, i), false);
+
+        ReserveOne();
+        i = FindFreeSlot(nHash);
+        new (&pslots[i]) value_type(std::move(value));
+        if (pctrl[i] == CTRL_DELETED)
+            nDeleted--;
+        pctrl[i] = GetTag(nHash);
+        nSize++;
+        return std::make_pair(iterator(this, i), true);
+    }
+
+    std::pair<iterator, bool> insert(const value_type& value) { return emplace(value); }
+
+    T& operator[](const K& key)
+    {
+        iterator it = find(key);
+        if (it != end())
+            return it->second;
+        return emplace(std::piecewise_construct, std::forward_as_tuple(key), std::tuple<>()).first->second;
+    }
+
+    /** Returns the iterator following the erased entry */
+    iterator erase(const_iterator it)
+    {
+        size_t i = it.nPos;
+        pslots[i].~value_type();
+        nSize--;
+        // no probe sequence continues through a slot followed by an empty one
+        if (pctrl[(i + 1) & (nCapacity - 1)] == CTRL_EMPTY) {
+            pctrl[i] = CTRL_EMPTY;
+        } else {
+            pctrl[i] = CTRL_DELETED;
+            nDeleted++;
+        }
+        return ++iterator(this, i);
+    }
+
+    size_type erase(const K& key)
+    {
+        const_iterator it = find(key);
+        if (it == end())
+            return 0;
+        erase(it);
+        return 1;
+    }
+
+    void clear()
+    {
+        Release();
+    }
+};
+
+#endif // FLATHASHMAP_H
@@ -38,6 +38,7 @@ CGovernanceObject::CGovernanceObject() :
     fExpired(false),
     fUnparsable(false),
     mapCurrentMNVotes(),
+    voteTally(),
     cmmapOrphanVotes(),
     fileVotes()
 {
@@ -66,6 +67,7 @@ CGovernanceObject::CGovernanceObject(const uint256& nHashParentIn, int nRevision
     fExpired(false),
     fUnparsable(false),
     mapCurrentMNVotes(),
+    voteTally(),
     cmmapOrphanVotes(),
     fileVotes()
 {
@@ -94,6 +96,7 @@ CGovernanceObject::CGovernanceObject(const CGovernanceObject& other) :
     fExpired(other.fExpired),
     fUnparsable(other.fUnparsable),
     mapCurrentMNVotes(other.mapCurrentMNVotes),
+    voteTally(other.voteTally),
     cmmapOrphanVotes(other.cmmapOrphanVotes),
     fileVotes(other.fileVotes)
 {
@@ -102,7 +105,8 @@ CGovernanceObject::CGovernanceObject(const CGovernanceObject& other) :
 bool CGovernanceObject::ProcessVote(CNode* pfrom,
     const CGovernanceVote& vote,
     CGovernanceException& exception,
-    CConnman& connman)
+    CConnman& connman,
+    bool fSignatureChecked)
 {
     LOCK(cs);
 
@@ -195,7 +199,8 @@ bool CGovernanceObject::ProcessVote(CNode* pfrom,
     bool onlyVotingKeyAllowed = nObjectType == GOVERNANCE_OBJECT_PROPOSAL && vote.GetSignal() == VOTE_SIGNAL_FUNDING;
 
     // Finally check that the vote is actually valid (done last because of cost of signature verification)
-    if (!vote.IsValid(onlyVotingKeyAllowed)) {
+    bool fValid = fSignatureChecked ? vote.IsValidContent() : vote.IsValid(onlyVotingKeyAllowed);
+    if (!fValid) {
         std::ostringstream ostr;
         ostr << "CGovernanceObject::ProcessVote -- Invalid vote"
              << ", MN outpoint = " << vote.GetMasternodeOutpoint().ToStringShort()
@@ -217,7 +222,9 @@ bool CGovernanceObject::ProcessVote(CNode* pfrom,
         return false;
     }
 
+    voteTally.Add(eSignal, voteInstanceRef.eOutcome, -1);
     voteInstanceRef = vote_instance_t(vote.GetOutcome(), nVoteTimeUpdate, vote.GetTimestamp());
+    voteTally.Add(eSignal, voteInstanceRef.eOutcome, 1);
     fileVotes.AddVote(vote);
     fDirtyCache = true;
     return true;
@@ -231,6 +238,7 @@ void CGovernanceObject::ClearMasternodeVotes()
     while (it != mapCurrentMNVotes.end()) {
         if (!mnodeman.Has(it->first)) {
             fileVotes.RemoveVotesFromMasternode(it->first);
+            voteTally.Add(it->second, -1);
             mapCurrentMNVotes.erase(it++);
         } else {
             ++it;
@@ -262,6 +270,7 @@ std::set<uint256> CGovernanceObject::RemoveInvalidProposalVotes(const COutPoint&
         CGovernanceVote tmpVote(mnOutpoint, nParentHash, (vote_signal_enum_t)jt->first, jt->second.eOutcome);
         tmpVote.SetTime(jt->second.nCreationTime);
         if (removedVotes.count(tmpVote.GetHash())) {
+            voteTally.Add(jt->first, jt->second.eOutcome, -1);
             jt = it->second.mapInstances.erase(jt);
         } else {
             ++jt;
@@ -517,8 +526,8 @@ std::string CGovernanceObject::GetDataAsPlainString() const
 
 void CGovernanceObject::UpdateLocalValidity()
 {
-    LOCK(cs_main);
     // THIS DOES NOT CHECK COLLATERAL, THIS IS CHECKED UPON ORIGINAL ARRIVAL
+    // so no chain state is accessed and cs_main is not needed here
     fCachedLocalValidity = IsValidLocally(strLocalValidityError, false);
 };
 
@@ -725,16 +734,17 @@ bool CGovernanceObject::IsCollateralValid(std::string& strError, bool& fMissingC
 int CGovernanceObject::CountMatchingVotes(vote_signal_enum_t eVoteSignalIn, vote_outcome_enum_t eVoteOutcomeIn) const
 {
     LOCK(cs);
+    return voteTally.Get(eVoteSignalIn, eVoteOutcomeIn);
+}
 
-    int nCount = 0;
+void CGovernanceObject::RebuildVoteTally()
+{
+    LOCK(cs);
+
+    voteTally.Clear();
     for (const auto& votepair : mapCurrentMNVotes) {
-        const vote_rec_t& recVote = votepair.second;
-        vote_instance_m_cit it2 = recVote.mapInstances.find(eVoteSignalIn);
-        if (it2 != recVote.mapInstances.end() && it2->second.eOutcome == eVoteOutcomeIn) {
-            ++nCount;
-        }
+        voteTally.Add(votepair.second, 1);
     }
-    return nCount;
 }
 
 /**
@@ -877,6 +887,7 @@ std::vector<uint256> CGovernanceObject::RemoveOldVotes(unsigned int nMinTime)
         auto itVotePair = miRef.begin();
         while (itVotePair != miRef.end()) {
             if (itVotePair->second.nCreationTime < nMinTime) {
+                voteTally.Add(itVotePair->first, itVotePair->second.eOutcome, -1);
                 miRef.erase(itVotePair++);
             } else {
                 ++itVotePair;
@@ -102,6 +102,45 @@ struct vote_rec_t {
     }
 };
 
+/**
+* Running vote counts per (signal, outcome), kept in sync with the current
+* masternode votes so that tally queries don't have to rescan every vote
+*/
+struct vote_tally_t {
+    int nCounts[MAX_SUPPORTED_VOTE_SIGNAL + 1][VOTE_OUTCOME_ABSTAIN + 1];
+
+    vote_tally_t()
+    {
+        Clear();
+    }
+
+    void Clear()
+    {
+        memset(nCounts, 0, sizeof(nCounts));
+    }
+
+    void Add(int nSignal, vote_outcome_enum_t eOutcome, int nDelta)
+    {
+        if (nSignal <= VOTE_SIGNAL_NONE || nSignal > MAX_SUPPORTED_VOTE_SIGNAL) return;
+        if (eOutcome <= VOTE_OUTCOME_NONE || eOutcome > VOTE_OUTCOME_ABSTAIN) return;
+        nCounts[nSignal][eOutcome] += nDelta;
+    }
+
+    void Add(const vote_rec_t& voteRecord, int nDelta)
+    {
+        for (const auto& instancePair : voteRecord.mapInstances) {
+            Add(instancePair.first, instancePair.second.eOutcome, nDelta);
+        }
+    }
+
+    int Get(int nSignal, vote_outcome_enum_t eOutcome) const
+    {
+        if (nSignal <= VOTE_SIGNAL_NONE || nSignal > MAX_SUPPORTED_VOTE_SIGNAL) return 0;
+        if (eOutcome <= VOTE_OUTCOME_NONE || eOutcome > VOTE_OUTCOME_ABSTAIN) return 0;
+        return nCounts[nSignal][eOutcome];
+    }
+};
+
 /**
 * Governance Object
 *
@@ -182,6 +221,9 @@ private:
 
     vote_m_t mapCurrentMNVotes;
 
+    /// Vote counts derived from mapCurrentMNVotes, must be updated on every change to it
+    vote_tally_t voteTally;
+
     /// Limited map of votes orphaned by MN
     vote_cmm_t cmmapOrphanVotes;
 
@@ -256,6 +298,13 @@ public:
         return fileVotes;
     }
 
+    /// Number of masternodes with current votes on this object
+    size_t GetVoterCount() const
+    {
+        LOCK(cs);
+        return mapCurrentMNVotes.size();
+    }
+
     // Signature related functions
 
     void SetMasternodeOutpoint(const COutPoint& outpoint);
@@ -330,6 +379,9 @@ public:
             READWRITE(fExpired);
             READWRITE(mapCurrentMNVotes);
             READWRITE(fileVotes);
+            if (ser_action.ForRead()) {
+                RebuildVoteTally();
+            }
             LogPrint("gobject", "CGovernanceObject::SerializationOp hash = %s, vote count = %d\n", GetHash().ToString(), fileVotes.GetVoteCount());
         }
 
@@ -341,10 +393,12 @@ private:
     void LoadData();
     void GetData(UniValue& objResult);
 
+    /// fSignatureChecked means that the masternode and its signature were already verified by the caller
     bool ProcessVote(CNode* pfrom,
         const CGovernanceVote& vote,
         CGovernanceException& exception,
-        CConnman& connman);
+        CConnman& connman,
+        bool fSignatureChecked = false);
 
     /// Called when MN's which have voted on this object have been removed
     void ClearMasternodeVotes();
@@ -355,6 +409,9 @@ private:
 
     void CheckOrphanVotes(CConnman& connman);
 
+    /// Recalculate voteTally from scratch, e.g. after loading votes from disk
+    void RebuildVoteTally();
+
     // TODO can be removed after DIP3 is fully deployed
     std::vector<uint256> RemoveOldVotes(unsigned int nMinTime);
 };
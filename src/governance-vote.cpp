@@ -9,6 +9,8 @@
 #include "messagesigner.h"
 #include "util.h"
 
+#include "evo/deterministicmns.h"
+
 std::string CGovernanceVoting::ConvertOutcomeToString(vote_outcome_enum_t nOutcome)
 {
     static const std::map<vote_outcome_enum_t, std::string> mapOutcomeString = {
@@ -263,7 +265,7 @@ bool CGovernanceVote::CheckSignature(const CBLSPublicKey& pubKey) const
     return true;
 }
 
-bool CGovernanceVote::IsValid(bool useVotingKey) const
+bool CGovernanceVote::IsValidContent() const
 {
     if (nTime > GetAdjustedTime() + (60 * 60)) {
         LogPrint("gobject", "CGovernanceVote::IsValid -- vote is too far ahead of current time - %s - nTime %lli - Max Time %lli\n", GetHash().ToString(), nTime, GetAdjustedTime() + (60 * 60));
@@ -282,6 +284,15 @@ bool CGovernanceVote::IsValid(bool useVotingKey) const
         return false;
     }
 
+    return true;
+}
+
+bool CGovernanceVote::IsValid(bool useVotingKey) const
+{
+    if (!IsValidContent()) {
+        return false;
+    }
+
     masternode_info_t infoMn;
     if (!mnodeman.GetMasternodeInfo(masternodeOutpoint, infoMn)) {
         LogPrint("gobject", "CGovernanceVote::IsValid -- Unknown Masternode - %s\n", masternodeOutpoint.ToStringShort());
@@ -299,6 +310,25 @@ bool CGovernanceVote::IsValid(bool useVotingKey) const
     }
 }
 
+bool CGovernanceVote::IsValid(const CDeterministicMNList& mnList, bool useVotingKey) const
+{
+    if (!IsValidContent()) {
+        return false;
+    }
+
+    auto dmn = mnList.GetMNByCollateral(masternodeOutpoint);
+    if (!dmn || !mnList.IsMNValid(dmn)) {
+        LogPrint("gobject", "CGovernanceVote::IsValid -- Unknown Masternode - %s\n", masternodeOutpoint.ToStringShort());
+        return false;
+    }
+
+    if (useVotingKey) {
+        return CheckSignature(dmn->pdmnState->keyIDVoting);
+    } else {
+        return CheckSignature(dmn->pdmnState->pubKeyOperator);
+    }
+}
+
 bool operator==(const CGovernanceVote& vote1, const CGovernanceVote& vote2)
 {
     bool fResult = ((vote1.masternodeOutpoint == vote2.masternodeOutpoint) &&
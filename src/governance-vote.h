@@ -11,6 +11,7 @@
 
 class CGovernanceVote;
 class CConnman;
+class CDeterministicMNList;
 
 // INTENTION OF MASTERNODES REGARDING ITEM
 enum vote_outcome_enum_t {
@@ -94,13 +95,18 @@ public:
     }
 
     void SetSignature(const std::vector<unsigned char>& vchSigIn) { vchSig = vchSigIn; }
+    const std::vector<unsigned char>& GetSignature() const { return vchSig; }
 
     bool Sign(CKey& keyMasternode, CPubKey& pubKeyMasternode);
     bool Sign(const CKey& key, const CKeyID& keyID);
     bool CheckSignature(const CKeyID& keyID) const;
     bool Sign(const CBLSSecretKey& key);
     bool CheckSignature(const CBLSPublicKey& pubKey) const;
+    /// Checks which don't depend on the masternode list (time, signal and outcome)
+    bool IsValidContent() const;
     bool IsValid(bool useVotingKey) const;
+    /// Same as above but checks against a snapshot of the deterministic masternode list (DIP3 only)
+    bool IsValid(const CDeterministicMNList& mnList, bool useVotingKey) const;
     void Relay(CConnman& connman) const;
 
     const COutPoint& GetMasternodeOutpoint() const { return masternodeOutpoint; }
@@ -4,6 +4,49 @@
 
 #include "governance-votedb.h"
 
+#include <cmath>
+#include <limits>
+
+const size_t CGovernanceVoteSummary::MAX_BUCKETS;
+
+size_t CGovernanceVoteSummary::GetBucketCountFor(size_t nVoteCount, size_t nExpectedMissing)
+{
+    // the peer announces all of its votes anyway
+    if (nVoteCount == 0) {
+        return 0;
+    }
+
+    // Every bucket costs BUCKET_SIZE bytes, and our votes are announced back to us when they share a bucket
+    // with two or more missing votes. With the missing votes spread evenly over the buckets, that happens to
+    // a share of 1 - e^-x * (1 + x) of them, x being the missing votes per bucket. Take the cheapest count.
+    double nMissing = std::max(nExpectedMissing, size_t(1));
+    size_t nBestBuckets = 1;
+    double nBestCost = std::numeric_limits<double>::max();
+    for (size_t nBuckets = 1; nBuckets <= MAX_BUCKETS; nBuckets <<= 1) {
+        double nPerBucket = nMissing / nBuckets;
+        double nCost = nBuckets * BUCKET_SIZE + nVoteCount * (1 - std::exp(-nPerBucket) * (1 + nPerBucket)) * INV_SIZE;
+        if (nCost < nBestCost) {
+            nBestBuckets = nBuckets;
+            nBestCost = nCost;
+        }
+    }
+    return nBestBuckets;
+}
+
+bool CGovernanceVoteSummary::IsValid() const
+{
+    size_t nBuckets = vecBuckets.size();
+    return nBuckets <= MAX_BUCKETS && (nBuckets & (nBuckets - 1)) == 0;
+}
+
+void CGovernanceVoteSummary::Add(const uint256& nHash)
+{
+    uint64_t nVoteHash = GetVoteHash(nHash);
+    bucket_t& bucket = vecBuckets[GetBucketIndex(nVoteHash)];
+    ++bucket.nCount;
+    bucket.nChecksum ^= GetChecksum(nVoteHash);
+}
+
 CGovernanceObjectVoteFile::CGovernanceObjectVoteFile() :
     nMemoryVotes(0),
     listVotes(),
@@ -54,6 +97,61 @@ std::vector<CGovernanceVote> CGovernanceObjectVoteFile::GetVotes() const
     return vecResult;
 }
 
+CGovernanceVoteSummary CGovernanceObjectVoteFile::GetVoteSummary(size_t nBuckets, uint64_t nSalt) const
+{
+    CGovernanceVoteSummary summary(nBuckets, nSalt);
+    if (!summary.IsValid() || nBuckets == 0) {
+        return summary;
+    }
+    for (const auto& indexPair : mapVoteIndex) {
+        summary.Add(indexPair.first);
+    }
+    return summary;
+}
+
+std::vector<CGovernanceVote> CGovernanceObjectVoteFile::GetVotesNotMatchingSummary(const CGovernanceVoteSummary& summary) const
+{
+    std::vector<CGovernanceVote> vecResult;
+    if (!summary.IsValid()) {
+        return vecResult;
+    }
+    if (summary.GetBucketCount() == 0) {
+        return GetVotes();
+    }
+
+    CGovernanceVoteSummary localSummary = GetVoteSummary(summary.GetBucketCount(), summary.GetSalt());
+
+    // Buckets with exactly one vote more than the peer's only need the vote with the differing checksum.
+    // If the peer has votes we don't, none of ours may match, then the whole bucket is announced.
+    std::vector<bool> vecSingleFound(summary.GetBucketCount(), false);
+    std::vector<std::pair<size_t, vote_l_cit> > vecRest;
+    for (const auto& indexPair : mapVoteIndex) {
+        uint64_t nVoteHash = localSummary.GetVoteHash(indexPair.first);
+        size_t nIndex = localSummary.GetBucketIndex(nVoteHash);
+        const CGovernanceVoteSummary::bucket_t& bucketLocal = localSummary.GetBucket(nIndex);
+        const CGovernanceVoteSummary::bucket_t& bucketPeer = summary.GetBucket(nIndex);
+        if (bucketLocal == bucketPeer) {
+            continue;
+        }
+        if (uint8_t(bucketLocal.nCount - bucketPeer.nCount) == 1) {
+            if (CGovernanceVoteSummary::GetChecksum(nVoteHash) == (bucketLocal.nChecksum ^ bucketPeer.nChecksum)) {
+                vecSingleFound[nIndex] = true;
+                vecResult.push_back(*indexPair.second);
+            } else {
+                vecRest.emplace_back(nIndex, indexPair.second);
+            }
+            continue;
+        }
+        vecResult.push_back(*indexPair.second);
+    }
+    for (const auto& restPair : vecRest) {
+        if (!vecSingleFound[restPair.first]) {
+            vecResult.push_back(*restPair.second);
+        }
+    }
+    return vecResult;
+}
+
 void CGovernanceObjectVoteFile::RemoveVotesFromMasternode(const COutPoint& outpointMasternode)
 {
     vote_l_it it = listVotes.begin();
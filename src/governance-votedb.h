@@ -9,10 +9,115 @@
 #include <map>
 
 #include "governance-vote.h"
+#include "hash.h"
 #include "serialize.h"
 #include "streams.h"
 #include "uint256.h"
 
+/**
+ * Compact summary of a set of vote hashes, used to reconcile votes between peers.
+ *
+ * Vote hashes are mapped into a power of two number of buckets with a salted SipHash.
+ * Every bucket stores the number of votes in it (modulo 256) and the XOR of 24 bits of their SipHashes.
+ * A peer receiving a summary only has to announce the votes which fall into buckets
+ * whose count or checksum differ from its own. When it has exactly one vote more in a bucket,
+ * the checksums differ by that vote alone, so only that one is announced.
+ * A summary without buckets stands for an empty vote set.
+ */
+class CGovernanceVoteSummary
+{
+public: // Types
+    struct bucket_t {
+        uint8_t nCount;
+        uint32_t nChecksum;
+
+        bucket_t() :
+            nCount(0),
+            nChecksum(0)
+        {
+        }
+
+        bool operator==(const bucket_t& other) const
+        {
+            return nCount == other.nCount && nChecksum == other.nChecksum;
+        }
+
+        bool operator!=(const bucket_t& other) const
+        {
+            return !(*this == other);
+        }
+
+        template <typename Stream>
+        void Serialize(Stream& s) const
+        {
+            ser_writedata32(s, nCount | (nChecksum << 8));
+        }
+
+        template <typename Stream>
+        void Unserialize(Stream& s)
+        {
+            uint32_t nPacked = ser_readdata32(s);
+            nCount = nPacked & 0xff;
+            nChecksum = nPacked >> 8;
+        }
+    };
+
+public:
+    static const size_t MAX_BUCKETS = 4096;
+    /// Serialized size of a bucket
+    static const size_t BUCKET_SIZE = 4;
+    /// Serialized size of the inv a peer announces a vote with
+    static const size_t INV_SIZE = 36;
+
+private:
+    uint64_t nSalt;
+    std::vector<bucket_t> vecBuckets;
+
+public:
+    CGovernanceVoteSummary() :
+        nSalt(0),
+        vecBuckets()
+    {
+    }
+
+    CGovernanceVoteSummary(size_t nBucketsIn, uint64_t nSaltIn) :
+        nSalt(nSaltIn),
+        vecBuckets(nBucketsIn)
+    {
+    }
+
+    /// Pick the number of buckets for a set of nVoteCount votes which probably lacks nExpectedMissing votes of the peer
+    static size_t GetBucketCountFor(size_t nVoteCount, size_t nExpectedMissing);
+
+    /// Buckets must be a power of two not exceeding MAX_BUCKETS, or none at all
+    bool IsValid() const;
+
+    void Add(const uint256& nHash);
+
+    /// Salted hash of a vote, which selects its bucket and checksum
+    uint64_t GetVoteHash(const uint256& nHash) const { return SipHashUint256(nSalt, 0, nHash); }
+
+    /// Bucket index of the vote with this salted hash, summary must be valid and have buckets
+    size_t GetBucketIndex(uint64_t nVoteHash) const { return nVoteHash & (vecBuckets.size() - 1); }
+
+    static uint32_t GetChecksum(uint64_t nVoteHash) { return nVoteHash >> 40; }
+
+    uint64_t GetSalt() const { return nSalt; }
+
+    size_t GetBucketCount() const { return vecBuckets.size(); }
+
+    const bucket_t& GetBucket(size_t nIndex) const { return vecBuckets[nIndex]; }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(nSalt);
+        READWRITE(vecBuckets);
+    }
+};
+
 /**
  * Represents the collection of votes associated with a given CGovernanceObject
  * Recently received votes are held in memory until a maximum size is reached after
@@ -65,13 +170,24 @@ public:
      */
     bool SerializeVoteToStream(const uint256& nHash, CDataStream& ss) const;
 
-    int GetVoteCount()
+    int GetVoteCount() const
     {
         return nMemoryVotes;
     }
 
     std::vector<CGovernanceVote> GetVotes() const;
 
+    /**
+     * Summarize the votes in this file into nBuckets buckets (see CGovernanceVoteSummary)
+     */
+    CGovernanceVoteSummary GetVoteSummary(size_t nBuckets, uint64_t nSalt) const;
+
+    /**
+     * Return the votes which fall into buckets differing from the ones in the (remote) summary,
+     * or only the one the remote lacks if a bucket differs by a single vote
+     */
+    std::vector<CGovernanceVote> GetVotesNotMatchingSummary(const CGovernanceVoteSummary& summary) const;
+
     void RemoveVotesFromMasternode(const COutPoint& outpointMasternode);
     std::set<uint256> RemoveInvalidProposalVotes(const COutPoint& outpointMasternode);
 
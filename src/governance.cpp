@@ -16,6 +16,7 @@
 #include "net_processing.h"
 #include "netfulfilledman.h"
 #include "netmessagemaker.h"
+#include "sigverifyqueue.h"
 #include "util.h"
 #include "validationinterface.h"
 
@@ -30,6 +31,8 @@ const int CGovernanceManager::RELIABLE_PROPAGATION_TIME = 60;
 CGovernanceManager::CGovernanceManager() :
     nTimeLastDiff(0),
     nCachedBlockHeight(0),
+    nCachedMinVoteTime(-1),
+    nMinVoteTimeGeneration(0),
     mapObjects(),
     mapErasedGovernanceObjects(),
     mapMasternodeOrphanObjects(),
@@ -124,6 +127,33 @@ void CGovernanceManager::ProcessMessage(CNode* pfrom, const std::string& strComm
         LogPrint("gobject", "MNGOVERNANCESYNC -- syncing governance objects to our peer at %s\n", pfrom->addr.ToString());
     }
 
+    // ANOTHER USER IS ASKING US FOR THE VOTES OF A SINGLE OBJECT WHICH DON'T MATCH THEIR VOTE SUMMARY
+    else if (strCommand == NetMsgType::MNGOVERNANCESYNCSUMMARY) {
+        if (pfrom->nVersion < MIN_GOVERNANCE_PEER_PROTO_VERSION) {
+            LogPrint("gobject", "MNGOVERNANCESYNCSUMMARY -- peer=%d using obsolete version %i\n", pfrom->id, pfrom->nVersion);
+            connman.PushMessage(pfrom, CNetMsgMaker(pfrom->GetSendVersion()).Make(NetMsgType::REJECT, strCommand, REJECT_OBSOLETE, strprintf("Version must be %d or greater", MIN_GOVERNANCE_PEER_PROTO_VERSION)));
+            return;
+        }
+
+        // Ignore such requests until we are fully synced.
+        if (!masternodeSync.IsSynced()) return;
+
+        uint256 nProp;
+        CGovernanceVoteSummary summary;
+
+        vRecv >> nProp >> summary;
+
+        if (!summary.IsValid()) {
+            LogPrint("gobject", "MNGOVERNANCESYNCSUMMARY -- invalid vote summary with %d buckets, peer=%d\n", summary.GetBucketCount(), pfrom->id);
+            LOCK(cs_main);
+            Misbehaving(pfrom->GetId(), 20);
+            return;
+        }
+
+        SyncSingleObjAndItsVotes(pfrom, nProp, summary, connman);
+        LogPrint("gobject", "MNGOVERNANCESYNCSUMMARY -- syncing governance object votes to our peer at %s\n", pfrom->addr.ToString());
+    }
+
     // A NEW GOVERNANCE OBJECT HAS ARRIVED
     else if (strCommand == NetMsgType::MNGOVERNANCEOBJECT) {
         // MAKE SURE WE HAVE A VALID REFERENCE TO THE TIP BEFORE CONTINUING
@@ -256,22 +286,100 @@ void CGovernanceManager::ProcessMessage(CNode* pfrom, const std::string& strComm
             return;
         }
 
+        if (AsyncProcessVote(pfrom, vote, connman)) {
+            // will be finished by HandleVoteResult once the signature is verified
+            return;
+        }
+
         CGovernanceException exception;
-        if (ProcessVote(pfrom, vote, exception, connman)) {
-            LogPrint("gobject", "MNGOVERNANCEOBJECTVOTE -- %s new\n", strHash);
-            masternodeSync.BumpAssetLastTime("MNGOVERNANCEOBJECTVOTE");
-            vote.Relay(connman);
+        bool fAccepted = ProcessVote(pfrom, vote, exception, connman);
+        HandleVoteResult(pfrom, vote, fAccepted, exception, connman);
+    }
+}
+
+bool CGovernanceManager::AsyncProcessVote(CNode* pfrom, const CGovernanceVote& vote, CConnman& connman)
+{
+    if (!sigVerifyQueue.IsRunning()) {
+        return false;
+    }
+
+    uint256 nHashVote = vote.GetHash();
+    bool fOnlyVotingKeyAllowed;
+    {
+        LOCK(cs);
+        // known and invalid votes, votes for unknown (orphan) and deleted objects are cheap to reject
+        // and are handled by ProcessVote directly
+        if (cmapVoteToObject.HasKey(nHashVote) || cmapInvalidVotes.HasKey(nHashVote)) {
+            return false;
+        }
+        object_m_it it = mapObjects.find(vote.GetParentHash());
+        if (it == mapObjects.end() || it->second.IsSetCachedDelete() || it->second.IsSetExpired()) {
+            return false;
+        }
+        fOnlyVotingKeyAllowed = it->second.GetObjectType() == GOVERNANCE_OBJECT_PROPOSAL && vote.GetSignal() == VOTE_SIGNAL_FUNDING;
+    }
+
+    CKeyID keyID;
+    CBLSPublicKey blsPubKey;
+    if (deterministicMNManager->IsDeterministicMNsSporkActive()) {
+        auto mnList = deterministicMNManager->GetListAtChainTip();
+        auto dmn = mnList.GetMNByCollateral(vote.GetMasternodeOutpoint());
+        if (!dmn || !mnList.IsMNValid(dmn)) {
+            return false;
+        }
+        if (fOnlyVotingKeyAllowed) {
+            keyID = dmn->pdmnState->keyIDVoting;
         } else {
-            LogPrint("gobject", "MNGOVERNANCEOBJECTVOTE -- Rejected vote, error = %s\n", exception.what());
-            if ((exception.GetNodePenalty() != 0) && masternodeSync.IsSynced()) {
-                LOCK(cs_main);
-                Misbehaving(pfrom->GetId(), exception.GetNodePenalty());
-            }
-            return;
+            blsPubKey = dmn->pdmnState->pubKeyOperator;
+        }
+    } else {
+        masternode_info_t infoMn;
+        if (!mnodeman.GetMasternodeInfo(vote.GetMasternodeOutpoint(), infoMn)) {
+            return false;
+        }
+        keyID = fOnlyVotingKeyAllowed ? infoMn.keyIDVoting : infoMn.legacyKeyIDOperator;
+    }
+
+    // keep pfrom alive until the vote is processed
+    pfrom->AddRef();
+    auto doneCallback = [this, pfrom, vote, &connman](bool fSignatureValid) {
+        // votes with bad signatures go through the full checks again, so they are rejected the usual way
+        CGovernanceException exception;
+        bool fAccepted = ProcessVote(pfrom, vote, exception, connman, fSignatureValid);
+        HandleVoteResult(pfrom, vote, fAccepted, exception, connman);
+        pfrom->Release();
+    };
+
+    bool fQueued;
+    if (blsPubKey.IsValid()) {
+        CBLSSignature sig;
+        sig.SetBuf(vote.GetSignature());
+        fQueued = sigVerifyQueue.AsyncVerifyBLS(sig, blsPubKey, vote.GetSignatureHash(), std::move(doneCallback));
+    } else {
+        fQueued = sigVerifyQueue.AsyncVerify([vote, keyID]() { return vote.CheckSignature(keyID); }, std::move(doneCallback));
+    }
+    if (!fQueued) {
+        pfrom->Release();
+    }
+    return fQueued;
+}
+
+void CGovernanceManager::HandleVoteResult(CNode* pfrom, const CGovernanceVote& vote, bool fAccepted, const CGovernanceException& exception, CConnman& connman)
+{
+    if (!fAccepted) {
+        LogPrint("gobject", "MNGOVERNANCEOBJECTVOTE -- Rejected vote, error = %s\n", exception.what());
+        if ((exception.GetNodePenalty() != 0) && masternodeSync.IsSynced()) {
+            LOCK(cs_main);
+            Misbehaving(pfrom->GetId(), exception.GetNodePenalty());
         }
-        // SEND NOTIFICATION TO SCRIPT/ZMQ
-        GetMainSignals().NotifyGovernanceVote(vote);
+        return;
     }
+
+    LogPrint("gobject", "MNGOVERNANCEOBJECTVOTE -- %s new\n", vote.GetHash().ToString());
+    masternodeSync.BumpAssetLastTime("MNGOVERNANCEOBJECTVOTE");
+    vote.Relay(connman);
+    // SEND NOTIFICATION TO SCRIPT/ZMQ
+    GetMainSignals().NotifyGovernanceVote(vote);
 }
 
 void CGovernanceManager::CheckOrphanVotes(CGovernanceObject& govobj, CGovernanceException& exception, CConnman& connman)
@@ -378,7 +486,8 @@ void CGovernanceManager::UpdateCachesAndClean()
 
     std::vector<uint256> vecDirtyHashes = mnodeman.GetAndClearDirtyGovernanceObjectHashes();
 
-    LOCK2(cs_main, cs);
+    // Nothing here reads chain state, so don't stall block validation by holding cs_main
+    LOCK(cs);
 
     for (const uint256& nHash : vecDirtyHashes) {
         object_m_it it = mapObjects.find(nHash);
@@ -649,6 +758,16 @@ bool CGovernanceManager::ConfirmInventoryRequest(const CInv& inv)
 }
 
 void CGovernanceManager::SyncSingleObjAndItsVotes(CNode* pnode, const uint256& nProp, const CBloomFilter& filter, CConnman& connman)
+{
+    SyncSingleObjAndItsVotes(pnode, nProp, &filter, nullptr, connman);
+}
+
+void CGovernanceManager::SyncSingleObjAndItsVotes(CNode* pnode, const uint256& nProp, const CGovernanceVoteSummary& summary, CConnman& connman)
+{
+    SyncSingleObjAndItsVotes(pnode, nProp, nullptr, &summary, connman);
+}
+
+void CGovernanceManager::SyncSingleObjAndItsVotes(CNode* pnode, const uint256& nProp, const CBloomFilter* pFilter, const CGovernanceVoteSummary* pSummary, CConnman& connman)
 {
     // do not provide any data until our node is synced
     if (!masternodeSync.IsSynced()) return;
@@ -659,7 +778,15 @@ void CGovernanceManager::SyncSingleObjAndItsVotes(CNode* pnode, const uint256& n
 
     LogPrint("gobject", "CGovernanceManager::%s -- syncing single object to peer=%d, nProp = %s\n", __func__, pnode->id, nProp.ToString());
 
-    LOCK2(cs_main, cs);
+    // Validate votes against a snapshot of the deterministic masternode list
+    // instead of locking mnodeman for every single vote
+    bool fDIP3Active = deterministicMNManager->IsDeterministicMNsSporkActive();
+    CDeterministicMNList mnList;
+    if (fDIP3Active) {
+        mnList = deterministicMNManager->GetListAtChainTip();
+    }
+
+    LOCK(cs);
 
     // single valid object and its valid votes
     object_m_it it = mapObjects.find(nProp);
@@ -682,14 +809,21 @@ void CGovernanceManager::SyncSingleObjAndItsVotes(CNode* pnode, const uint256& n
     LogPrint("gobject", "CGovernanceManager::%s -- syncing govobj: %s, peer=%d\n", __func__, strHash, pnode->id);
     pnode->PushInventory(CInv(MSG_GOVERNANCE_OBJECT, it->first));
 
-    auto fileVotes = govobj.GetVoteFile();
+    const CGovernanceObjectVoteFile& fileVotes = govobj.GetVoteFile();
+
+    // with a vote summary only votes from the differing buckets are announced,
+    // with a bloom filter all votes which are not in it
+    std::vector<CGovernanceVote> vecVotes = pSummary ? fileVotes.GetVotesNotMatchingSummary(*pSummary) : fileVotes.GetVotes();
 
-    for (const auto& vote : fileVotes.GetVotes()) {
+    for (const auto& vote : vecVotes) {
         uint256 nVoteHash = vote.GetHash();
 
         bool onlyVotingKeyAllowed = govobj.GetObjectType() == GOVERNANCE_OBJECT_PROPOSAL && vote.GetSignal() == VOTE_SIGNAL_FUNDING;
 
-        if (filter.contains(nVoteHash) || !vote.IsValid(onlyVotingKeyAllowed)) {
+        if (pFilter && pFilter->contains(nVoteHash)) {
+            continue;
+        }
+        if (fDIP3Active ? !vote.IsValid(mnList, onlyVotingKeyAllowed) : !vote.IsValid(onlyVotingKeyAllowed)) {
             continue;
         }
         pnode->PushInventory(CInv(MSG_GOVERNANCE_OBJECT_VOTE, nVoteHash));
@@ -723,7 +857,7 @@ void CGovernanceManager::SyncAll(CNode* pnode, CConnman& connman) const
 
     LogPrint("gobject", "CGovernanceManager::%s -- syncing all objects to peer=%d\n", __func__, pnode->id);
 
-    LOCK2(cs_main, cs);
+    LOCK(cs);
 
     // all valid objects, no votes
     for (const auto& objPair : mapObjects) {
@@ -843,7 +977,7 @@ bool CGovernanceManager::MasternodeRateCheck(const CGovernanceObject& govobj, bo
     return false;
 }
 
-bool CGovernanceManager::ProcessVote(CNode* pfrom, const CGovernanceVote& vote, CGovernanceException& exception, CConnman& connman)
+bool CGovernanceManager::ProcessVote(CNode* pfrom, const CGovernanceVote& vote, CGovernanceException& exception, CConnman& connman, bool fSignatureChecked)
 {
     ENTER_CRITICAL_SECTION(cs);
     uint256 nHashVote = vote.GetHash();
@@ -892,14 +1026,14 @@ bool CGovernanceManager::ProcessVote(CNode* pfrom, const CGovernanceVote& vote,
         return false;
     }
 
-    bool fOk = govobj.ProcessVote(pfrom, vote, exception, connman) && cmapVoteToObject.Insert(nHashVote, &govobj);
+    bool fOk = govobj.ProcessVote(pfrom, vote, exception, connman, fSignatureChecked) && cmapVoteToObject.Insert(nHashVote, &govobj);
     LEAVE_CRITICAL_SECTION(cs);
     return fOk;
 }
 
 void CGovernanceManager::CheckMasternodeOrphanVotes(CConnman& connman)
 {
-    LOCK2(cs_main, cs);
+    LOCK(cs);
 
     ScopedLockBool guard(cs, fRateChecksEnabled, false);
 
@@ -1023,6 +1157,29 @@ void CGovernanceManager::RequestGovernanceObject(CNode* pfrom, const uint256& nH
         return;
     }
 
+    if (fUseFilter && pfrom->fGovernanceSyncSummary) {
+        // peer can reconcile votes against a summary of the votes we already have,
+        // which is much smaller than a bloom filter and makes it skip most known votes
+        CGovernanceVoteSummary summary(0, GetRand(std::numeric_limits<uint64_t>::max()));
+        // every masternode we have no votes from yet probably cast as many votes as the others did
+        size_t nMnCount = std::max(mnodeman.CountEnabled(), 0);
+        {
+            LOCK(cs);
+            CGovernanceObject* pObj = FindGovernanceObject(nHash);
+            if (pObj) {
+                const CGovernanceObjectVoteFile& fileVotes = pObj->GetVoteFile();
+                size_t nVoteCount = fileVotes.GetVoteCount();
+                size_t nVoterCount = pObj->GetVoterCount();
+                size_t nExpectedMissing = nMnCount > nVoterCount ? (nMnCount - nVoterCount) * std::max(nVoteCount / std::max(nVoterCount, size_t(1)), size_t(1)) : 0;
+                summary = fileVotes.GetVoteSummary(CGovernanceVoteSummary::GetBucketCountFor(nVoteCount, nExpectedMissing), summary.GetSalt());
+            }
+        }
+
+        LogPrint("gobject", "CGovernanceManager::RequestGovernanceObject -- nHash %s nBuckets %d peer=%d\n", nHash.ToString(), summary.GetBucketCount(), pfrom->id);
+        connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::MNGOVERNANCESYNCSUMMARY, nHash, summary));
+        return;
+    }
+
     CBloomFilter filter;
     filter.clear();
 
@@ -1078,7 +1235,7 @@ int CGovernanceManager::RequestGovernanceObjectVotes(const std::vector<CNode*>&
     }
 
     {
-        LOCK2(cs_main, cs);
+        LOCK(cs);
 
         if (mapObjects.empty()) return -2;
 
@@ -1302,6 +1459,8 @@ void CGovernanceManager::UpdatedBlockTip(const CBlockIndex* pindex, CConnman& co
     nCachedBlockHeight = pindex->nHeight;
     LogPrint("gobject", "CGovernanceManager::UpdatedBlockTip -- nCachedBlockHeight: %d\n", nCachedBlockHeight);
 
+    ResetMinVoteTime();
+
     if (deterministicMNManager->IsDeterministicMNsSporkActive(pindex->nHeight)) {
         ClearPreDIP3Votes();
         RemoveInvalidProposalVotes();
@@ -1398,14 +1557,45 @@ void CGovernanceManager::RemoveInvalidProposalVotes()
 }
 
 
+void CGovernanceManager::ResetMinVoteTime()
+{
+    // recalculate on next use
+    LOCK(csMinVoteTime);
+    nCachedMinVoteTime = -1;
+    ++nMinVoteTimeGeneration;
+}
+
 unsigned int CGovernanceManager::GetMinVoteTime()
 {
-    LOCK(cs_main);
-    if (!deterministicMNManager->IsDeterministicMNsSporkActive()) {
-        return 0;
+    // This is called for every incoming vote, avoid taking cs_main unless the tip changed
+    uint64_t nGeneration;
+    {
+        LOCK(csMinVoteTime);
+        if (nCachedMinVoteTime >= 0) {
+            return nCachedMinVoteTime;
+        }
+        nGeneration = nMinVoteTimeGeneration;
+    }
+
+    int64_t nMinVoteTime;
+    {
+        LOCK(cs_main);
+        if (!deterministicMNManager->IsDeterministicMNsSporkActive()) {
+            nMinVoteTime = 0;
+        } else {
+            int64_t dip3SporkHeight = sporkManager.GetSporkValue(SPORK_15_DETERMINISTIC_MNS_ENABLED);
+            nMinVoteTime = chainActive[dip3SporkHeight]->nTime;
+        }
+    }
+
+    {
+        LOCK(csMinVoteTime);
+        // a reset while we were calculating may have made the result stale
+        if (nGeneration == nMinVoteTimeGeneration) {
+            nCachedMinVoteTime = nMinVoteTime;
+        }
     }
-    int64_t dip3SporkHeight = sporkManager.GetSporkValue(SPORK_15_DETERMINISTIC_MNS_ENABLED);
-    return chainActive[dip3SporkHeight]->nTime;
+    return nMinVoteTime;
 }
 
 void CGovernanceManager::ClearPreDIP3Votes()
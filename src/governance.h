@@ -235,6 +235,13 @@ private:
     // keep track of current block height
     int nCachedBlockHeight;
 
+    // result of GetMinVoteTime, reset on every new tip and SPORK_15 update, -1 if not calculated yet
+    int64_t nCachedMinVoteTime;
+    // bumped on every reset of nCachedMinVoteTime, results calculated before a reset are dropped
+    uint64_t nMinVoteTimeGeneration;
+    // protects nCachedMinVoteTime and nMinVoteTimeGeneration, never held while calculating
+    CCriticalSection csMinVoteTime;
+
     // keep track of the scanning errors
     object_m_t mapObjects;
 
@@ -302,6 +309,7 @@ public:
     bool ConfirmInventoryRequest(const CInv& inv);
 
     void SyncSingleObjAndItsVotes(CNode* pnode, const uint256& nProp, const CBloomFilter& filter, CConnman& connman);
+    void SyncSingleObjAndItsVotes(CNode* pnode, const uint256& nProp, const CGovernanceVoteSummary& summary, CConnman& connman);
     void SyncAll(CNode* pnode, CConnman& connman) const;
 
     void ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman);
@@ -364,6 +372,8 @@ public:
     }
 
     void UpdatedBlockTip(const CBlockIndex* pindex, CConnman& connman);
+    /// Forget the minimum vote time, the SPORK_15 height or the chain it depends on changed
+    void ResetMinVoteTime();
     int64_t GetLastDiffTime() const { return nTimeLastDiff; }
     void UpdateLastDiffTime(int64_t nTimeIn) { nTimeLastDiff = nTimeIn; }
 
@@ -423,6 +433,8 @@ public:
     int RequestGovernanceObjectVotes(const std::vector<CNode*>& vNodesCopy, CConnman& connman);
 
 private:
+    void SyncSingleObjAndItsVotes(CNode* pnode, const uint256& nProp, const CBloomFilter* pFilter, const CGovernanceVoteSummary* pSummary, CConnman& connman);
+
     void RequestGovernanceObject(CNode* pfrom, const uint256& nHash, CConnman& connman, bool fUseFilter = false);
 
     void AddInvalidVote(const CGovernanceVote& vote)
@@ -435,7 +447,14 @@ private:
         cmmapOrphanVotes.Insert(vote.GetHash(), vote_time_pair_t(vote, GetAdjustedTime() + GOVERNANCE_ORPHAN_EXPIRATION_TIME));
     }
 
-    bool ProcessVote(CNode* pfrom, const CGovernanceVote& vote, CGovernanceException& exception, CConnman& connman);
+    bool ProcessVote(CNode* pfrom, const CGovernanceVote& vote, CGovernanceException& exception, CConnman& connman, bool fSignatureChecked = false);
+
+    /// Queues the signature check of a vote in sigVerifyQueue, processing continues from a verification thread.
+    /// Returns false if the vote must be processed synchronously.
+    bool AsyncProcessVote(CNode* pfrom, const CGovernanceVote& vote, CConnman& connman);
+
+    /// Relays and announces accepted votes, punishes peers which sent invalid ones
+    void HandleVoteResult(CNode* pfrom, const CGovernanceVote& vote, bool fAccepted, const CGovernanceException& exception, CConnman& connman);
 
     /// Called to indicate a requested object has been received
     bool AcceptObjectMessage(const uint256& nHash);
@@ -110,6 +110,8 @@ public:
     uint256 GetID() const { return id; }
 
     uint256 GetSeedHash();
+    /// Derives the key at m/purpose'/coin_type'/account'/change which all keys of that chain are derived from
+    void DeriveChangeExtKey(uint32_t nAccountIndex, bool fInternal, CExtKey& extKeyRet) const;
     void DeriveChildExtKey(uint32_t nAccountIndex, bool fInternal, uint32_t nChildIndex, CExtKey& extKeyRet);
 
     void AddAccount();
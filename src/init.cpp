@@ -63,6 +63,7 @@
 #include "privatesend-client.h"
 #endif // ENABLE_WALLET
 #include "privatesend-server.h"
+#include "sigverifyqueue.h"
 #include "spork.h"
 #include "warnings.h"
 
@@ -254,6 +255,8 @@ void PrepareShutdown()
         pwalletMain->Flush(false);
 #endif
     MapPort(false);
+    // finish all pending signature checks while the nodes they refer to are still around
+    sigVerifyQueue.Stop();
     UnregisterValidationInterface(peerLogic.get());
     peerLogic.reset();
     if (g_connman) {
@@ -296,6 +299,11 @@ void PrepareShutdown()
         fFeeEstimatesInitialized = false;
     }
 
+    // no block can be connected anymore, the prefetch threads must be gone before pcoinsTip is
+    StopCoinsPrefetchThreads();
+    // ThreadImport was joined before Shutdown
+    StopBlockImportThreads();
+
     {
         LOCK(cs_main);
         if (pcoinsTip != NULL) {
@@ -303,6 +311,8 @@ void PrepareShutdown()
         }
         delete pcoinsTip;
         pcoinsTip = NULL;
+        delete pcoinsflushview;
+        pcoinsflushview = NULL;
         delete pcoinscatcher;
         pcoinscatcher = NULL;
         delete pcoinsdbview;
@@ -454,6 +464,8 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-blockreconstructionextratxn=<n>", strprintf(_("Extra transactions to keep in memory for compact block reconstructions (default: %u)"), DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN));
     strUsage += HelpMessageOpt("-par=<n>", strprintf(_("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
         -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS));
+    strUsage += HelpMessageOpt("-sigverifythreads=<n>", strprintf(_("Set the number of threads verifying masternode and governance message signatures (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
+        -GetNumCores(), MAX_SIGVERIFY_THREADS, DEFAULT_SIGVERIFY_THREADS));
 #ifndef WIN32
     strUsage += HelpMessageOpt("-pid=<file>", strprintf(_("Specify pid file (default: %s)"), BITCOIN_PID_FILENAME));
 #endif
@@ -534,6 +546,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-zmqpubrawtx=<address>", _("Enable publish raw transaction in <address>"));
     strUsage += HelpMessageOpt("-zmqpubrawtxlock=<address>", _("Enable publish raw transaction (locked via InstantSend) in <address>"));
     strUsage += HelpMessageOpt("-zmqpubrawinstantsenddoublespend=<address>", _("Enable publish raw transactions of attempted InstantSend double spend in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubtxlocklatency=<address>", _("Enable publish hash and lock latency of transactions locked via InstantSend in <address>"));
 #endif
 
     strUsage += HelpMessageGroup(_("Debugging/Testing options:"));
@@ -557,7 +570,7 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-bip9params=deployment:start:end", "Use given start/end times for specified BIP9 deployment (regtest-only)");
     }
     std::string debugCategories = "addrman, alert, bench, cmpctblock, coindb, db, http, leveldb, libevent, lock, mempool, mempoolrej, net, proxy, prune, rand, reindex, rpc, selectcoins, tor, zmq, "
-                                  "polis (or specifically: gobject, instantsend, keepass, masternode, mnpayments, mnsync, privatesend, spork)"; // Don't translate these and qt below
+                                  "polis (or specifically: gobject, instantsend, keepass, masternode, mnpayments, mnsync, privatesend, sigverify, spork, staking)"; // Don't translate these and qt below
     if (mode == HMM_BITCOIN_QT)
         debugCategories += ", qt";
     strUsage += HelpMessageOpt("-debug=<category>", strprintf(_("Output debugging information (default: %u, supplying <category> is optional)"), 0) + ". " +
@@ -1429,6 +1442,8 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
         for (int i=0; i<nScriptCheckThreads-1; i++)
             threadGroup.create_thread(&ThreadScriptCheck);
     }
+    StartCoinsPrefetchThreads();
+    StartBlockImportThreads();
 
     std::vector<std::string> vSporkAddresses;
     if (mapMultiArgs.count("-sporkaddr")) {
@@ -1733,6 +1748,7 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
             try {
                 UnloadBlockIndex();
                 delete pcoinsTip;
+                delete pcoinsflushview;
                 delete pcoinsdbview;
                 delete pcoinscatcher;
                 delete pblocktree;
@@ -1745,7 +1761,9 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                 pblocktree = new CBlockTreeDB(nBlockTreeDBCache, false, fReindex);
                 pcoinsdbview = new CCoinsViewDB(nCoinDBCache, false, fReindex || fReindexChainState);
                 pcoinscatcher = new CCoinsViewErrorCatcher(pcoinsdbview);
-                pcoinsTip = new CCoinsViewCache(pcoinscatcher);
+                // EvoDB changes are committed together with the coins, see FlushStateToDisk
+                pcoinsflushview = new CCoinsViewBackgroundFlush(pcoinscatcher, pcoinsdbview, []() { return evoDb->WriteCommitted(); });
+                pcoinsTip = new CCoinsViewCache(pcoinsflushview);
                 llmq::InitLLMQSystem(*evoDb);
 
                 if (fReindex) {
@@ -1812,7 +1830,7 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                     }
                 }
 
-                if (!CVerifyDB().VerifyDB(chainparams, pcoinsdbview, GetArg("-checklevel", DEFAULT_CHECKLEVEL),
+                if (!CVerifyDB().VerifyDB(chainparams, pcoinsflushview, GetArg("-checklevel", DEFAULT_CHECKLEVEL),
                               GetArg("-checkblocks", DEFAULT_CHECKBLOCKS))) {
                     strLoadError = _("Corrupted block database detected");
                     break;
@@ -2075,6 +2093,12 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     // ********************************************************* Step 11c: schedule Dash-specific tasks
 
     if (!fLiteMode) {
+        // -sigverifythreads=0 means autodetect, same as -par
+        int nSigVerifyThreads = GetArg("-sigverifythreads", DEFAULT_SIGVERIFY_THREADS);
+        if (nSigVerifyThreads <= 0)
+            nSigVerifyThreads += GetNumCores();
+        sigVerifyQueue.Start(nSigVerifyThreads);
+
         scheduler.scheduleEvery(boost::bind(&CNetFulfilledRequestManager::DoMaintenance, boost::ref(netfulfilledman)), 60);
         scheduler.scheduleEvery(boost::bind(&CMasternodeSync::DoMaintenance, boost::ref(masternodeSync), boost::ref(*g_connman)), 1);
         scheduler.scheduleEvery(boost::bind(&CMasternodeMan::DoMaintenance, boost::ref(mnodeman), boost::ref(*g_connman)), 1);
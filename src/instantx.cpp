@@ -106,7 +106,7 @@ bool CInstantSend::ProcessTxLockRequest(const CTxLockRequest& txLockRequest, CCo
 
     // Check to see if we conflict with existing completed lock
     for (const auto& txin : txLockRequest.tx->vin) {
-        std::map<COutPoint, uint256>::iterator it = mapLockedOutpoints.find(txin.prevout);
+        auto it = mapLockedOutpoints.find(txin.prevout);
         if (it != mapLockedOutpoints.end() && it->second != txLockRequest.GetHash()) {
             // Conflicting with complete lock, proceed to see if we should cancel them both
             LogPrintf("CInstantSend::ProcessTxLockRequest -- WARNING: Found conflicting completed Transaction Lock, txid=%s, completed lock txid=%s\n",
@@ -117,7 +117,7 @@ bool CInstantSend::ProcessTxLockRequest(const CTxLockRequest& txLockRequest, CCo
     // Check to see if there are votes for conflicting request,
     // if so - do not fail, just warn user
     for (const auto& txin : txLockRequest.tx->vin) {
-        std::map<COutPoint, std::set<uint256> >::iterator it = mapVotedOutpoints.find(txin.prevout);
+        auto it = mapVotedOutpoints.find(txin.prevout);
         if (it != mapVotedOutpoints.end()) {
             for (const auto& hash : it->second) {
                 if (hash != txLockRequest.GetHash()) {
@@ -146,7 +146,7 @@ bool CInstantSend::ProcessTxLockRequest(const CTxLockRequest& txLockRequest, CCo
     // If this just happened - process orphan votes, lock inputs, resolve conflicting locks,
     // update transaction status forcing external script/zmq notifications.
     ProcessOrphanTxLockVotes();
-    std::map<uint256, CTxLockCandidate>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
+    auto itLockCandidate = mapTxLockCandidates.find(txHash);
     TryToFinalizeLockCandidate(itLockCandidate->second);
 
     return true;
@@ -160,11 +160,12 @@ bool CInstantSend::CreateTxLockCandidate(const CTxLockRequest& txLockRequest)
 
     uint256 txHash = txLockRequest.GetHash();
 
-    std::map<uint256, CTxLockCandidate>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
+    auto itLockCandidate = mapTxLockCandidates.find(txHash);
     if (itLockCandidate == mapTxLockCandidates.end()) {
         LogPrintf("CInstantSend::CreateTxLockCandidate -- new, txid=%s\n", txHash.ToString());
 
         CTxLockCandidate txLockCandidate(txLockRequest);
+        txLockCandidate.nTimeRequestReceived = GetTimeMicros();
         // all inputs should already be checked by txLockRequest.IsValid() above, just use them now
         for (const auto& txin : txLockRequest.tx->vin) {
             txLockCandidate.AddOutPointLock(txin.prevout);
@@ -173,6 +174,7 @@ bool CInstantSend::CreateTxLockCandidate(const CTxLockRequest& txLockRequest)
     } else if (!itLockCandidate->second.txLockRequest) {
         // i.e. empty Transaction Lock Candidate was created earlier, let's update it with actual data
         itLockCandidate->second.txLockRequest = txLockRequest;
+        itLockCandidate->second.nTimeRequestReceived = GetTimeMicros();
         if (itLockCandidate->second.IsTimedOut()) {
             LogPrintf("CInstantSend::CreateTxLockCandidate -- timed out, txid=%s\n", txHash.ToString());
             return false;
@@ -185,8 +187,12 @@ bool CInstantSend::CreateTxLockCandidate(const CTxLockRequest& txLockRequest)
         }
     } else {
         LogPrint("instantsend", "CInstantSend::CreateTxLockCandidate -- seen, txid=%s\n", txHash.ToString());
+        return true;
     }
 
+    LOCK(cs_stats);
+    stats.nRequests++;
+
     return true;
 }
 
@@ -196,7 +202,10 @@ void CInstantSend::CreateEmptyTxLockCandidate(const uint256& txHash)
         return;
     LogPrintf("CInstantSend::CreateEmptyTxLockCandidate -- new, txid=%s\n", txHash.ToString());
     const CTxLockRequest txLockRequest = CTxLockRequest();
-    mapTxLockCandidates.insert(std::make_pair(txHash, CTxLockCandidate(txLockRequest)));
+    CTxLockCandidate txLockCandidate(txLockRequest);
+    // only called for the very first (orphan) vote
+    txLockCandidate.nTimeFirstVote = GetTimeMicros();
+    mapTxLockCandidates.insert(std::make_pair(txHash, txLockCandidate));
 }
 
 void CInstantSend::Vote(const uint256& txHash, CConnman& connman)
@@ -263,14 +272,14 @@ void CInstantSend::Vote(CTxLockCandidate& txLockCandidate, CConnman& connman)
 
         LogPrint("instantsend", "CInstantSend::Vote -- In the top %d (%d)\n", nSignaturesTotal, nRank);
 
-        std::map<COutPoint, std::set<uint256> >::iterator itVoted = mapVotedOutpoints.find(outpointLockPair.first);
+        auto itVoted = mapVotedOutpoints.find(outpointLockPair.first);
 
         // Check to see if we already voted for this outpoint,
         // refuse to vote twice or to include the same outpoint in another tx
         bool fAlreadyVoted = false;
         if (itVoted != mapVotedOutpoints.end()) {
             for (const auto& hash : itVoted->second) {
-                std::map<uint256, CTxLockCandidate>::iterator it2 = mapTxLockCandidates.find(hash);
+                auto it2 = mapTxLockCandidates.find(hash);
                 if (it2->second.HasMasternodeVoted(outpointLockPair.first, activeMasternodeInfo.outpoint)) {
                     // we already voted for this outpoint to be included either in the same tx or in a competing one,
                     // skip it anyway
@@ -328,7 +337,16 @@ bool CInstantSend::ProcessNewTxLockVote(CNode* pfrom, const CTxLockVote& vote, C
     uint256 txHash = vote.GetTxHash();
     uint256 nVoteHash = vote.GetHash();
 
-    if (!vote.IsValid(pfrom, connman)) {
+    int64_t nTimeVerifyStart = GetTimeMicros();
+    bool fValid = vote.IsValid(pfrom, connman);
+    {
+        LOCK(cs_stats);
+        stats.histVoteVerify.Add(GetTimeMicros() - nTimeVerifyStart);
+        stats.nVotes++;
+        if (!fValid) stats.nVotesInvalid++;
+    }
+
+    if (!fValid) {
         // could be because of missing MN
         LogPrint("instantsend", "CInstantSend::%s -- Vote is invalid, txid=%s\n", __func__, txHash.ToString());
         return false;
@@ -346,7 +364,7 @@ bool CInstantSend::ProcessNewTxLockVote(CNode* pfrom, const CTxLockVote& vote, C
     // Masternodes will sometimes propagate votes before the transaction is known to the client,
     // will actually process only after the lock request itself has arrived
 
-    std::map<uint256, CTxLockCandidate>::iterator it = mapTxLockCandidates.find(txHash);
+    auto it = mapTxLockCandidates.find(txHash);
     if (it == mapTxLockCandidates.end() || !it->second.txLockRequest) {
         // no or empty tx lock candidate
         if (it == mapTxLockCandidates.end()) {
@@ -395,6 +413,14 @@ bool CInstantSend::ProcessNewTxLockVote(CNode* pfrom, const CTxLockVote& vote, C
         return false;
     }
 
+    if (txLockCandidate.nTimeFirstVote == 0) {
+        txLockCandidate.nTimeFirstVote = GetTimeMicros();
+        if (txLockCandidate.nTimeRequestReceived != 0) {
+            LOCK(cs_stats);
+            stats.histRequestFirstVote.Add((txLockCandidate.nTimeFirstVote - txLockCandidate.nTimeRequestReceived) / 1000);
+        }
+    }
+
     int nSignatures = txLockCandidate.CountVotes();
     int nSignaturesMax = txLockCandidate.txLockRequest.GetMaxSignatures();
     LogPrint("instantsend", "CInstantSend::%s -- Transaction Lock signatures count: %d/%d, vote hash=%s\n", __func__,
@@ -418,7 +444,7 @@ bool CInstantSend::ProcessOrphanTxLockVote(const CTxLockVote& vote)
     uint256 txHash = vote.GetTxHash();
 
     // We shouldn't process orphan votes without a valid tx lock candidate
-    std::map<uint256, CTxLockCandidate>::iterator it = mapTxLockCandidates.find(txHash);
+    auto it = mapTxLockCandidates.find(txHash);
     if (it == mapTxLockCandidates.end() || !it->second.txLockRequest)
         return false; // this shouldn never happen
 
@@ -452,14 +478,14 @@ void CInstantSend::UpdateVotedOutpoints(const CTxLockVote& vote, CTxLockCandidat
 
     uint256 txHash = vote.GetTxHash();
 
-    std::map<COutPoint, std::set<uint256> >::iterator it1 = mapVotedOutpoints.find(vote.GetOutpoint());
+    auto it1 = mapVotedOutpoints.find(vote.GetOutpoint());
     if (it1 != mapVotedOutpoints.end()) {
         for (const auto& hash : it1->second) {
             if (hash != txHash) {
                 // same outpoint was already voted to be locked by another tx lock request,
                 // let's see if it was the same masternode who voted on this outpoint
                 // for another tx lock request
-                std::map<uint256, CTxLockCandidate>::iterator it2 = mapTxLockCandidates.find(hash);
+                auto it2 = mapTxLockCandidates.find(hash);
                 if (it2 !=mapTxLockCandidates.end() && it2->second.HasMasternodeVoted(vote.GetOutpoint(), vote.GetMasternodeOutpoint())) {
                     // yes, it was the same masternode
                     LogPrintf("CInstantSend::%s -- masternode sent conflicting votes! %s\n", __func__, vote.GetMasternodeOutpoint().ToStringShort());
@@ -488,7 +514,7 @@ void CInstantSend::ProcessOrphanTxLockVotes()
     AssertLockHeld(cs_main);
     AssertLockHeld(cs_instantsend);
 
-    std::map<uint256, CTxLockVote>::iterator it = mapTxLockVotesOrphan.begin();
+    auto it = mapTxLockVotesOrphan.begin();
     while (it != mapTxLockVotesOrphan.end()) {
         if (ProcessOrphanTxLockVote(it->second)) {
             mapTxLockVotesOrphan.erase(it++);
@@ -512,6 +538,16 @@ void CInstantSend::TryToFinalizeLockCandidate(const CTxLockCandidate& txLockCand
         if (ResolveConflicts(txLockCandidate)) {
             LockTransactionInputs(txLockCandidate);
             UpdateLockedTransaction(txLockCandidate);
+
+            LOCK(cs_stats);
+            stats.nLocks++;
+            // unknown for candidates loaded from disk
+            if (txLockCandidate.nTimeRequestReceived != 0) {
+                int64_t nLatency = (GetTimeMicros() - txLockCandidate.nTimeRequestReceived) / 1000;
+                stats.histRequestLock.Add(nLatency);
+                LogPrint("instantsend", "CInstantSend::TryToFinalizeLockCandidate -- Transaction Lock latency %d ms, txid=%s\n", nLatency, txHash.ToString());
+                GetMainSignals().NotifyTransactionLockLatency(*txLockCandidate.txLockRequest.tx, nLatency);
+            }
         }
     }
 }
@@ -568,7 +604,7 @@ void CInstantSend::LockTransactionInputs(const CTxLockCandidate& txLockCandidate
 bool CInstantSend::GetLockedOutPointTxHash(const COutPoint& outpoint, uint256& hashRet)
 {
     LOCK(cs_instantsend);
-    std::map<COutPoint, uint256>::iterator it = mapLockedOutpoints.find(outpoint);
+    auto it = mapLockedOutpoints.find(outpoint);
     if (it == mapLockedOutpoints.end()) return false;
     hashRet = it->second;
     return true;
@@ -591,8 +627,8 @@ bool CInstantSend::ResolveConflicts(const CTxLockCandidate& txLockCandidate)
         if (GetLockedOutPointTxHash(txin.prevout, hashConflicting) && txHash != hashConflicting) {
             // completed lock which conflicts with another completed one?
             // this means that majority of MNs in the quorum for this specific tx input are malicious!
-            std::map<uint256, CTxLockCandidate>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
-            std::map<uint256, CTxLockCandidate>::iterator itLockCandidateConflicting = mapTxLockCandidates.find(hashConflicting);
+            auto itLockCandidate = mapTxLockCandidates.find(txHash);
+            auto itLockCandidateConflicting = mapTxLockCandidates.find(hashConflicting);
             if (itLockCandidate == mapTxLockCandidates.end() || itLockCandidateConflicting == mapTxLockCandidates.end()) {
                 // safety check, should never really happen
                 LogPrintf("CInstantSend::ResolveConflicts -- ERROR: Found conflicting completed Transaction Lock, but one of txLockCandidate-s is missing, txid=%s, conflicting txid=%s\n",
@@ -670,7 +706,7 @@ void CInstantSend::CheckAndRemove()
 
     LOCK(cs_instantsend);
 
-    std::map<uint256, CTxLockCandidate>::iterator itLockCandidate = mapTxLockCandidates.begin();
+    auto itLockCandidate = mapTxLockCandidates.begin();
 
     // remove expired candidates
     while (itLockCandidate != mapTxLockCandidates.end()) {
@@ -692,7 +728,7 @@ void CInstantSend::CheckAndRemove()
     }
 
     // remove expired votes
-    std::map<uint256, CTxLockVote>::iterator itVote = mapTxLockVotes.begin();
+    auto itVote = mapTxLockVotes.begin();
     while (itVote != mapTxLockVotes.end()) {
         if (itVote->second.IsExpired(nCachedBlockHeight)) {
             LogPrint("instantsend", "CInstantSend::CheckAndRemove -- Removing expired vote: txid=%s  masternode=%s\n",
@@ -704,7 +740,7 @@ void CInstantSend::CheckAndRemove()
     }
 
     // remove timed out orphan votes
-    std::map<uint256, CTxLockVote>::iterator itOrphanVote = mapTxLockVotesOrphan.begin();
+    auto itOrphanVote = mapTxLockVotesOrphan.begin();
     while (itOrphanVote != mapTxLockVotesOrphan.end()) {
         if (itOrphanVote->second.IsTimedOut()) {
             LogPrint("instantsend", "CInstantSend::CheckAndRemove -- Removing timed out orphan vote: txid=%s  masternode=%s\n",
@@ -729,7 +765,7 @@ void CInstantSend::CheckAndRemove()
     }
 
     // remove timed out masternode orphan votes (DOS protection)
-    std::map<COutPoint, int64_t>::iterator itMasternodeOrphan = mapMasternodeOrphanVotes.begin();
+    auto itMasternodeOrphan = mapMasternodeOrphanVotes.begin();
     while (itMasternodeOrphan != mapMasternodeOrphanVotes.end()) {
         if (itMasternodeOrphan->second < GetTime()) {
             LogPrint("instantsend", "CInstantSend::CheckAndRemove -- Removing timed out orphan masternode vote: masternode=%s\n",
@@ -754,6 +790,13 @@ void CInstantSend::AcceptLockRequest(const CTxLockRequest& txLockRequest)
 {
     LOCK(cs_instantsend);
     mapLockRequestAccepted.insert(std::make_pair(txLockRequest.GetHash(), txLockRequest));
+
+    // the request is relayed right after being accepted
+    auto it = mapTxLockCandidates.find(txLockRequest.GetHash());
+    if (it != mapTxLockCandidates.end() && it->second.nTimeRequestReceived != 0) {
+        LOCK(cs_stats);
+        stats.histRequestRelay.Add((GetTimeMicros() - it->second.nTimeRequestReceived) / 1000);
+    }
 }
 
 void CInstantSend::RejectLockRequest(const CTxLockRequest& txLockRequest)
@@ -772,7 +815,7 @@ bool CInstantSend::GetTxLockRequest(const uint256& txHash, CTxLockRequest& txLoc
 {
     LOCK(cs_instantsend);
 
-    std::map<uint256, CTxLockCandidate>::iterator it = mapTxLockCandidates.find(txHash);
+    auto it = mapTxLockCandidates.find(txHash);
     if (it == mapTxLockCandidates.end() || !it->second.txLockRequest) return false;
     txLockRequestRet = it->second.txLockRequest;
 
@@ -783,7 +826,7 @@ bool CInstantSend::GetTxLockVote(const uint256& hash, CTxLockVote& txLockVoteRet
 {
     LOCK(cs_instantsend);
 
-    std::map<uint256, CTxLockVote>::iterator it = mapTxLockVotes.find(hash);
+    auto it = mapTxLockVotes.find(hash);
     if (it == mapTxLockVotes.end()) return false;
     txLockVoteRet = it->second;
 
@@ -813,7 +856,7 @@ bool CInstantSend::IsLockedInstantSendTransaction(const uint256& txHash)
     LOCK(cs_instantsend);
 
     // there must be a lock candidate
-    std::map<uint256, CTxLockCandidate>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
+    auto itLockCandidate = mapTxLockCandidates.find(txHash);
     if (itLockCandidate == mapTxLockCandidates.end()) return false;
 
     // which should have outpoints
@@ -836,7 +879,7 @@ int CInstantSend::GetTransactionLockSignatures(const uint256& txHash)
 
     LOCK(cs_instantsend);
 
-    std::map<uint256, CTxLockCandidate>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
+    auto itLockCandidate = mapTxLockCandidates.find(txHash);
     if (itLockCandidate != mapTxLockCandidates.end()) {
         return itLockCandidate->second.CountVotes();
     }
@@ -850,7 +893,7 @@ bool CInstantSend::IsTxLockCandidateTimedOut(const uint256& txHash)
 
     LOCK(cs_instantsend);
 
-    std::map<uint256, CTxLockCandidate>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
+    auto itLockCandidate = mapTxLockCandidates.find(txHash);
     if (itLockCandidate != mapTxLockCandidates.end()) {
         return !itLockCandidate->second.IsAllOutPointsReady() &&
                 itLockCandidate->second.IsTimedOut();
@@ -863,7 +906,7 @@ void CInstantSend::Relay(const uint256& txHash, CConnman& connman)
 {
     LOCK(cs_instantsend);
 
-    std::map<uint256, CTxLockCandidate>::const_iterator itLockCandidate = mapTxLockCandidates.find(txHash);
+    auto itLockCandidate = mapTxLockCandidates.find(txHash);
     if (itLockCandidate != mapTxLockCandidates.end()) {
         itLockCandidate->second.Relay(connman);
     }
@@ -891,7 +934,7 @@ void CInstantSend::SyncTransaction(const CTransaction& tx, const CBlockIndex *pi
     LogPrint("instantsend", "CInstantSend::SyncTransaction -- txid=%s nHeightNew=%d\n", txHash.ToString(), nHeightNew);
 
     // Check lock candidates
-    std::map<uint256, CTxLockCandidate>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
+    auto itLockCandidate = mapTxLockCandidates.find(txHash);
     if (itLockCandidate != mapTxLockCandidates.end()) {
         LogPrint("instantsend", "CInstantSend::SyncTransaction -- txid=%s nHeightNew=%d lock candidate updated\n",
                 txHash.ToString(), nHeightNew);
@@ -927,6 +970,12 @@ std::string CInstantSend::ToString() const
     return strprintf("Lock Candidates: %llu, Votes %llu", mapTxLockCandidates.size(), mapTxLockVotes.size());
 }
 
+CInstantSendStats CInstantSend::GetStats() const
+{
+    LOCK(cs_stats);
+    return stats;
+}
+
 void CInstantSend::DoMaintenance()
 {
     if (ShutdownRequested()) return;
@@ -1218,27 +1267,28 @@ bool CTxLockVote::IsFailed() const
 
 bool COutPointLock::AddVote(const CTxLockVote& vote)
 {
-    return mapMasternodeVotes.emplace(vote.GetMasternodeOutpoint(), vote).second;
+    if (HasMasternodeVoted(vote.GetMasternodeOutpoint())) return false;
+    vecMasternodeVotes.push_back(vote);
+    return true;
 }
 
 std::vector<CTxLockVote> COutPointLock::GetVotes() const
 {
-    std::vector<CTxLockVote> vRet;
-    for (const auto& pair : mapMasternodeVotes) {
-        vRet.push_back(pair.second);
-    }
-    return vRet;
+    return vecMasternodeVotes;
 }
 
 bool COutPointLock::HasMasternodeVoted(const COutPoint& outpointMasternodeIn) const
 {
-    return mapMasternodeVotes.count(outpointMasternodeIn);
+    for (const auto& vote : vecMasternodeVotes) {
+        if (vote.GetMasternodeOutpoint() == outpointMasternodeIn) return true;
+    }
+    return false;
 }
 
 void COutPointLock::Relay(CConnman& connman) const
 {
-    for (const auto& pair : mapMasternodeVotes) {
-        pair.second.Relay(connman);
+    for (const auto& vote : vecMasternodeVotes) {
+        vote.Relay(connman);
     }
 }
 
@@ -1253,14 +1303,14 @@ void CTxLockCandidate::AddOutPointLock(const COutPoint& outpoint)
 
 void CTxLockCandidate::MarkOutpointAsAttacked(const COutPoint& outpoint)
 {
-    std::map<COutPoint, COutPointLock>::iterator it = mapOutPointLocks.find(outpoint);
+    auto it = mapOutPointLocks.find(outpoint);
     if (it != mapOutPointLocks.end())
         it->second.MarkAsAttacked();
 }
 
 bool CTxLockCandidate::AddVote(const CTxLockVote& vote)
 {
-    std::map<COutPoint, COutPointLock>::iterator it = mapOutPointLocks.find(vote.GetOutpoint());
+    auto it = mapOutPointLocks.find(vote.GetOutpoint());
     if (it == mapOutPointLocks.end()) return false;
     return it->second.AddVote(vote);
 }
@@ -1277,7 +1327,7 @@ bool CTxLockCandidate::IsAllOutPointsReady() const
 
 bool CTxLockCandidate::HasMasternodeVoted(const COutPoint& outpointIn, const COutPoint& outpointMasternodeIn)
 {
-    std::map<COutPoint, COutPointLock>::iterator it = mapOutPointLocks.find(outpointIn);
+    auto it = mapOutPointLocks.find(outpointIn);
     return it !=mapOutPointLocks.end() && it->second.HasMasternodeVoted(outpointMasternodeIn);
 }
 
@@ -5,11 +5,16 @@
 #define INSTANTX_H
 
 #include "chain.h"
+#include "coins.h"
+#include "latencyhistogram.h"
 #include "net.h"
 #include "primitives/transaction.h"
+#include "txmempool.h"
 
 #include "evo/deterministicmns.h"
 
+#include <unordered_map>
+
 class CTxLockVote;
 class COutPointLock;
 class CTxLockRequest;
@@ -40,6 +45,26 @@ static const int INSTANTSEND_FAILED_TIMEOUT_SECONDS = 60;
 extern bool fEnableInstantSend;
 extern int nCompleteTXLocks;
 
+/**
+ * Timing of the InstantSend pipeline as seen by this node, see "instantsend stats"
+ */
+struct CInstantSendStats
+{
+    /// Lock request received -> accepted to mempool and relayed, in milliseconds
+    CLatencyHistogram histRequestRelay;
+    /// Verification of a single vote, in microseconds
+    CLatencyHistogram histVoteVerify;
+    /// Lock request received -> first vote for it received, in milliseconds
+    CLatencyHistogram histRequestFirstVote;
+    /// Lock request received -> enough votes for all outpoints, in milliseconds
+    CLatencyHistogram histRequestLock;
+
+    uint64_t nRequests = 0;
+    uint64_t nVotes = 0;
+    uint64_t nVotesInvalid = 0;
+    uint64_t nLocks = 0;
+};
+
 /**
  * Manages InstantSend. Processes lock requests, candidates, and votes.
  */
@@ -54,19 +79,24 @@ private:
     // Keep track of current block height
     int nCachedBlockHeight;
 
+    // All of these are only ever looked up by key and the keys come from the network, hence the salted hashers
+
     // maps for AlreadyHave
-    std::map<uint256, CTxLockRequest> mapLockRequestAccepted; ///< Tx hash - Tx
-    std::map<uint256, CTxLockRequest> mapLockRequestRejected; ///< Tx hash - Tx
-    std::map<uint256, CTxLockVote> mapTxLockVotes; ///< Vote hash - Vote
-    std::map<uint256, CTxLockVote> mapTxLockVotesOrphan; ///< Vote hash - Vote
+    std::unordered_map<uint256, CTxLockRequest, SaltedTxidHasher> mapLockRequestAccepted; ///< Tx hash - Tx
+    std::unordered_map<uint256, CTxLockRequest, SaltedTxidHasher> mapLockRequestRejected; ///< Tx hash - Tx
+    std::unordered_map<uint256, CTxLockVote, SaltedTxidHasher> mapTxLockVotes; ///< Vote hash - Vote
+    std::unordered_map<uint256, CTxLockVote, SaltedTxidHasher> mapTxLockVotesOrphan; ///< Vote hash - Vote
 
-    std::map<uint256, CTxLockCandidate> mapTxLockCandidates; ///< Tx hash - Lock candidate
+    std::unordered_map<uint256, CTxLockCandidate, SaltedTxidHasher> mapTxLockCandidates; ///< Tx hash - Lock candidate
 
-    std::map<COutPoint, std::set<uint256> > mapVotedOutpoints; ///< UTXO - Tx hash set
-    std::map<COutPoint, uint256> mapLockedOutpoints; ///< UTXO - Tx hash
+    std::unordered_map<COutPoint, std::set<uint256>, SaltedOutpointHasher> mapVotedOutpoints; ///< UTXO - Tx hash set
+    std::unordered_map<COutPoint, uint256, SaltedOutpointHasher> mapLockedOutpoints; ///< UTXO - Tx hash
 
     /// Track masternodes who voted with no txlockrequest (for DOS protection)
-    std::map<COutPoint, int64_t> mapMasternodeOrphanVotes; ///< MN outpoint - Time
+    std::unordered_map<COutPoint, int64_t, SaltedOutpointHasher> mapMasternodeOrphanVotes; ///< MN outpoint - Time
+
+    mutable CCriticalSection cs_stats;
+    CInstantSendStats stats;
 
     bool CreateTxLockCandidate(const CTxLockRequest& txLockRequest);
     void CreateEmptyTxLockCandidate(const uint256& txHash);
@@ -154,6 +184,8 @@ public:
 
     void DoMaintenance();
 
+    CInstantSendStats GetStats() const;
+
     /// checks if we can automatically lock "simple" transactions
     static bool CanAutoLock();
 
@@ -309,7 +341,8 @@ class COutPointLock
 {
 private:
     COutPoint outpoint; ///< UTXO
-    std::map<COutPoint, CTxLockVote> mapMasternodeVotes; ///< Masternode outpoint - vote
+    /// At most SIGNATURES_TOTAL votes, a flat vector is faster to search than any map of that size
+    std::vector<CTxLockVote> vecMasternodeVotes;
     bool fAttacked = false;
 
 public:
@@ -320,24 +353,41 @@ public:
 
     COutPointLock(const COutPoint& outpointIn) :
         outpoint(outpointIn),
-        mapMasternodeVotes()
+        vecMasternodeVotes()
         {}
 
     COutPoint GetOutpoint() const { return outpoint; }
 
-    ADD_SERIALIZE_METHODS;
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ::Serialize(s, outpoint);
+        // written as a masternode outpoint - vote map, which is how votes were stored before
+        WriteCompactSize(s, vecMasternodeVotes.size());
+        for (const auto& vote : vecMasternodeVotes) {
+            ::Serialize(s, std::make_pair(vote.GetMasternodeOutpoint(), vote));
+        }
+        ::Serialize(s, fAttacked);
+    }
 
-    template <typename Stream, typename Operation>
-    inline void SerializationOp(Stream& s, Operation ser_action) {
-        READWRITE(outpoint);
-        READWRITE(mapMasternodeVotes);
-        READWRITE(fAttacked);
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        ::Unserialize(s, outpoint);
+        vecMasternodeVotes.clear();
+        unsigned int nSize = ReadCompactSize(s);
+        for (unsigned int i = 0; i < nSize; i++) {
+            std::pair<COutPoint, CTxLockVote> item;
+            ::Unserialize(s, item);
+            vecMasternodeVotes.push_back(item.second);
+        }
+        ::Unserialize(s, fAttacked);
     }
 
     bool AddVote(const CTxLockVote& vote);
     std::vector<CTxLockVote> GetVotes() const;
     bool HasMasternodeVoted(const COutPoint& outpointMasternodeIn) const;
-    int CountVotes() const { return fAttacked ? 0 : mapMasternodeVotes.size(); }
+    int CountVotes() const { return fAttacked ? 0 : vecMasternodeVotes.size(); }
     bool IsReady() const { return !fAttacked && CountVotes() >= SIGNATURES_REQUIRED; }
     void MarkAsAttacked() { fAttacked = true; }
 
@@ -367,7 +417,10 @@ public:
         {}
 
     CTxLockRequest txLockRequest;
-    std::map<COutPoint, COutPointLock> mapOutPointLocks;
+    std::unordered_map<COutPoint, COutPointLock, SaltedOutpointHasher> mapOutPointLocks;
+    // local memory only, GetTimeMicros() or 0 if unknown
+    int64_t nTimeRequestReceived = 0;
+    int64_t nTimeFirstVote = 0;
 
     ADD_SERIALIZE_METHODS;
 
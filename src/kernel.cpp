@@ -303,42 +303,61 @@ static bool GetKernelStakeModifier(uint256 hashBlockFrom, unsigned int nTimeTx,
 //   a proof-of-work situation.
 //
 
+bool GetKernelStakeModifier(const uint256& hashBlockFrom, uint64_t& nStakeModifier)
+{
+    int nStakeModifierHeight = 0;
+    int64_t nStakeModifierTime = 0;
+    return GetKernelStakeModifier(hashBlockFrom, 0, nStakeModifier, nStakeModifierHeight, nStakeModifierTime, false);
+}
+
 bool CheckStakeKernelHash(unsigned int nBits, const CBlock& blockFrom, unsigned int nTxPrevOffset, const CTransactionRef& txPrev, const COutPoint& prevout, unsigned int nTimeTx, uint256& hashProofOfStake)
 {
+    CStakeCandidate candidate;
+    candidate.prevout = prevout;
+    candidate.txout = txPrev->vout[prevout.n];
+    candidate.nTimeBlockFrom = blockFrom.GetBlockTime();
+    candidate.nStakeModifier = 0;
+
+    if (IsProtocolV03(nTimeTx) && !GetKernelStakeModifier(blockFrom.GetHash(), candidate.nStakeModifier))
+        return false;
 
-    auto txPrevTime = blockFrom.GetBlockTime();
+    return CheckStakeKernelHash(nBits, candidate, nTxPrevOffset, nTimeTx, hashProofOfStake);
+}
+
+uint256 GetStakeKernelHash(const CStakeCandidate& candidate, unsigned int nTxPrevOffset, unsigned int nTimeTx)
+{
+    unsigned int nTimeBlockFrom = candidate.nTimeBlockFrom;
+    int64_t txPrevTime = candidate.nTimeBlockFrom;
+    CDataStream ss(SER_GETHASH, 0);
+    if (IsProtocolV03(nTimeTx))
+        ss << candidate.nStakeModifier;
+
+    ss << nTimeBlockFrom << nTxPrevOffset << txPrevTime << candidate.prevout.n << nTimeTx;
+    return Hash(ss.begin(), ss.end());
+}
+
+bool CheckStakeKernelHash(unsigned int nBits, const CStakeCandidate& candidate, unsigned int nTxPrevOffset, unsigned int nTimeTx, uint256& hashProofOfStake)
+{
+    int64_t txPrevTime = candidate.nTimeBlockFrom;
     if (nTimeTx < txPrevTime)  // Transaction timestamp violation
         return error("CheckStakeKernelHash() : nTime violation");
 
     auto nStakeMinAge = CurrentMinStakeAge(nTimeTx);
     auto nStakeMaxAge = Params().GetConsensus().nStakeMaxAge;
-    unsigned int nTimeBlockFrom = blockFrom.GetBlockTime();
+    unsigned int nTimeBlockFrom = candidate.nTimeBlockFrom;
     if (nTimeBlockFrom + nStakeMinAge > nTimeTx) // Min age requirement
         return error("CheckStakeKernelHash() : min age violation");
 
     arith_uint256 bnTargetPerCoinDay;
     bnTargetPerCoinDay.SetCompact(nBits);
-    CAmount nValueIn = txPrev->vout[prevout.n].nValue;
+    CAmount nValueIn = candidate.txout.nValue;
     // v0.3 protocol kernel hash weight starts from 0 at the 30-day min age
     // this change increases active coins participating the hash and helps
     // to secure the network when proof-of-stake difficulty is low
     int64_t nTimeWeight = std::min<int64_t>(nTimeTx - txPrevTime, nStakeMaxAge - nStakeMinAge);
     arith_uint256 bnCoinDayWeight = nValueIn * nTimeWeight / COIN / 200;
 
-    // Calculate hash
-    CDataStream ss(SER_GETHASH, 0);
-    uint64_t nStakeModifier = 0;
-    int nStakeModifierHeight = 0;
-    int64_t nStakeModifierTime = 0;
-
-    if (IsProtocolV03(nTimeTx)){
-        if (!GetKernelStakeModifier(blockFrom.GetHash(), nTimeTx, nStakeModifier, nStakeModifierHeight, nStakeModifierTime, false))
-            return false;
-        ss << nStakeModifier;
-    }
-
-    ss << nTimeBlockFrom << nTxPrevOffset << txPrevTime << prevout.n << nTimeTx;
-    hashProofOfStake = Hash(ss.begin(), ss.end());
+    hashProofOfStake = GetStakeKernelHash(candidate, nTxPrevOffset, nTimeTx);
     if (nTimeTx < 1549143000)
         return true;
 
@@ -370,13 +389,32 @@ bool CheckKernelScript(CScript scriptVin, CScript scriptVout)
     };
     return extractKeyID(scriptVin) == extractKeyID(scriptVout);
 }
-bool CheckProofOfStake(const CBlock &block, uint256& hashProofOfStake)
+bool CheckProofOfStake(const CBlock &block, uint256& hashProofOfStake, bool fAssumeValid)
 {
     const CTransactionRef tx = block.vtx[1];
     if (!tx->IsCoinStake())
         return error("CheckProofOfStake() : called on non-coinstake %s", tx->GetHash().ToString().c_str());
     // Kernel (input 0) must match the stake hash target per coin age (nBits)
     const CTxIn& txin = tx->vin[0];
+    // Below the assumed valid block the chain already commits to the kernel, only its hash is needed for the
+    // stake modifiers. While the staked coin is unspent, its block is found without reading any from disk.
+    if (fAssumeValid) {
+        LOCK(cs_main);
+        const Coin& coin = pcoinsTip->AccessCoin(txin.prevout);
+        const CBlockIndex* pindexFrom = coin.IsSpent() ? NULL : chainActive[coin.nHeight];
+        if (pindexFrom) {
+            CStakeCandidate candidate;
+            candidate.prevout = txin.prevout;
+            candidate.txout = coin.out;
+            candidate.nTimeBlockFrom = pindexFrom->GetBlockTime();
+            candidate.nStakeModifier = 0;
+            if (!IsProtocolV03(block.nTime) || GetKernelStakeModifier(pindexFrom->GetBlockHash(), candidate.nStakeModifier)) {
+                hashProofOfStake = GetStakeKernelHash(candidate, sizeof(CBlock), block.nTime);
+                return true;
+            }
+        }
+        // the kernel is checked in full otherwise
+    }
     // First try finding the previous transaction in database
     uint256 hashBlock;
     CTransactionRef txPrev;
@@ -28,9 +28,35 @@ bool ComputeNextStakeModifier(const CBlockIndex* pindexPrev, uint64_t& nStakeMod
 bool CheckStakeKernelHash(unsigned int nBits, const CBlock& blockFrom, unsigned int nTxPrevOffset,
                           const CTransactionRef& txPrev, const COutPoint& prevout, unsigned int nTimeTx,
                           uint256& hashProofOfStake);
+// Get the stake modifier a kernel spending an output of the given block has to hash, requires cs_main
+bool GetKernelStakeModifier(const uint256& hashBlockFrom, uint64_t& nStakeModifier);
+
+// A coin that may be staked together with everything its kernel hash depends on. Gathering
+// this needs cs_main, checking kernels of a candidate afterwards doesn't need any lock.
+struct CStakeCandidate
+{
+    COutPoint prevout;
+    CTxOut txout;
+    unsigned int nTimeBlockFrom;
+    uint64_t nStakeModifier;
+};
+
+// A candidate which meets the hash target at nTime
+struct CStakeKernel
+{
+    CStakeCandidate candidate;
+    unsigned int nTime;
+};
+
+// Same as above for a stake candidate, doesn't need any lock
+bool CheckStakeKernelHash(unsigned int nBits, const CStakeCandidate& candidate, unsigned int nTxPrevOffset,
+                          unsigned int nTimeTx, uint256& hashProofOfStake);
+// Kernel hash of a stake candidate, without checking it against any target
+uint256 GetStakeKernelHash(const CStakeCandidate& candidate, unsigned int nTxPrevOffset, unsigned int nTimeTx);
 // Check kernel hash target and coinstake signature
 // Sets hashProofOfStake on success return
-bool CheckProofOfStake(const CBlock &block, uint256& hashProofOfStake);
+// fAssumeValid: the block is below the assumed valid block, only compute hashProofOfStake if possible
+bool CheckProofOfStake(const CBlock &block, uint256& hashProofOfStake, bool fAssumeValid = false);
 // Check whether the coinstake timestamp meets protocol
 bool CheckCoinStakeTimestamp(int64_t nTimeBlock, int64_t nTimeTx);
 // Get stake modifier checksum
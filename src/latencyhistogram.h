@@ -0,0 +1,111 @@
+// Copyright (c) 2014-2018 The Polis Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include "tinyformat.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdint.h>
+
+#include <univalue.h>
+
+/**
+ * Histogram of durations with power of two buckets: bucket 0 counts durations below 1 unit,
+ * bucket i counts durations in [2^(i-1), 2^i) units and the last bucket everything above.
+ * The unit is up to the caller. Not thread safe, callers have to lock.
+ */
+class CLatencyHistogram
+{
+public:
+    static const int BUCKETS = 32;
+
+private:
+    uint64_t vBuckets[BUCKETS];
+    uint64_t nCount;
+    int64_t nSum;
+    int64_t nMin;
+    int64_t nMax;
+
+    static int GetBucket(int64_t nDuration)
+    {
+        int nBucket = 0;
+        while (nDuration > 0 && nBucket < BUCKETS - 1) {
+            nDuration >>= 1;
+            nBucket++;
+        }
+        return nBucket;
+    }
+
+public:
+    CLatencyHistogram()
+    {
+        Clear();
+    }
+
+    void Clear()
+    {
+        std::fill(vBuckets, vBuckets + BUCKETS, 0);
+        nCount = 0;
+        nSum = 0;
+        nMin = std::numeric_limits<int64_t>::max();
+        nMax = 0;
+    }
+
+    void Add(int64_t nDuration)
+    {
+        // clock adjustments can make durations negative
+        nDuration = std::max(nDuration, (int64_t)0);
+        vBuckets[GetBucket(nDuration)]++;
+        nCount++;
+        nSum += nDuration;
+        nMin = std::min(nMin, nDuration);
+        nMax = std::max(nMax, nDuration);
+    }
+
+    uint64_t GetCount() const { return nCount; }
+    int64_t GetMin() const { return nCount ? nMin : 0; }
+    int64_t GetMax() const { return nMax; }
+    int64_t GetMean() const { return nCount ? nSum / (int64_t)nCount : 0; }
+
+    /// Upper bound of the bucket the given quantile (0..1) falls into, capped at the maximum seen so far
+    int64_t GetQuantile(double dQuantile) const
+    {
+        if (nCount == 0) return 0;
+        uint64_t nTarget = std::max((uint64_t)1, (uint64_t)(dQuantile * nCount + 0.5));
+        uint64_t nSeen = 0;
+        for (int i = 0; i < BUCKETS - 1; i++) {
+            nSeen += vBuckets[i];
+            if (nSeen >= nTarget) {
+                return std::min((int64_t)1 << i, nMax);
+            }
+        }
+        return nMax;
+    }
+
+    UniValue ToJSON() const
+    {
+        UniValue obj(UniValue::VOBJ);
+        obj.push_back(Pair("count", (int64_t)nCount));
+        obj.push_back(Pair("min", GetMin()));
+        obj.push_back(Pair("mean", GetMean()));
+        obj.push_back(Pair("p50", GetQuantile(0.5)));
+        obj.push_back(Pair("p90", GetQuantile(0.9)));
+        obj.push_back(Pair("p99", GetQuantile(0.99)));
+        obj.push_back(Pair("max", nMax));
+        // only non-empty buckets, keyed by their upper bound
+        UniValue buckets(UniValue::VOBJ);
+        for (int i = 0; i < BUCKETS; i++) {
+            if (vBuckets[i] == 0) continue;
+            std::string strKey = i == BUCKETS - 1 ? "inf" : strprintf("<%d", (int64_t)1 << i);
+            buckets.push_back(Pair(strKey, (int64_t)vBuckets[i]));
+        }
+        obj.push_back(Pair("buckets", buckets));
+        return obj;
+    }
+};
+
+#endif // LATENCYHISTOGRAM_H
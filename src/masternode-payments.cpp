@@ -12,6 +12,7 @@
 #include "messagesigner.h"
 #include "netfulfilledman.h"
 #include "netmessagemaker.h"
+#include "sigverifyqueue.h"
 #include "spork.h"
 #include "util.h"
 
@@ -467,41 +468,61 @@ void CMasternodePayments::ProcessMessage(CNode* pfrom, const std::string& strCom
             return;
         }
 
-        int nDos = 0;
-        if(!vote.CheckSignature(mnInfo.legacyKeyIDOperator, nCachedBlockHeight, nDos)) {
-            if(nDos) {
-                LOCK(cs_main);
-                LogPrintf("MASTERNODEPAYMENTVOTE -- ERROR: invalid signature\n");
-                Misbehaving(pfrom->GetId(), nDos);
-            } else {
-                // only warn about anything non-critical (i.e. nDos == 0) in debug mode
-                LogPrint("mnpayments", "MASTERNODEPAYMENTVOTE -- WARNING: invalid signature\n");
-            }
-            // Either our info or vote info could be outdated.
-            // In case our info is outdated, ask for an update,
-            mnodeman.AskForMN(pfrom, vote.masternodeOutpoint, connman);
-            // but there is nothing we can do if vote info itself is outdated
-            // (i.e. it was signed by a mn which changed its key),
-            // so just quit here.
-            return;
+        // Verify the signature on one of the sigVerifyQueue threads if possible,
+        // keep pfrom alive until the vote is processed
+        int nValidationHeight = nCachedBlockHeight;
+        auto pnDos = std::make_shared<int>(0);
+        pfrom->AddRef();
+        bool fQueued = sigVerifyQueue.AsyncVerify(
+            [vote, mnInfo, nValidationHeight, pnDos]() { return vote.CheckSignature(mnInfo.legacyKeyIDOperator, nValidationHeight, *pnDos); },
+            [this, pfrom, vote, pnDos, &connman](bool fSignatureValid) {
+                ProcessVerifiedPaymentVote(pfrom, vote, fSignatureValid, *pnDos, connman);
+                pfrom->Release();
+            });
+        if(!fQueued) {
+            pfrom->Release();
+            int nDos = 0;
+            bool fSignatureValid = vote.CheckSignature(mnInfo.legacyKeyIDOperator, nValidationHeight, nDos);
+            ProcessVerifiedPaymentVote(pfrom, vote, fSignatureValid, nDos, connman);
         }
+    }
+}
 
-        if(!UpdateLastVote(vote)) {
-            LogPrintf("MASTERNODEPAYMENTVOTE -- masternode already voted, masternode=%s\n", vote.masternodeOutpoint.ToStringShort());
-            return;
+void CMasternodePayments::ProcessVerifiedPaymentVote(CNode* pfrom, const CMasternodePaymentVote& vote, bool fSignatureValid, int nDos, CConnman& connman)
+{
+    if(!fSignatureValid) {
+        if(nDos) {
+            LOCK(cs_main);
+            LogPrintf("MASTERNODEPAYMENTVOTE -- ERROR: invalid signature\n");
+            Misbehaving(pfrom->GetId(), nDos);
+        } else {
+            // only warn about anything non-critical (i.e. nDos == 0) in debug mode
+            LogPrint("mnpayments", "MASTERNODEPAYMENTVOTE -- WARNING: invalid signature\n");
         }
+        // Either our info or vote info could be outdated.
+        // In case our info is outdated, ask for an update,
+        mnodeman.AskForMN(pfrom, vote.masternodeOutpoint, connman);
+        // but there is nothing we can do if vote info itself is outdated
+        // (i.e. it was signed by a mn which changed its key),
+        // so just quit here.
+        return;
+    }
 
-        CTxDestination address1;
-        ExtractDestination(vote.payee, address1);
-        CBitcoinAddress address2(address1);
+    if(!UpdateLastVote(vote)) {
+        LogPrintf("MASTERNODEPAYMENTVOTE -- masternode already voted, masternode=%s\n", vote.masternodeOutpoint.ToStringShort());
+        return;
+    }
 
-        LogPrint("mnpayments", "MASTERNODEPAYMENTVOTE -- vote: address=%s, nBlockHeight=%d, nHeight=%d, prevout=%s, hash=%s new\n",
-                    address2.ToString(), vote.nBlockHeight, nCachedBlockHeight, vote.masternodeOutpoint.ToStringShort(), nHash.ToString());
+    CTxDestination address1;
+    ExtractDestination(vote.payee, address1);
+    CBitcoinAddress address2(address1);
 
-        if(AddOrUpdatePaymentVote(vote)){
-            vote.Relay(connman);
-            masternodeSync.BumpAssetLastTime("MASTERNODEPAYMENTVOTE");
-        }
+    LogPrint("mnpayments", "MASTERNODEPAYMENTVOTE -- vote: address=%s, nBlockHeight=%d, nHeight=%d, prevout=%s, hash=%s new\n",
+                address2.ToString(), vote.nBlockHeight, nCachedBlockHeight, vote.masternodeOutpoint.ToStringShort(), vote.GetHash().ToString());
+
+    if(AddOrUpdatePaymentVote(vote)){
+        vote.Relay(connman);
+        masternodeSync.BumpAssetLastTime("MASTERNODEPAYMENTVOTE");
     }
 }
 
@@ -171,6 +171,9 @@ private:
     // Keep track of current block height
     int nCachedBlockHeight;
 
+    /// Finishes processing of a MASTERNODEPAYMENTVOTE message once its signature was checked
+    void ProcessVerifiedPaymentVote(CNode* pfrom, const CMasternodePaymentVote& vote, bool fSignatureValid, int nDos, CConnman& connman);
+
 public:
     std::map<uint256, CMasternodePaymentVote> mapMasternodePaymentVotes;
     std::map<int, CMasternodeBlockPayees> mapMasternodeBlocks;
@@ -5,6 +5,7 @@
 #ifndef BITCOIN_MEMUSAGE_H
 #define BITCOIN_MEMUSAGE_H
 
+#include "flathashmap.h"
 #include "indirectmap.h"
 
 #include <stdlib.h>
@@ -133,6 +134,14 @@ static inline size_t IncrementalDynamicUsage(const indirectmap<X, Y>& m)
     return MallocUsage(sizeof(stl_tree_node<std::pair<const X*, Y> >));
 }
 
+// flat_hash_map has a slot and a control byte per unit of capacity, whether it is used or not
+
+template<typename X, typename Y, typename Z>
+static inline size_t DynamicUsage(const flat_hash_map<X, Y, Z>& m)
+{
+    return m.capacity() ? MallocUsage(sizeof(std::pair<const X, Y>) * m.capacity()) + MallocUsage(m.capacity()) : 0;
+}
+
 template<typename X>
 static inline size_t DynamicUsage(const std::unique_ptr<X>& p)
 {
@@ -58,6 +58,137 @@ uint64_t nLastBlockTx = 0;
 uint64_t nLastBlockSize = 0;
 int64_t nLastCoinStakeSearchInterval = 0;
 
+static CCriticalSection cs_stakingStats;
+static CStakingStats stakingStats;
+
+CStakingStats GetStakingStats()
+{
+    LOCK(cs_stakingStats);
+    return stakingStats;
+}
+
+/** Adds its lifetime to one of the staking stats histograms, does nothing for nullptr */
+class CStakingStatsTimer
+{
+private:
+    CLatencyHistogram CStakingStats::*pHist;
+    int64_t nTimeStart;
+
+public:
+    CStakingStatsTimer(CLatencyHistogram CStakingStats::*pHistIn) : pHist(pHistIn), nTimeStart(GetTimeMicros()) {}
+
+    ~CStakingStatsTimer()
+    {
+        if (!pHist)
+            return;
+        int64_t nDuration = GetTimeMicros() - nTimeStart;
+        LOCK(cs_stakingStats);
+        (stakingStats.*pHist).Add(nDuration);
+    }
+};
+
+/**
+ * Wakes the stake minter up as soon as a new tip was connected, so that the kernel search on top
+ * of it starts right away instead of after the minter's next poll.
+ */
+class CStakeMinterWaker : public CValidationInterface
+{
+private:
+    boost::mutex cs;
+    CConditionVariable cond;
+    bool fNewTip;
+
+protected:
+    void UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload) override
+    {
+        {
+            boost::unique_lock<boost::mutex> lock(cs);
+            fNewTip = true;
+        }
+        cond.notify_all();
+    }
+
+public:
+    CStakeMinterWaker() : fNewTip(false) {}
+
+    /** Sleeps for nMillis or until a new tip arrives, returns true in the latter case. Interruptible like MilliSleep */
+    bool Wait(int64_t nMillis)
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        boost::system_time timeout = boost::get_system_time() + boost::posix_time::milliseconds(nMillis);
+        while (!fNewTip) {
+            if (!cond.timed_wait(lock, timeout))
+                break;
+        }
+        bool fRet = fNewTip;
+        fNewTip = false;
+        return fRet;
+    }
+};
+
+static CStakeMinterWaker stakeMinterWaker;
+
+/**
+ * Looks for a stake kernel on top of the current tip. Only the snapshot of the tip and of the
+ * wallet's stake candidates is taken under cs_main, the search itself runs without any lock
+ * so that block processing and mempool acceptance don't have to wait for it.
+ *
+ * Kernels are searched up to nHashDrift seconds ahead and every timestamp is only searched once
+ * per tip, so calling this every second only has to hash the one new timestamp per candidate.
+ */
+static bool SearchStakeKernel(CWallet* wallet, const CChainParams& chainparams, uint256& hashTipRet, unsigned int& nBitsRet, CStakeKernel& kernelRet)
+{
+    static int64_t nLastCoinStakeSearchTime = GetAdjustedTime();
+    static uint256 hashSearchedTip;
+    static int64_t nSearchedUntil = 0;
+
+    std::vector<CStakeCandidate> vCandidates;
+    unsigned int nTimeTip;
+    int64_t nMedianTimePast;
+    {
+        LOCK(cs_main);
+        CStakingStatsTimer timer(&CStakingStats::histSnapshotLock);
+        const CBlockIndex* pindexPrev = chainActive.Tip();
+        CBlockHeader header;
+        header.nTime = GetAdjustedTime();
+        hashTipRet = pindexPrev->GetBlockHash();
+        nTimeTip = pindexPrev->nTime;
+        nMedianTimePast = pindexPrev->GetMedianTimePast();
+        nBitsRet = GetNextWorkRequired(pindexPrev, &header, chainparams.GetConsensus());
+        if (!wallet->GetStakeCandidates(vCandidates))
+            return false;
+    }
+
+    if (hashTipRet != hashSearchedTip) {
+        hashSearchedTip = hashTipRet;
+        //prevent staking a time that won't be accepted
+        nSearchedUntil = nTimeTip;
+    }
+
+    int64_t nSearchTime = GetAdjustedTime(); // search to current time
+    if (nSearchTime < nLastCoinStakeSearchTime)
+        return false;
+    nLastCoinStakeSearchInterval = nSearchTime - nLastCoinStakeSearchTime;
+    nLastCoinStakeSearchTime = nSearchTime;
+
+    int64_t nTimeFrom = std::max(nSearchedUntil, nSearchTime);
+    int64_t nTimeTo = nSearchTime + wallet->GetHashDrift();
+    if (nTimeFrom >= nTimeTo)
+        return false;
+    nSearchedUntil = nTimeTo;
+
+    bool fFound;
+    {
+        CStakingStatsTimer timer(&CStakingStats::histKernelSearch);
+        fFound = wallet->FindStakeKernel(vCandidates, nBitsRet, nTimeFrom, nTimeTo, nMedianTimePast, kernelRet);
+    }
+    LOCK(cs_stakingStats);
+    stakingStats.nSearches++;
+    if (fFound)
+        stakingStats.nKernelsFound++;
+    return fFound;
+}
+
 class ScoreCompare
 {
 public:
@@ -135,7 +266,21 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(CWallet *wallet,
     pblocktemplate->vTxFees.push_back(-1); // updated at end
     pblocktemplate->vTxSigOps.push_back(-1); // updated at end
 
-    LOCK2(cs_main, mempool.cs);
+    uint256 hashStakeTip;
+    unsigned int nStakeBits = 0;
+    CStakeKernel stakeKernel;
+    if (fProofOfStake) {
+        assert(wallet);
+        boost::this_thread::interruption_point();
+        if (!SearchStakeKernel(wallet, chainparams, hashStakeTip, nStakeBits, stakeKernel))
+            return nullptr;
+    }
+
+    // lock order is cs_main, cs_wallet, mempool.cs
+    LOCK(cs_main);
+    LOCK(fProofOfStake ? &wallet->cs_wallet : nullptr);
+    LOCK(mempool.cs);
+    CStakingStatsTimer timer(fProofOfStake ? &CStakingStats::histAssembleLock : nullptr);
 
     bool fDIP0003Active_context = VersionBitsState(chainActive.Tip(), chainparams.GetConsensus(), Consensus::DEPLOYMENT_DIP0003, versionbitscache) == THRESHOLD_ACTIVE;
 
@@ -167,32 +312,20 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(CWallet *wallet,
     coinbaseTx.vout.resize(1);
     coinbaseTx.vout[0].scriptPubKey = scriptPubKeyIn;
     CAmount blockReward = nFees + GetBlockSubsidy(pindexPrev->nHeight, Params().GetConsensus());
-    std::vector<CWalletTx*> vwtxPrev;
-    static int64_t nLastCoinStakeSearchTime = GetAdjustedTime();
     if(fProofOfStake)
     {
-        assert(wallet);
-        boost::this_thread::interruption_point();
-        pblock->nBits = GetNextWorkRequired(pindexPrev, pblock, chainparams.GetConsensus());
         CMutableTransaction coinstakeTx;
-        int64_t nSearchTime = pblock->nTime; // search to current time
-        bool fStakeFound = false;
-        if (nSearchTime >= nLastCoinStakeSearchTime) {
-            unsigned int nTxNewTime = 0;
-            if (pwalletMain->CreateCoinStake(pblock->nBits, blockReward, coinstakeTx, nTxNewTime, vwtxPrev)) {
-                pblock->nTime = nTxNewTime;
-                coinbaseTx.vout[0].SetEmpty();
-                FillBlockPayments(coinstakeTx, nHeight, blockReward, pblocktemplate->voutMasternodePayments, pblocktemplate->voutSuperblockPayments);
-                pblock->vtx.emplace_back(MakeTransactionRef(coinstakeTx));
-                fStakeFound = true;
-            }
-
-            nLastCoinStakeSearchInterval = nSearchTime - nLastCoinStakeSearchTime;
-            nLastCoinStakeSearchTime = nSearchTime;
-        }
-
-        if (!fStakeFound)
+        // the tip or the stake input may have changed while we were searching without locks
+        if (pindexPrev->GetBlockHash() != hashStakeTip || !wallet->CreateCoinStake(stakeKernel, blockReward, coinstakeTx)) {
+            LOCK(cs_stakingStats);
+            stakingStats.nKernelsStale++;
             return nullptr;
+        }
+        pblock->nBits = nStakeBits;
+        pblock->nTime = stakeKernel.nTime;
+        coinbaseTx.vout[0].SetEmpty();
+        FillBlockPayments(coinstakeTx, nHeight, blockReward, pblocktemplate->voutMasternodePayments, pblocktemplate->voutSuperblockPayments);
+        pblock->vtx.emplace_back(MakeTransactionRef(coinstakeTx));
     }
     else
     {
@@ -686,7 +819,11 @@ void static PolisMinter(const CChainParams& chainparams, CConnman& connman,
     GetMainSignals().ScriptForMining(coinbaseScript);
     while (true) {
         try {
-            MilliSleep(1000);
+            // stake on a new tip right away, otherwise once per second to search the next timestamp
+            if (fProofOfStake)
+                stakeMinterWaker.Wait(1000);
+            else
+                MilliSleep(1000);
             // Throw an error if no script was provided.  This can happen
             // due to some internal error but also if the keypool is empty.
             // In the latter case, already the pointer is NULL.
@@ -708,7 +845,7 @@ void static PolisMinter(const CChainParams& chainparams, CConnman& connman,
                 {
                     LogPrintf("Not capable staking \n");
                     nLastCoinStakeSearchInterval = 0;
-                    MilliSleep(5000);
+                    stakeMinterWaker.Wait(5000);
                     continue;
                 }
             }
@@ -725,6 +862,10 @@ void static PolisMinter(const CChainParams& chainparams, CConnman& connman,
             std::unique_ptr<CBlockTemplate> pblocktemplate(BlockAssembler(Params()).CreateNewBlock(pwallet, chainparams, coinbaseScript->reserveScript, fProofOfStake));
             if (!pblocktemplate.get())
             {
+                if (fProofOfStake) {
+                    LogPrint("staking", "PolisMinter -- Failed to find a coinstake\n");
+                    continue;
+                }
                 LogPrintf("PolisMinter -- Failed to find a coinstake\n");
                 MilliSleep(5000);
                 continue;
@@ -755,7 +896,6 @@ void static PolisMinter(const CChainParams& chainparams, CConnman& connman,
                 SetThreadPriority(THREAD_PRIORITY_NORMAL);
                 ProcessBlockFound(pblock, chainparams);
                 SetThreadPriority(THREAD_PRIORITY_LOWEST);
-                MilliSleep(10000);
                 continue;
             }
             //
@@ -847,6 +987,7 @@ void ThreadStakeMinter(const CChainParams &chainparams, CConnman &connman, CWall
 {
     boost::this_thread::interruption_point();
     LogPrintf("ThreadStakeMinter started\n");
+    RegisterValidationInterface(&stakeMinterWaker);
     try {
         PolisMinter(chainparams, connman, pwallet, true);
         boost::this_thread::interruption_point();
@@ -855,5 +996,6 @@ void ThreadStakeMinter(const CChainParams &chainparams, CConnman &connman, CWall
     } catch (...) {
         LogPrintf("ThreadStakeMinter() error \n");
     }
+    UnregisterValidationInterface(&stakeMinterWaker);
     LogPrintf("ThreadStakeMinter exiting,\n");
 }
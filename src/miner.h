@@ -6,6 +6,7 @@
 #ifndef BITCOIN_MINER_H
 #define BITCOIN_MINER_H
 
+#include "latencyhistogram.h"
 #include "primitives/block.h"
 #include "txmempool.h"
 
@@ -35,6 +36,25 @@ struct CBlockTemplate
     std::vector<CTxOut> voutSuperblockPayments; // superblock payment
 };
 
+/** Where the stake minter spends its time, all histograms are in microseconds */
+struct CStakingStats
+{
+    // cs_main and cs_wallet held while taking the snapshot of the tip and the stake candidates
+    CLatencyHistogram histSnapshotLock;
+    // kernel search over the snapshot, no lock held
+    CLatencyHistogram histKernelSearch;
+    // cs_main, cs_wallet and mempool.cs held while assembling a proof-of-stake block
+    CLatencyHistogram histAssembleLock;
+    uint64_t nSearches;
+    uint64_t nKernelsFound;
+    // kernels found on a tip which changed before the block could be assembled
+    uint64_t nKernelsStale;
+
+    CStakingStats() : nSearches(0), nKernelsFound(0), nKernelsStale(0) {}
+};
+
+CStakingStats GetStakingStats();
+
 // Container for tracking updates to ancestor feerate as we include (parent)
 // transactions in a block
 struct CTxMemPoolModifiedEntry {
@@ -734,6 +734,8 @@ public:
     bool fSentAddr;
     // If 'true' this node will be disconnected on CMasternodeMan::ProcessMasternodeConnections()
     bool fMasternode;
+    // If 'true' this node announced (via "sendgovsum") that it can reconcile votes from vote summaries
+    std::atomic_bool fGovernanceSyncSummary;
     CSemaphoreGrant grantOutbound;
     CSemaphoreGrant grantMasternodeOutbound;
     CCriticalSection cs_filter;
@@ -1892,6 +1892,12 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::SENDHEADERS));
         }
 
+        if (!fLiteMode && pfrom->nVersion >= MIN_GOVERNANCE_PEER_PROTO_VERSION) {
+            // Tell our peer we can reconcile governance votes from vote summaries
+            // instead of bloom filters. Older peers just ignore this message.
+            connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::SENDGOVSYNCSUMMARY));
+        }
+
         if (pfrom->nVersion >= SHORT_IDS_BLOCKS_VERSION) {
             // Tell our peer we are willing to provide version-1 cmpctblocks
             // However, we do not request new block announcements using
@@ -1966,6 +1972,11 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         State(pfrom->GetId())->fPreferHeaders = true;
     }
 
+    else if (strCommand == NetMsgType::SENDGOVSYNCSUMMARY)
+    {
+        pfrom->fGovernanceSyncSummary = true;
+    }
+
 
     else if (strCommand == NetMsgType::SENDCMPCT)
     {
@@ -85,6 +85,7 @@ public:
     mutable CTxOut txoutMasternode; // masternode payment
     mutable std::vector<CTxOut> voutSuperblock; // superblock payment
     mutable bool fChecked;
+    mutable bool fCheckedMerkleRoot;
 
     CBlock()
     {
@@ -116,6 +117,7 @@ public:
         txoutMasternode = CTxOut();
         voutSuperblock.clear();
         fChecked = false;
+        fCheckedMerkleRoot = false;
         vchBlockSig.clear();
     }
 
@@ -68,6 +68,8 @@ const char *SYNCSTATUSCOUNT="ssc";
 const char *MNGOVERNANCESYNC="govsync";
 const char *MNGOVERNANCEOBJECT="govobj";
 const char *MNGOVERNANCEOBJECTVOTE="govobjvote";
+const char *MNGOVERNANCESYNCSUMMARY="govsyncsum";
+const char *SENDGOVSYNCSUMMARY="sendgovsum";
 const char *MNVERIFY="mnv";
 const char *GETMNLISTDIFF="getmnlistd";
 const char *MNLISTDIFF="mnlistdiff";
@@ -160,6 +162,8 @@ const static std::string allNetMessageTypes[] = {
     NetMsgType::MNGOVERNANCESYNC,
     NetMsgType::MNGOVERNANCEOBJECT,
     NetMsgType::MNGOVERNANCEOBJECTVOTE,
+    NetMsgType::MNGOVERNANCESYNCSUMMARY,
+    NetMsgType::SENDGOVSYNCSUMMARY,
     NetMsgType::MNVERIFY,
     NetMsgType::GETMNLISTDIFF,
     NetMsgType::MNLISTDIFF,
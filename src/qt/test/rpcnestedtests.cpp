@@ -11,6 +11,7 @@
 #include "rpc/server.h"
 #include "rpcconsole.h"
 #include "test/testutil.h"
+#include "txdb.h"
 #include "univalue.h"
 #include "util.h"
 
@@ -57,7 +58,8 @@ void RPCNestedTests::rpcNestedTests()
 
     llmq::InitLLMQSystem(*evoDb);
 
-    pcoinsTip = new CCoinsViewCache(pcoinsdbview);
+    pcoinsflushview = new CCoinsViewBackgroundFlush(pcoinsdbview, pcoinsdbview, []() { return evoDb->WriteCommitted(); });
+    pcoinsTip = new CCoinsViewCache(pcoinsflushview);
     InitBlockIndex(chainparams);
     {
         CValidationState state;
@@ -157,6 +159,7 @@ void RPCNestedTests::rpcNestedTests()
 #endif
 
     delete pcoinsTip;
+    delete pcoinsflushview;
     delete pcoinsdbview;
     delete pblocktree;
 
@@ -6,6 +6,7 @@
 #include "base58.h"
 #include "clientversion.h"
 #include "init.h"
+#include "instantx.h"
 #include "netbase.h"
 #include "validation.h"
 #include "masternode-payments.h"
@@ -161,6 +162,53 @@ void masternode_list_help()
         );
 }
 
+UniValue _instantsend(const JSONRPCRequest& request)
+{
+    std::string strCommand;
+    if (request.params.size() >= 1) {
+        strCommand = request.params[0].get_str();
+    }
+
+    if (request.fHelp || strCommand != "stats")
+        throw std::runtime_error(
+            "instantsend \"command\"\n"
+            "Set of commands to inspect InstantSend\n"
+            "\nArguments:\n"
+            "1. \"command\"        (string, required) The command to execute\n"
+            "\nAvailable commands:\n"
+            "  stats        - Print timing statistics of InstantSend locks seen by this node since startup\n"
+            "\nResult for stats:\n"
+            "{\n"
+            "  \"requests\": n,          (numeric) Lock requests received\n"
+            "  \"votes\": n,             (numeric) Lock votes received\n"
+            "  \"invalidvotes\": n,      (numeric) Lock votes which failed verification\n"
+            "  \"locks\": n,             (numeric) Transactions locked\n"
+            "  \"request_relay_ms\": {...},    (object) Lock request received -> accepted and relayed\n"
+            "  \"vote_verify_us\": {...},      (object) Verification of a single vote\n"
+            "  \"request_firstvote_ms\": {...}, (object) Lock request received -> first vote received\n"
+            "  \"request_lock_ms\": {...},     (object) Lock request received -> transaction locked\n"
+            "}\n"
+            "Each histogram has count, min, mean, p50, p90, p99 and max plus the counts of its non-empty\n"
+            "power of two buckets, percentiles are rounded up to the upper bound of their bucket.\n"
+            "\nExamples:\n"
+            + HelpExampleCli("instantsend", "stats")
+            + HelpExampleRpc("instantsend", "\"stats\"")
+        );
+
+    CInstantSendStats stats = instantsend.GetStats();
+
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("requests", (int64_t)stats.nRequests));
+    obj.push_back(Pair("votes", (int64_t)stats.nVotes));
+    obj.push_back(Pair("invalidvotes", (int64_t)stats.nVotesInvalid));
+    obj.push_back(Pair("locks", (int64_t)stats.nLocks));
+    obj.push_back(Pair("request_relay_ms", stats.histRequestRelay.ToJSON()));
+    obj.push_back(Pair("vote_verify_us", stats.histVoteVerify.ToJSON()));
+    obj.push_back(Pair("request_firstvote_ms", stats.histRequestFirstVote.ToJSON()));
+    obj.push_back(Pair("request_lock_ms", stats.histRequestLock.ToJSON()));
+    return obj;
+}
+
 UniValue masternode_list(const JSONRPCRequest& request)
 {
     if (request.fHelp)
@@ -1331,6 +1379,7 @@ static const CRPCCommand commands[] =
     { "polis",               "masternodebroadcast",    &masternodebroadcast,    true,  {} },
     { "polis",               "getpoolinfo",            &getpoolinfo,            true,  {} },
     { "polis",               "sentinelping",           &sentinelping,           true,  {} },
+    { "polis",               "instantsend",            &_instantsend,           true,  {} },
 #ifdef ENABLE_WALLET
     { "polis",               "privatesend",            &privatesend,            false, {} },
 #endif // ENABLE_WALLET
@@ -7,6 +7,7 @@
 #include "base58.h"
 #include "clientversion.h"
 #include "init.h"
+#include "miner.h"
 #include "net.h"
 #include "netbase.h"
 #include "rpc/server.h"
@@ -1166,6 +1167,37 @@ UniValue getstakingstatus(const JSONRPCRequest& request)
     return obj;
 }
 
+UniValue getstakingstats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+                "getstakingstats\n"
+                "Returns statistics about the stake minter since startup.\n"
+                "All durations are in microseconds.\n"
+                "\nResult:\n"
+                "{\n"
+                "  \"searches\": n,           (numeric) number of kernel searches\n"
+                "  \"kernelsfound\": n,       (numeric) number of kernels found\n"
+                "  \"kernelsstale\": n,       (numeric) kernels dropped because the tip or the stake input changed meanwhile\n"
+                "  \"snapshotlock\": {...},   (object) cs_main/cs_wallet hold time while collecting stake candidates\n"
+                "  \"kernelsearch\": {...},   (object) kernel search time, no locks held\n"
+                "  \"assemblelock\": {...}    (object) cs_main/cs_wallet/mempool.cs hold time while assembling a block\n"
+                "}\n"
+                "Each object contains count, min, mean, p50, p90, p99, max and the non-empty power of two buckets.\n"
+                "\nExamples:\n" +
+                HelpExampleCli("getstakingstats", "") + HelpExampleRpc("getstakingstats", ""));
+
+    CStakingStats stats = GetStakingStats();
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("searches", (int64_t)stats.nSearches));
+    obj.push_back(Pair("kernelsfound", (int64_t)stats.nKernelsFound));
+    obj.push_back(Pair("kernelsstale", (int64_t)stats.nKernelsStale));
+    obj.push_back(Pair("snapshotlock", stats.histSnapshotLock.ToJSON()));
+    obj.push_back(Pair("kernelsearch", stats.histKernelSearch.ToJSON()));
+    obj.push_back(Pair("assemblelock", stats.histAssembleLock.ToJSON()));
+    return obj;
+}
+
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         okSafeMode
   //  --------------------- ------------------------  -----------------------  ----------
@@ -1177,6 +1209,7 @@ static const CRPCCommand commands[] =
     { "util",               "verifymessage",          &verifymessage,          true,  {"address","signature","message"} },
     { "util",               "signmessagewithprivkey", &signmessagewithprivkey, true,  {"privkey","message"} },
     { "util",               "getstakingstatus",       &getstakingstatus,       true,  {} },
+    { "util",               "getstakingstats",        &getstakingstats,        true,  {} },
     { "blockchain",         "getspentinfo",           &getspentinfo,           false, {"json"} },
 
     /* Address index */
@@ -19,6 +19,7 @@
 #include <stdint.h>
 #include <string>
 #include <string.h>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -593,6 +594,12 @@ template<typename Stream, typename K, typename T, typename Pred, typename A> voi
 template<typename Stream, typename K, typename Pred, typename A> void Serialize(Stream& os, const std::set<K, Pred, A>& m);
 template<typename Stream, typename K, typename Pred, typename A> void Unserialize(Stream& is, std::set<K, Pred, A>& m);
 
+/**
+ * unordered_map
+ */
+template<typename Stream, typename K, typename T, typename H, typename E, typename A> void Serialize(Stream& os, const std::unordered_map<K, T, H, E, A>& m);
+template<typename Stream, typename K, typename T, typename H, typename E, typename A> void Unserialize(Stream& is, std::unordered_map<K, T, H, E, A>& m);
+
 /**
  * shared_ptr
  */
@@ -894,6 +901,30 @@ void Unserialize(Stream& is, std::set<K, Pred, A>& m)
     }
 }
 
+/**
+ * unordered_map, same format as map so that both can be used for the same data
+ */
+template<typename Stream, typename K, typename T, typename H, typename E, typename A>
+void Serialize(Stream& os, const std::unordered_map<K, T, H, E, A>& m)
+{
+    WriteCompactSize(os, m.size());
+    for (typename std::unordered_map<K, T, H, E, A>::const_iterator mi = m.begin(); mi != m.end(); ++mi)
+        Serialize(os, (*mi));
+}
+
+template<typename Stream, typename K, typename T, typename H, typename E, typename A>
+void Unserialize(Stream& is, std::unordered_map<K, T, H, E, A>& m)
+{
+    m.clear();
+    unsigned int nSize = ReadCompactSize(is);
+    for (unsigned int i = 0; i < nSize; i++)
+    {
+        std::pair<K, T> item;
+        Unserialize(is, item);
+        m.insert(std::move(item));
+    }
+}
+
 /**
  * list
  */
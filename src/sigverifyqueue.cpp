@@ -0,0 +1,156 @@
+// Copyright (c) 2014-2018 The Polis Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "sigverifyqueue.h"
+
+#include "bls/bls.h"
+#include "bls/bls_worker.h"
+#include "util.h"
+
+CSigVerifyQueue sigVerifyQueue;
+
+CSigVerifyQueue::CSigVerifyQueue() :
+    nJobsInFlight(0),
+    nThreads(0),
+    fRunning(false),
+    fStopRequested(false)
+{
+}
+
+CSigVerifyQueue::~CSigVerifyQueue()
+{
+    Stop();
+}
+
+void CSigVerifyQueue::Start(int nThreadsIn)
+{
+    std::unique_lock<std::mutex> l(mutex);
+    if (fRunning || fStopRequested) {
+        // the thread pool can't be restarted once stopped
+        return;
+    }
+
+    nThreads = std::max(1, std::min(nThreadsIn, MAX_SIGVERIFY_THREADS));
+    workerPool.resize(nThreads);
+    RenameThreadPool(workerPool, "sigverify");
+    blsWorker.reset(new CBLSWorker());
+    batchThread = std::thread([this] { TraceThread("sigbatch", [this] { ThreadBatch(); }); });
+
+    fRunning = true;
+    LogPrintf("CSigVerifyQueue::%s -- using %d threads for signature verification\n", __func__, nThreads);
+}
+
+void CSigVerifyQueue::Stop()
+{
+    {
+        std::unique_lock<std::mutex> l(mutex);
+        if (!fRunning || fStopRequested) {
+            return;
+        }
+        // refuse new jobs from now on, the batch thread dispatches whatever is still pending before it exits
+        fStopRequested = true;
+    }
+    condPending.notify_all();
+    batchThread.join();
+
+    {
+        std::unique_lock<std::mutex> l(mutex);
+        condIdle.wait(l, [this] { return nJobsInFlight == 0; });
+    }
+
+    blsWorker.reset();
+    workerPool.stop(true);
+
+    std::unique_lock<std::mutex> l(mutex);
+    fRunning = false;
+}
+
+bool CSigVerifyQueue::IsRunning()
+{
+    std::unique_lock<std::mutex> l(mutex);
+    return fRunning && !fStopRequested;
+}
+
+bool CSigVerifyQueue::ReserveJob()
+{
+    // mutex must be held
+    if (!fRunning || fStopRequested || nJobsInFlight >= MAX_JOBS_IN_FLIGHT) {
+        return false;
+    }
+    nJobsInFlight++;
+    return true;
+}
+
+void CSigVerifyQueue::JobDone()
+{
+    std::unique_lock<std::mutex> l(mutex);
+    if (--nJobsInFlight == 0) {
+        condIdle.notify_all();
+    }
+}
+
+bool CSigVerifyQueue::AsyncVerify(VerifyFunc&& verify, DoneCallback&& done)
+{
+    {
+        std::unique_lock<std::mutex> l(mutex);
+        if (!ReserveJob()) {
+            return false;
+        }
+        vecPendingJobs.push_back(Job{std::move(verify), std::move(done)});
+    }
+    condPending.notify_one();
+    return true;
+}
+
+bool CSigVerifyQueue::AsyncVerifyBLS(const CBLSSignature& sig, const CBLSPublicKey& pubKey, const uint256& msgHash, DoneCallback&& done)
+{
+    {
+        std::unique_lock<std::mutex> l(mutex);
+        if (!ReserveJob()) {
+            return false;
+        }
+    }
+    // blsWorker is only reset after all jobs in flight are done
+    blsWorker->AsyncVerifySig(sig, pubKey, msgHash, [this, done](bool fValid) {
+        done(fValid);
+        JobDone();
+    });
+    return true;
+}
+
+void CSigVerifyQueue::ThreadBatch()
+{
+    std::unique_lock<std::mutex> l(mutex);
+    while (true) {
+        condPending.wait(l, [this] { return fStopRequested || !vecPendingJobs.empty(); });
+        if (vecPendingJobs.empty()) {
+            // stop requested and nothing left to dispatch
+            break;
+        }
+
+        // give other messages a chance to arrive, so that we can verify them in the same batch
+        condPending.wait_for(l, std::chrono::milliseconds(BATCH_WINDOW_MS), [this] {
+            return fStopRequested || vecPendingJobs.size() >= MAX_BATCH_SIZE;
+        });
+
+        auto jobs = std::make_shared<std::vector<Job> >();
+        jobs->swap(vecPendingJobs);
+        l.unlock();
+
+        size_t nBatchSize = (jobs->size() + nThreads - 1) / nThreads;
+        for (size_t nBegin = 0; nBegin < jobs->size(); nBegin += nBatchSize) {
+            size_t nEnd = std::min(nBegin + nBatchSize, jobs->size());
+            workerPool.push([this, jobs, nBegin, nEnd](int threadId) {
+                for (size_t i = nBegin; i < nEnd; i++) {
+                    Job& job = (*jobs)[i];
+                    job.done(job.verify());
+                    JobDone();
+                }
+            });
+        }
+        LogPrint("sigverify", "CSigVerifyQueue::%s -- dispatched %d jobs in batches of %d\n", __func__, jobs->size(), nBatchSize);
+
+        l.lock();
+    }
+}
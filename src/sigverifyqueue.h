@@ -0,0 +1,92 @@
+// Copyright (c) 2014-2018 The Polis Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef SIGVERIFYQUEUE_H
+#define SIGVERIFYQUEUE_H
+
+#include "ctpl.h"
+#include "uint256.h"
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class CBLSPublicKey;
+class CBLSSignature;
+class CBLSWorker;
+
+/** -sigverifythreads default, 0 = auto */
+static const int DEFAULT_SIGVERIFY_THREADS = 0;
+/** Maximum number of dedicated signature verification threads */
+static const int MAX_SIGVERIFY_THREADS = 16;
+
+/**
+ * Verifies signatures of incoming masternode/governance messages off the message handler thread.
+ *
+ * ECDSA jobs are collected for a short window and then handed to a thread pool, split into one batch
+ * per worker. BLS jobs are forwarded to CBLSWorker which aggregates them into batched verifications.
+ * The done callback is called from a worker thread once the signature was checked, so callers must
+ * lock whatever they touch in there and keep referenced objects (e.g. CNode) alive until then.
+ */
+class CSigVerifyQueue
+{
+public:
+    typedef std::function<bool()> VerifyFunc;
+    typedef std::function<void(bool)> DoneCallback;
+
+    /// How long ECDSA jobs are collected before they are dispatched, in milliseconds
+    static const int BATCH_WINDOW_MS = 10;
+    /// Pending ECDSA jobs are dispatched right away once there are that many
+    static const size_t MAX_BATCH_SIZE = 128;
+    /// New jobs are refused while that many are in flight, callers then verify synchronously
+    static const size_t MAX_JOBS_IN_FLIGHT = 10000;
+
+private:
+    struct Job {
+        VerifyFunc verify;
+        DoneCallback done;
+    };
+
+    std::mutex mutex;
+    std::condition_variable condPending;
+    std::condition_variable condIdle;
+    std::vector<Job> vecPendingJobs;
+    size_t nJobsInFlight;
+    int nThreads;
+    bool fRunning;
+    bool fStopRequested;
+
+    ctpl::thread_pool workerPool;
+    std::unique_ptr<CBLSWorker> blsWorker;
+    std::thread batchThread;
+
+    void ThreadBatch();
+    void JobDone();
+    /// Reserves a slot for a new job, returns false if the job should be verified synchronously instead
+    bool ReserveJob();
+
+public:
+    CSigVerifyQueue();
+    ~CSigVerifyQueue();
+
+    void Start(int nThreadsIn);
+    /// Waits for all jobs in flight (including their callbacks) to finish, the queue can't be restarted afterwards
+    void Stop();
+    bool IsRunning();
+
+    /**
+     * Queue an ECDSA (or any other CPU bound) signature check. Returns false if the queue is not running
+     * or is overloaded, neither verify nor done are called in this case.
+     */
+    bool AsyncVerify(VerifyFunc&& verify, DoneCallback&& done);
+    /// Same as above but batched through CBLSWorker::AsyncVerifySig
+    bool AsyncVerifyBLS(const CBLSSignature& sig, const CBLSPublicKey& pubKey, const uint256& msgHash, DoneCallback&& done);
+};
+
+extern CSigVerifyQueue sigVerifyQueue;
+
+#endif // SIGVERIFYQUEUE_H
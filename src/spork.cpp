@@ -6,6 +6,7 @@
 
 #include "base58.h"
 #include "chainparams.h"
+#include "governance.h"
 #include "validation.h"
 #include "messagesigner.h"
 #include "net_processing.h"
@@ -176,6 +177,9 @@ void CSporkManager::ProcessSpork(CNode* pfrom, const std::string& strCommand, CD
             mapSporksByHash[hash] = spork;
             mapSporksActive[spork.nSporkID][keyIDSigner] = spork;
         }
+        if (spork.nSporkID == SPORK_15_DETERMINISTIC_MNS_ENABLED) {
+            governance.ResetMinVoteTime();
+        }
         spork.Relay(connman);
 
         //does a task if needed
@@ -236,9 +240,14 @@ bool CSporkManager::UpdateSpork(int nSporkID, int64_t nValue, CConnman& connman)
             return false;
         }
         spork.Relay(connman);
-        LOCK(cs);
-        mapSporksByHash[spork.GetHash()] = spork;
-        mapSporksActive[nSporkID][keyIDSigner] = spork;
+        {
+            LOCK(cs);
+            mapSporksByHash[spork.GetHash()] = spork;
+            mapSporksActive[nSporkID][keyIDSigner] = spork;
+        }
+        if (nSporkID == SPORK_15_DETERMINISTIC_MNS_ENABLED) {
+            governance.ResetMinVoteTime();
+        }
         return true;
     }
 
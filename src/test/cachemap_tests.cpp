@@ -133,4 +133,45 @@ BOOST_AUTO_TEST_CASE(cachemap_test)
     BOOST_CHECK(Compare(cmapTest1, mapTest4));
 }
 
+BOOST_AUTO_TEST_CASE(cachemap_itemlist_test)
+{
+    CacheMap<int,int> cmapTest(100);
+    for(int i = 0; i < 1000; ++i) {
+        cmapTest.Insert(i, i * 2);
+    }
+    BOOST_CHECK(cmapTest.GetSize() == 100);
+
+    // items are listed from the most to the least recently inserted one
+    int nExpected = 999;
+    const CacheMap<int,int>::list_t& items = cmapTest.GetItemList();
+    for(CacheMap<int,int>::list_cit it = items.begin(); it != items.end(); ++it) {
+        BOOST_CHECK(it->key == nExpected && it->value == nExpected * 2);
+        --nExpected;
+    }
+    BOOST_CHECK(nExpected == 899);
+
+    // erasing the item we just passed must not invalidate the iterator
+    CacheMap<int,int>::list_cit it = items.begin();
+    while(it != items.end()) {
+        int nKey = it->key;
+        ++it;
+        if(nKey % 2 == 0) {
+            cmapTest.Erase(nKey);
+        }
+    }
+    BOOST_CHECK(cmapTest.GetSize() == 50);
+    BOOST_CHECK(!cmapTest.HasKey(998));
+    BOOST_CHECK(cmapTest.HasKey(999));
+
+    // serialized the same way as the std::list based implementation was
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << cmapTest;
+    uint32_t nMaxSize;
+    std::list<CacheItem<int,int> > listItems;
+    ss >> nMaxSize >> listItems;
+    BOOST_CHECK(nMaxSize == 100);
+    BOOST_CHECK(listItems.size() == 50);
+    BOOST_CHECK(listItems.front().key == 999 && listItems.back().key == 901);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
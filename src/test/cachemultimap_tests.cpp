@@ -173,4 +173,68 @@ BOOST_AUTO_TEST_CASE(cachemultimap_test)
     BOOST_CHECK(Compare(cmmapTest1, mapTest4));
 }
 
+BOOST_AUTO_TEST_CASE(cachemultimap_many_values_test)
+{
+    // one key with thousands of values next to keys with a single value, like orphan votes of one object
+    const int nValues = 5000;
+    CacheMultiMap<int,int> cmmap(nValues + 10);
+    for(int i = 0; i < nValues; ++i) {
+        BOOST_CHECK(cmmap.Insert(-1, i));
+    }
+    for(int i = 0; i < 10; ++i) {
+        cmmap.Insert(i, i);
+    }
+    BOOST_CHECK(!cmmap.Insert(-1, 42));
+    BOOST_CHECK(cmmap.GetSize() == nValues + 10);
+
+    int nVal = -1;
+    BOOST_CHECK(cmmap.Get(-1, nVal) && nVal == 0);
+
+    // erase every other value the way governance cleans up orphan votes, with references into the items
+    const CacheMultiMap<int,int>::list_t& listItems = cmmap.GetItemList();
+    CacheMultiMap<int,int>::list_cit it = listItems.begin();
+    while(it != listItems.end()) {
+        CacheMultiMap<int,int>::list_cit prevIt = it++;
+        if(prevIt->key == -1 && prevIt->value % 2 == 1) {
+            cmmap.Erase(prevIt->key, prevIt->value);
+        }
+    }
+    BOOST_CHECK(cmmap.GetSize() == nValues / 2 + 10);
+
+    std::vector<int> vecVals;
+    BOOST_CHECK(cmmap.GetAll(-1, vecVals));
+    BOOST_CHECK(vecVals.size() == nValues / 2);
+    for(size_t i = 0; i < vecVals.size(); ++i) {
+        BOOST_CHECK(vecVals[i] == (int)i * 2);
+    }
+
+    // filling up the map evicts the oldest values of the key first, the other keys stay
+    for(int i = 0; i < nValues / 2; ++i) {
+        cmmap.Insert(-2, i);
+    }
+    BOOST_CHECK(cmmap.GetSize() == nValues + 10);
+    cmmap.Insert(-2, nValues);
+    BOOST_CHECK(cmmap.GetSize() == nValues + 10);
+    BOOST_CHECK(cmmap.Get(-1, nVal) && nVal == 2);
+    for(int i = 0; i < 10; ++i) {
+        BOOST_CHECK(cmmap.HasKey(i));
+    }
+
+    std::vector<int> vecKeys;
+    cmmap.GetKeys(vecKeys);
+    BOOST_CHECK(vecKeys.size() == 12);
+    BOOST_CHECK(vecKeys.front() == -2 && vecKeys.back() == 9);
+
+    // erasing a key through a reference into one of its items removes all of its values
+    cmmap.Erase(listItems.begin()->key);
+    BOOST_CHECK(!cmmap.HasKey(-2));
+    BOOST_CHECK(cmmap.GetSize() == nValues / 2 - 1 + 10);
+    cmmap.Erase(-1);
+    BOOST_CHECK(!cmmap.HasKey(-1));
+    BOOST_CHECK(cmmap.GetSize() == 10);
+    for(int i = 0; i < 10; ++i) {
+        BOOST_CHECK(cmmap.Get(i, nVal) && nVal == i);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -4,6 +4,7 @@
 
 #include "coins.h"
 #include "script/standard.h"
+#include "txdb.h"
 #include "uint256.h"
 #include "undo.h"
 #include "utilstrencodings.h"
@@ -856,4 +857,55 @@ BOOST_AUTO_TEST_CASE(ccoins_write)
                     CheckWriteCoins(parent_value, child_value, parent_value, parent_flags, child_flags, parent_flags);
 }
 
+BOOST_FIXTURE_TEST_CASE(ccoins_background_flush, TestingSetup)
+{
+    CCoinsViewDB db(1 << 20, true);
+    int nAfterWrite = 0;
+    bool fAfterWriteFails = false;
+    CCoinsViewBackgroundFlush flushview(&db, &db, [&nAfterWrite, &fAfterWriteFails]() { nAfterWrite++; return !fAfterWriteFails; });
+    const COutPoint outpoint(GetRandHash(), 0);
+    const uint256 hashBlock1 = GetRandHash();
+    const uint256 hashBlock2 = GetRandHash();
+
+    CCoinsViewCache cache1(&flushview);
+    cache1.AddCoin(outpoint, Coin(CTxOut(VALUE1, CScript() << OP_TRUE), 1, false, false), false);
+    cache1.SetBestBlock(hashBlock1);
+    BOOST_CHECK(cache1.Flush());
+    // the flushed coin is visible whether it's written yet or not
+    BOOST_CHECK(flushview.HaveCoin(outpoint));
+    BOOST_CHECK(flushview.GetBestBlock() == hashBlock1);
+    BOOST_CHECK(flushview.WaitForFlush());
+    BOOST_CHECK(!flushview.IsFlushing());
+    BOOST_CHECK(db.HaveCoin(outpoint));
+    BOOST_CHECK(db.GetBestBlock() == hashBlock1);
+    BOOST_CHECK_EQUAL(nAfterWrite, 1);
+
+    // the spend is visible before it reaches the database
+    CCoinsViewCache cache2(&flushview);
+    BOOST_CHECK(cache2.SpendCoin(outpoint));
+    cache2.SetBestBlock(hashBlock2);
+    BOOST_CHECK(cache2.Flush());
+    BOOST_CHECK(!flushview.HaveCoin(outpoint));
+    BOOST_CHECK(flushview.GetBestBlock() == hashBlock2);
+    BOOST_CHECK(flushview.WaitForFlush());
+    BOOST_CHECK(!db.HaveCoin(outpoint));
+    BOOST_CHECK(db.GetBestBlock() == hashBlock2);
+    BOOST_CHECK_EQUAL(nAfterWrite, 2);
+
+    // a failed flush is reported every time, and nothing is written after it
+    fAfterWriteFails = true;
+    CCoinsViewCache cache3(&flushview);
+    cache3.AddCoin(outpoint, Coin(CTxOut(VALUE1, CScript() << OP_TRUE), 3, false, false), false);
+    cache3.SetBestBlock(GetRandHash());
+    BOOST_CHECK(cache3.Flush());
+    BOOST_CHECK(!flushview.WaitForFlush());
+    BOOST_CHECK(!flushview.WaitForFlush());
+    fAfterWriteFails = false;
+    CCoinsViewCache cache4(&flushview);
+    cache4.AddCoin(COutPoint(GetRandHash(), 0), Coin(CTxOut(VALUE1, CScript() << OP_TRUE), 4, false, false), false);
+    cache4.SetBestBlock(GetRandHash());
+    BOOST_CHECK(!cache4.Flush());
+    BOOST_CHECK_EQUAL(nAfterWrite, 3);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,158 @@
+// Copyright (c) 2014-2018 The Polis Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bloom.h"
+#include "chainparams.h"
+#include "governance-object.h"
+#include "governance-votedb.h"
+#include "protocol.h"
+#include "random.h"
+#include "version.h"
+
+#include "test/test_polis.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(governance_votesync_tests, BasicTestingSetup)
+
+static std::vector<CGovernanceVote> CreateVotes(const uint256& nParentHash, size_t nCount)
+{
+    std::vector<CGovernanceVote> vecVotes;
+    for (size_t i = 0; i < nCount; ++i) {
+        CGovernanceVote vote(COutPoint(GetRandHash(), 0), nParentHash, VOTE_SIGNAL_FUNDING, (i % 2) ? VOTE_OUTCOME_YES : VOTE_OUTCOME_NO);
+        vote.SetTime(1500000000 + i);
+        vecVotes.push_back(vote);
+    }
+    return vecVotes;
+}
+
+struct SyncResult {
+    size_t nRequestBytes;
+    size_t nInvCount;
+    size_t nMissingReceived;
+
+    size_t GetTotalBytes() const
+    {
+        return nRequestBytes + nInvCount * ::GetSerializeSize(CInv(), SER_NETWORK, PROTOCOL_VERSION);
+    }
+};
+
+// Simulates the "govsync" round trip between a requesting and a responding node, see
+// CGovernanceManager::RequestGovernanceObject and SyncSingleObjAndItsVotes
+static SyncResult SyncWithFilter(const uint256& nParentHash, const CGovernanceObjectVoteFile& requester, const CGovernanceObjectVoteFile& responder)
+{
+    CBloomFilter filter;
+    filter.clear();
+    if (requester.GetVoteCount() > 0) {
+        filter = CBloomFilter(Params().GetConsensus().nGovernanceFilterElements, GOVERNANCE_FILTER_FP_RATE, GetRandInt(999999), BLOOM_UPDATE_ALL);
+        for (const auto& vote : requester.GetVotes()) {
+            filter.insert(vote.GetHash());
+        }
+    }
+
+    SyncResult result{::GetSerializeSize(nParentHash, SER_NETWORK, PROTOCOL_VERSION) + ::GetSerializeSize(filter, SER_NETWORK, PROTOCOL_VERSION), 0, 0};
+    for (const auto& vote : responder.GetVotes()) {
+        if (filter.contains(vote.GetHash())) continue;
+        ++result.nInvCount;
+        if (!requester.HasVote(vote.GetHash())) ++result.nMissingReceived;
+    }
+    return result;
+}
+
+// Same round trip using "govsyncsum" vote summaries, the requesting node expects nExpectedVotes votes in total
+static SyncResult SyncWithSummary(const uint256& nParentHash, const CGovernanceObjectVoteFile& requester, const CGovernanceObjectVoteFile& responder, size_t nExpectedVotes)
+{
+    size_t nVoteCount = requester.GetVoteCount();
+    size_t nBuckets = CGovernanceVoteSummary::GetBucketCountFor(nVoteCount, nExpectedVotes > nVoteCount ? nExpectedVotes - nVoteCount : 0);
+    CGovernanceVoteSummary summary = requester.GetVoteSummary(nBuckets, GetRand(std::numeric_limits<uint64_t>::max()));
+    BOOST_CHECK(summary.IsValid());
+
+    SyncResult result{::GetSerializeSize(nParentHash, SER_NETWORK, PROTOCOL_VERSION) + ::GetSerializeSize(summary, SER_NETWORK, PROTOCOL_VERSION), 0, 0};
+    for (const auto& vote : responder.GetVotesNotMatchingSummary(summary)) {
+        ++result.nInvCount;
+        if (!requester.HasVote(vote.GetHash())) ++result.nMissingReceived;
+    }
+    return result;
+}
+
+BOOST_AUTO_TEST_CASE(votesummary_bucket_count)
+{
+    // no votes need no buckets, more missing votes need more buckets
+    BOOST_CHECK_EQUAL(CGovernanceVoteSummary::GetBucketCountFor(0, 1000), 0);
+    BOOST_CHECK(CGovernanceVoteSummary::GetBucketCountFor(10, 0) <= 4);
+    BOOST_CHECK(CGovernanceVoteSummary::GetBucketCountFor(5000, 0) < CGovernanceVoteSummary::GetBucketCountFor(5000, 50));
+    BOOST_CHECK(CGovernanceVoteSummary::GetBucketCountFor(5000, 50) < CGovernanceVoteSummary::GetBucketCountFor(5000, 1000));
+    BOOST_CHECK_EQUAL(CGovernanceVoteSummary::GetBucketCountFor(5000, 2500), CGovernanceVoteSummary::MAX_BUCKETS);
+    // when nearly every bucket would differ anyway the smallest summary is the cheapest
+    BOOST_CHECK_EQUAL(CGovernanceVoteSummary::GetBucketCountFor(1000000, 1000000), 1);
+
+    BOOST_CHECK(CGovernanceVoteSummary(0, 0).IsValid());
+    BOOST_CHECK(!CGovernanceVoteSummary(3, 0).IsValid());
+    BOOST_CHECK(!CGovernanceVoteSummary(CGovernanceVoteSummary::MAX_BUCKETS * 2, 0).IsValid());
+    BOOST_CHECK(CGovernanceVoteSummary(64, 0).IsValid());
+
+    // invalid summaries never produce any votes
+    CGovernanceObjectVoteFile file;
+    for (const auto& vote : CreateVotes(GetRandHash(), 10)) {
+        file.AddVote(vote);
+    }
+    BOOST_CHECK(file.GetVotesNotMatchingSummary(CGovernanceVoteSummary(3, 0)).empty());
+    // an empty summary gets all votes
+    BOOST_CHECK_EQUAL(file.GetVotesNotMatchingSummary(CGovernanceVoteSummary(0, 0)).size(), 10);
+}
+
+BOOST_AUTO_TEST_CASE(votesummary_two_node_sync)
+{
+    const uint256 nParentHash = GetRandHash();
+    const size_t nTotalVotes = 5000;
+    std::vector<CGovernanceVote> vecVotes = CreateVotes(nParentHash, nTotalVotes);
+
+    CGovernanceObjectVoteFile responder;
+    for (const auto& vote : vecVotes) {
+        responder.AddVote(vote);
+    }
+
+    // number of votes the requesting node already has
+    for (size_t nKnown : {size_t(0), nTotalVotes / 5, nTotalVotes / 2, nTotalVotes * 4 / 5, nTotalVotes - 50, nTotalVotes}) {
+        CGovernanceObjectVoteFile requester;
+        for (size_t i = 0; i < nKnown; ++i) {
+            requester.AddVote(vecVotes[i]);
+        }
+
+        SyncResult filterResult = SyncWithFilter(nParentHash, requester, responder);
+        SyncResult summaryResult = SyncWithSummary(nParentHash, requester, responder, nTotalVotes);
+
+        BOOST_TEST_MESSAGE(strprintf("known votes %d/%d: bloom filter %d bytes (%d inv), vote summary %d bytes (%d inv)",
+            nKnown, nTotalVotes, filterResult.GetTotalBytes(), filterResult.nInvCount, summaryResult.GetTotalBytes(), summaryResult.nInvCount));
+
+        // vote summaries must never miss a vote, the bloom filter may due to false positives
+        BOOST_CHECK_EQUAL(summaryResult.nMissingReceived, nTotalVotes - nKnown);
+        // with the buckets sized for the missing votes the summary never costs more than a bloom filter
+        BOOST_CHECK(summaryResult.GetTotalBytes() < filterResult.GetTotalBytes());
+        if (nKnown == nTotalVotes) {
+            BOOST_CHECK_EQUAL(summaryResult.nInvCount, 0);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(votesummary_requester_has_extra_votes)
+{
+    const uint256 nParentHash = GetRandHash();
+    std::vector<CGovernanceVote> vecVotes = CreateVotes(nParentHash, 300);
+
+    // both nodes know votes the other one doesn't have
+    CGovernanceObjectVoteFile nodeA;
+    CGovernanceObjectVoteFile nodeB;
+    for (size_t i = 0; i < vecVotes.size(); ++i) {
+        if (i % 3 != 0) nodeA.AddVote(vecVotes[i]);
+        if (i % 3 != 1) nodeB.AddVote(vecVotes[i]);
+    }
+
+    SyncResult resultA = SyncWithSummary(nParentHash, nodeA, nodeB, vecVotes.size());
+    SyncResult resultB = SyncWithSummary(nParentHash, nodeB, nodeA, vecVotes.size());
+    BOOST_CHECK_EQUAL(resultA.nMissingReceived, 100);
+    BOOST_CHECK_EQUAL(resultB.nMissingReceived, 100);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,54 @@
+// Copyright (c) 2014-2018 The Polis Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "latencyhistogram.h"
+
+#include "test/test_polis.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(latencyhistogram_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(latencyhistogram_test)
+{
+    CLatencyHistogram hist;
+    BOOST_CHECK_EQUAL(hist.GetCount(), 0);
+    BOOST_CHECK_EQUAL(hist.GetMin(), 0);
+    BOOST_CHECK_EQUAL(hist.GetMean(), 0);
+    BOOST_CHECK_EQUAL(hist.GetQuantile(0.5), 0);
+
+    // 90 fast samples and 10 slow ones
+    for (int i = 0; i < 90; i++) {
+        hist.Add(3);
+    }
+    for (int i = 0; i < 10; i++) {
+        hist.Add(1000);
+    }
+    BOOST_CHECK_EQUAL(hist.GetCount(), 100);
+    BOOST_CHECK_EQUAL(hist.GetMin(), 3);
+    BOOST_CHECK_EQUAL(hist.GetMax(), 1000);
+    BOOST_CHECK_EQUAL(hist.GetMean(), (90 * 3 + 10 * 1000) / 100);
+    // 3 is in [2, 4), 1000 in [512, 1024) which is capped at the maximum
+    BOOST_CHECK_EQUAL(hist.GetQuantile(0.5), 4);
+    BOOST_CHECK_EQUAL(hist.GetQuantile(0.9), 4);
+    BOOST_CHECK_EQUAL(hist.GetQuantile(0.99), 1000);
+
+    UniValue json = hist.ToJSON();
+    BOOST_CHECK_EQUAL(json["count"].get_int64(), 100);
+    BOOST_CHECK_EQUAL(json["buckets"]["<4"].get_int64(), 90);
+    BOOST_CHECK_EQUAL(json["buckets"]["<1024"].get_int64(), 10);
+
+    // negative durations count as 0, huge ones end up in the last bucket
+    hist.Add(-5);
+    hist.Add(std::numeric_limits<int64_t>::max() / 2);
+    BOOST_CHECK_EQUAL(hist.GetMin(), 0);
+    BOOST_CHECK_EQUAL(hist.ToJSON()["buckets"]["<1"].get_int64(), 1);
+    BOOST_CHECK_EQUAL(hist.ToJSON()["buckets"]["inf"].get_int64(), 1);
+
+    hist.Clear();
+    BOOST_CHECK_EQUAL(hist.GetCount(), 0);
+    BOOST_CHECK_EQUAL(hist.GetMax(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
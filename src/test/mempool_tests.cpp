@@ -583,4 +583,75 @@ BOOST_AUTO_TEST_CASE(MempoolSizeLimitTest)
     SetMockTime(0);
 }
 
+BOOST_AUTO_TEST_CASE(MempoolAddressIndexTest)
+{
+    CTxMemPool pool(CFeeRate(0));
+    TestMemPoolEntryHelper entry;
+    CCoinsView coinsDummy;
+    CCoinsViewCache view(&coinsDummy);
+
+    uint160 hashA(std::vector<unsigned char>(20, 1));
+    uint160 hashB(std::vector<unsigned char>(20, 2));
+    CScript scriptA = CScript() << OP_DUP << OP_HASH160 << ToByteVector(hashA) << OP_EQUALVERIFY << OP_CHECKSIG;
+    CScript scriptB = CScript() << OP_HASH160 << ToByteVector(hashB) << OP_EQUAL;
+
+    // pays A twice and B once
+    CMutableTransaction txParent;
+    txParent.vin.resize(1);
+    txParent.vin[0].scriptSig = CScript() << OP_11;
+    txParent.vout.resize(3);
+    txParent.vout[0] = CTxOut(10000LL, scriptA);
+    txParent.vout[1] = CTxOut(20000LL, scriptA);
+    txParent.vout[2] = CTxOut(30000LL, scriptB);
+    // spends the first output to A and pays B
+    CMutableTransaction txChild;
+    txChild.vin.resize(1);
+    txChild.vin[0].prevout = COutPoint(txParent.GetHash(), 0);
+    txChild.vout.resize(1);
+    txChild.vout[0] = CTxOut(9000LL, scriptB);
+
+    CTxMemPoolEntry entryParent = entry.Time(1).FromTx(txParent);
+    pool.addUnchecked(txParent.GetHash(), entryParent);
+    pool.addAddressIndex(entryParent, view);
+    AddCoins(view, txParent, 1);
+    CTxMemPoolEntry entryChild = entry.Time(2).FromTx(txChild);
+    pool.addUnchecked(txChild.GetHash(), entryChild);
+    pool.addAddressIndex(entryChild, view);
+
+    std::vector<std::pair<uint160, int> > addressesA(1, std::make_pair(hashA, 1));
+    std::vector<std::pair<uint160, int> > addressesB(1, std::make_pair(hashB, 2));
+    std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > results;
+
+    pool.getAddressIndex(addressesA, results);
+    BOOST_CHECK_EQUAL(results.size(), 3);
+    BOOST_CHECK(results[2].first.txhash == txChild.GetHash());
+    BOOST_CHECK_EQUAL(results[2].first.spending, 1);
+    BOOST_CHECK_EQUAL(results[2].second.amount, -10000LL);
+    BOOST_CHECK(results[2].second.prevhash == txParent.GetHash());
+    BOOST_CHECK_EQUAL(results[2].second.time, 2);
+
+    // the type is part of the key
+    results.clear();
+    pool.getAddressIndex(addressesB, results);
+    BOOST_CHECK_EQUAL(results.size(), 2);
+    results.clear();
+    std::vector<std::pair<uint160, int> > addressesWrongType(1, std::make_pair(hashB, 1));
+    pool.getAddressIndex(addressesWrongType, results);
+    BOOST_CHECK_EQUAL(results.size(), 0);
+
+    pool.removeRecursive(txChild);
+    pool.getAddressIndex(addressesA, results);
+    BOOST_CHECK_EQUAL(results.size(), 2);
+    results.clear();
+    pool.getAddressIndex(addressesB, results);
+    BOOST_CHECK_EQUAL(results.size(), 1);
+    BOOST_CHECK_EQUAL(results[0].second.amount, 30000LL);
+
+    pool.removeRecursive(txParent);
+    results.clear();
+    pool.getAddressIndex(addressesA, results);
+    pool.getAddressIndex(addressesB, results);
+    BOOST_CHECK_EQUAL(results.size(), 0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
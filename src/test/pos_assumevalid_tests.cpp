@@ -0,0 +1,180 @@
+// Copyright (c) 2014-2018 The Polis Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "arith_uint256.h"
+#include "chainparams.h"
+#include "clientversion.h"
+#include "kernel.h"
+#include "random.h"
+#include "txdb.h"
+#include "validation.h"
+
+#include "test/test_polis.h"
+
+#include <limits>
+
+#include <boost/test/unit_test.hpp>
+
+// Blocks whose coinstake is staked by a block checked in the tests
+static const size_t STAKE_BLOCKS = 20;
+// Blocks after the staked coins, the stake modifiers are taken from up to a selection interval later
+static const size_t MODIFIER_BLOCKS = 100;
+static const CAmount STAKE_VALUE = 1000 * COIN;
+
+// A chain of blocks with staked coins on disk, in the UTXO set and in the transaction index, and blocks staking each
+// of them. The chain replaces the genesis chain of TestingSetup while the test runs.
+struct PosAssumeValidSetup : public TestingSetup
+{
+    std::vector<CBlockIndex> vIndex;
+    std::vector<CBlock> vStakeBlocks;
+    BlockMap mapBlockIndexOld;
+    CChain chainActiveOld;
+    bool fTxIndexOld;
+
+    PosAssumeValidSetup()
+    {
+        const Consensus::Params& consensusParams = Params().GetConsensus();
+        mapBlockIndexOld.swap(mapBlockIndex);
+        chainActiveOld.SetTip(chainActive.Tip());
+        chainActive.SetTip(NULL);
+        fTxIndexOld = fTxIndex;
+        fTxIndex = true;
+
+        uint160 keyID;
+        GetRandBytes(keyID.begin(), keyID.size());
+        const CScript scriptStake = CScript() << OP_DUP << OP_HASH160 << ToByteVector(keyID) << OP_EQUALVERIFY << OP_CHECKSIG;
+
+        // every block on disk has a coinbase and a coinstake, whose second output is staked later on,
+        // all of them after the stake protocol and minimum stake value changes
+        const unsigned int nTimeStart = consensusParams.nPosMitigationSwitchTime + 60;
+        const size_t nBlocks = STAKE_BLOCKS + MODIFIER_BLOCKS;
+        vIndex.resize(nBlocks);
+        std::vector<CBlock> vBlocks(STAKE_BLOCKS);
+        std::vector<std::pair<uint256, CDiskTxPos> > vPos;
+        unsigned int nOffset = 0;
+        for (size_t i = 0; i < nBlocks; i++) {
+            CBlockIndex& index = vIndex[i];
+            index.nHeight = i;
+            index.nTime = nTimeStart + 60 * i;
+            index.pprev = i ? &vIndex[i - 1] : NULL;
+            index.SetStakeModifier(GetRand(std::numeric_limits<uint64_t>::max()), true);
+            uint256 hash = GetRandHash();
+            if (i < STAKE_BLOCKS) {
+                CMutableTransaction txCoinBase;
+                txCoinBase.vin.resize(1);
+                txCoinBase.vin[0].prevout.SetNull();
+                txCoinBase.vin[0].scriptSig = CScript() << (int)i << OP_0;
+                txCoinBase.vout.resize(1);
+                txCoinBase.vout[0].SetEmpty();
+                CMutableTransaction txCoinStake;
+                txCoinStake.vin.resize(1);
+                txCoinStake.vin[0].prevout = COutPoint(GetRandHash(), 1);
+                txCoinStake.vout.resize(2);
+                txCoinStake.vout[0].SetEmpty();
+                txCoinStake.vout[1] = CTxOut(STAKE_VALUE, scriptStake);
+
+                CBlock& block = vBlocks[i];
+                block.nTime = index.nTime;
+                block.vtx.push_back(MakeTransactionRef(std::move(txCoinBase)));
+                block.vtx.push_back(MakeTransactionRef(std::move(txCoinStake)));
+                // a file of its own, away from the genesis block of TestingSetup
+                CDiskBlockPos pos(1, nOffset);
+                BOOST_REQUIRE(WriteBlockToDisk(block, pos, Params().MessageStart()));
+                nOffset = pos.nPos + ::GetSerializeSize(block, SER_DISK, CLIENT_VERSION);
+                index.nFile = pos.nFile;
+                index.nDataPos = pos.nPos;
+                index.nStatus |= BLOCK_HAVE_DATA;
+                hash = block.GetHash();
+                unsigned int nTxOffset = GetSizeOfCompactSize(block.vtx.size()) + ::GetSerializeSize(*block.vtx[0], SER_DISK, CLIENT_VERSION);
+                vPos.emplace_back(block.vtx[1]->GetHash(), CDiskTxPos(pos, nTxOffset));
+                pcoinsTip->AddCoin(COutPoint(block.vtx[1]->GetHash(), 1), Coin(block.vtx[1]->vout[1], i, false, true), false);
+            }
+            index.phashBlock = &mapBlockIndex.emplace(hash, &index).first->first;
+            index.BuildSkip();
+        }
+        chainActive.SetTip(&vIndex.back());
+        BOOST_REQUIRE(pblocktree->WriteTxIndex(vPos));
+
+        // one day after the last block, with a target the kernel of the coin's weight just meets
+        const unsigned int nTimeStake = vIndex.back().nTime + 60 * 60 * 24;
+        for (size_t i = 0; i < STAKE_BLOCKS; i++) {
+            CMutableTransaction txCoinBase;
+            txCoinBase.vin.resize(1);
+            txCoinBase.vin[0].prevout.SetNull();
+            txCoinBase.vout.resize(1);
+            txCoinBase.vout[0].SetEmpty();
+            CMutableTransaction txCoinStake;
+            txCoinStake.vin.resize(1);
+            txCoinStake.vin[0].prevout = COutPoint(vBlocks[i].vtx[1]->GetHash(), 1);
+            txCoinStake.vout.resize(2);
+            txCoinStake.vout[0].SetEmpty();
+            txCoinStake.vout[1] = CTxOut(STAKE_VALUE + COIN, scriptStake);
+
+            CBlock block;
+            block.vtx.push_back(MakeTransactionRef(std::move(txCoinBase)));
+            block.vtx.push_back(MakeTransactionRef(std::move(txCoinStake)));
+            uint256 hashProofOfStake;
+            for (block.nTime = nTimeStake + i; ; block.nTime++) {
+                int64_t nTimeWeight = std::min<int64_t>(block.nTime - vIndex[i].nTime, consensusParams.nStakeMaxAge - CurrentMinStakeAge(block.nTime));
+                arith_uint256 bnCoinDayWeight = STAKE_VALUE * nTimeWeight / COIN / 200;
+                arith_uint256 bnTargetPerCoinDay = ~arith_uint256();
+                bnTargetPerCoinDay /= bnCoinDayWeight;
+                block.nBits = bnTargetPerCoinDay.GetCompact();
+                if (CheckProofOfStake(block, hashProofOfStake))
+                    break;
+            }
+            vStakeBlocks.push_back(block);
+        }
+    }
+
+    ~PosAssumeValidSetup()
+    {
+        // the block index entries belong to vIndex, TestingSetup must only unload its own
+        fTxIndex = fTxIndexOld;
+        chainActive.SetTip(chainActiveOld.Tip());
+        mapBlockIndex.swap(mapBlockIndexOld);
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(pos_assumevalid_tests, PosAssumeValidSetup)
+
+// The kernel hash of assumed valid blocks feeds the stake modifier checksums, it has to be the same as after a full check
+BOOST_AUTO_TEST_CASE(assumevalid_kernel_hash)
+{
+    for (const CBlock& block : vStakeBlocks) {
+        uint256 hashFull, hashAssumeValid;
+        BOOST_CHECK(CheckProofOfStake(block, hashFull));
+        BOOST_CHECK(CheckProofOfStake(block, hashAssumeValid, true));
+        BOOST_CHECK(!hashFull.IsNull());
+        BOOST_CHECK(hashFull == hashAssumeValid);
+    }
+}
+
+// Once the staked coin is spent its block isn't known from the UTXO set anymore, then the kernel is checked in full
+BOOST_AUTO_TEST_CASE(assumevalid_spent_coin)
+{
+    std::vector<uint256> vHashFull;
+    for (const CBlock& block : vStakeBlocks) {
+        uint256 hashFull;
+        BOOST_CHECK(CheckProofOfStake(block, hashFull));
+        vHashFull.push_back(hashFull);
+    }
+    for (size_t i = 0; i < vStakeBlocks.size(); i += 2) {
+        BOOST_CHECK(pcoinsTip->SpendCoin(vStakeBlocks[i].vtx[1]->vin[0].prevout));
+    }
+
+    for (size_t i = 0; i < vStakeBlocks.size(); i++) {
+        uint256 hashAssumeValid;
+        BOOST_CHECK(CheckProofOfStake(vStakeBlocks[i], hashAssumeValid, true));
+        BOOST_CHECK(hashAssumeValid == vHashFull[i]);
+    }
+
+    // a block not meeting its target fails in the full check
+    CBlock block = vStakeBlocks[0];
+    block.nBits = arith_uint256(1).GetCompact();
+    uint256 hashAssumeValid;
+    BOOST_CHECK(!CheckProofOfStake(block, hashAssumeValid, true));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,100 @@
+// Copyright (c) 2014-2018 The Polis Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bls/bls.h"
+#include "key.h"
+#include "random.h"
+#include "sigverifyqueue.h"
+
+#include "test/test_polis.h"
+
+#include <atomic>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(sigverifyqueue_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(sigverifyqueue_not_running)
+{
+    CSigVerifyQueue queue;
+    bool fCalled = false;
+    BOOST_CHECK(!queue.IsRunning());
+    BOOST_CHECK(!queue.AsyncVerify([&fCalled]() { fCalled = true; return true; }, [&fCalled](bool) { fCalled = true; }));
+    BOOST_CHECK(!fCalled);
+
+    queue.Start(2);
+    BOOST_CHECK(queue.IsRunning());
+    queue.Stop();
+    BOOST_CHECK(!queue.IsRunning());
+    BOOST_CHECK(!queue.AsyncVerify([&fCalled]() { fCalled = true; return true; }, [&fCalled](bool) { fCalled = true; }));
+    BOOST_CHECK(!fCalled);
+}
+
+BOOST_AUTO_TEST_CASE(sigverifyqueue_ecdsa)
+{
+    const int nJobs = 500;
+
+    CKey key, keyOther;
+    key.MakeNewKey(true);
+    keyOther.MakeNewKey(true);
+    CPubKey pubKey = key.GetPubKey();
+
+    std::atomic<int> nValid(0);
+    std::atomic<int> nInvalid(0);
+    std::atomic<int> nMismatch(0);
+
+    CSigVerifyQueue queue;
+    queue.Start(4);
+    for (int i = 0; i < nJobs; i++) {
+        uint256 hash = GetRandHash();
+        bool fExpected = (i % 3) != 0;
+        std::vector<unsigned char> vchSig;
+        BOOST_CHECK((fExpected ? key : keyOther).Sign(hash, vchSig));
+        bool fQueued = queue.AsyncVerify(
+            [pubKey, hash, vchSig]() { return pubKey.Verify(hash, vchSig); },
+            [&, fExpected](bool fValid) {
+                (fValid ? nValid : nInvalid)++;
+                if (fValid != fExpected) nMismatch++;
+            });
+        BOOST_CHECK(fQueued);
+    }
+    // waits for all callbacks
+    queue.Stop();
+
+    BOOST_CHECK_EQUAL(nValid + nInvalid, nJobs);
+    BOOST_CHECK_EQUAL(nInvalid, (nJobs + 2) / 3);
+    BOOST_CHECK_EQUAL(nMismatch, 0);
+}
+
+BOOST_AUTO_TEST_CASE(sigverifyqueue_bls)
+{
+    const int nJobs = 50;
+
+    CBLSSecretKey sk, skOther;
+    sk.MakeNewKey();
+    skOther.MakeNewKey();
+    CBLSPublicKey pubKey = sk.GetPublicKey();
+
+    std::atomic<int> nValid(0);
+    std::atomic<int> nMismatch(0);
+
+    CSigVerifyQueue queue;
+    queue.Start(2);
+    for (int i = 0; i < nJobs; i++) {
+        uint256 hash = GetRandHash();
+        bool fExpected = (i % 5) != 0;
+        CBLSSignature sig = (fExpected ? sk : skOther).Sign(hash);
+        bool fQueued = queue.AsyncVerifyBLS(sig, pubKey, hash, [&, fExpected](bool fValid) {
+            if (fValid) nValid++;
+            if (fValid != fExpected) nMismatch++;
+        });
+        BOOST_CHECK(fQueued);
+    }
+    queue.Stop();
+
+    BOOST_CHECK_EQUAL(nValid, nJobs - nJobs / 5);
+    BOOST_CHECK_EQUAL(nMismatch, 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
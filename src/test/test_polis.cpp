@@ -79,7 +79,8 @@ TestingSetup::TestingSetup(const std::string& chainName) : BasicTestingSetup(cha
         pblocktree = new CBlockTreeDB(1 << 20, true);
         pcoinsdbview = new CCoinsViewDB(1 << 23, true);
         llmq::InitLLMQSystem(*evoDb);
-        pcoinsTip = new CCoinsViewCache(pcoinsdbview);
+        pcoinsflushview = new CCoinsViewBackgroundFlush(pcoinsdbview, pcoinsdbview, []() { return evoDb->WriteCommitted(); });
+        pcoinsTip = new CCoinsViewCache(pcoinsflushview);
         InitBlockIndex(chainparams);
         {
             CValidationState state;
@@ -89,6 +90,7 @@ TestingSetup::TestingSetup(const std::string& chainName) : BasicTestingSetup(cha
         nScriptCheckThreads = 3;
         for (int i=0; i < nScriptCheckThreads-1; i++)
             threadGroup.create_thread(&ThreadScriptCheck);
+        StartCoinsPrefetchThreads();
         g_connman = std::unique_ptr<CConnman>(new CConnman(0x1337, 0x1337)); // Deterministic randomness for tests.
         connman = g_connman.get();
         RegisterNodeSignals(GetNodeSignals());
@@ -99,8 +101,10 @@ TestingSetup::~TestingSetup()
         UnregisterNodeSignals(GetNodeSignals());
         threadGroup.interrupt_all();
         threadGroup.join_all();
+        StopCoinsPrefetchThreads();
         UnloadBlockIndex();
         delete pcoinsTip;
+        delete pcoinsflushview;
         llmq::DestroyLLMQSystem();
         delete pcoinsdbview;
         delete pblocktree;
@@ -6,6 +6,7 @@
 #include "txdb.h"
 
 #include "chainparams.h"
+#include "ctpl.h"
 #include "hash.h"
 #include "pow.h"
 #include "uint256.h"
@@ -75,10 +76,16 @@ uint256 CCoinsViewDB::GetBestBlock() const {
 }
 
 bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
+    bool ret = WriteCoins(mapCoins, hashBlock);
+    mapCoins.clear();
+    return ret;
+}
+
+bool CCoinsViewDB::WriteCoins(const CCoinsMap &mapCoins, const uint256 &hashBlock) {
     CDBBatch batch(db);
     size_t count = 0;
     size_t changed = 0;
-    for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
+    for (CCoinsMap::const_iterator it = mapCoins.begin(); it != mapCoins.end(); it++) {
         if (it->second.flags & CCoinsCacheEntry::DIRTY) {
             CoinEntry entry(&it->first);
             if (it->second.coin.IsSpent())
@@ -88,8 +95,6 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
             changed++;
         }
         count++;
-        CCoinsMap::iterator itOld = it++;
-        mapCoins.erase(itOld);
     }
     if (!hashBlock.IsNull())
         batch.Write(DB_BEST_BLOCK, hashBlock);
@@ -104,6 +109,99 @@ size_t CCoinsViewDB::EstimateSize() const
     return db.EstimateSize(DB_COIN, (char)(DB_COIN+1));
 }
 
+CCoinsViewBackgroundFlush::CCoinsViewBackgroundFlush(CCoinsView *viewIn, CCoinsViewDB *pdbIn, std::function<bool()> fnAfterWriteIn) :
+    CCoinsViewBacked(viewIn), pdb(pdbIn), fnAfterWrite(fnAfterWriteIn), pool(new ctpl::thread_pool(1)), fFlushFailed(false)
+{
+    RenameThreadPool(*pool, "coinsflush");
+}
+
+CCoinsViewBackgroundFlush::~CCoinsViewBackgroundFlush()
+{
+    WaitForFlush();
+}
+
+bool CCoinsViewBackgroundFlush::GetCoin(const COutPoint &outpoint, Coin &coin) const
+{
+    {
+        LOCK(cs);
+        if (pmapFlushing) {
+            CCoinsMap::const_iterator it = pmapFlushing->find(outpoint);
+            if (it != pmapFlushing->end() && (it->second.flags & CCoinsCacheEntry::DIRTY)) {
+                coin = it->second.coin;
+                return !coin.IsSpent();
+            }
+        }
+    }
+    return base->GetCoin(outpoint, coin);
+}
+
+bool CCoinsViewBackgroundFlush::HaveCoin(const COutPoint &outpoint) const
+{
+    Coin coin;
+    return GetCoin(outpoint, coin);
+}
+
+uint256 CCoinsViewBackgroundFlush::GetBestBlock() const
+{
+    {
+        LOCK(cs);
+        if (pmapFlushing && !hashFlushing.IsNull())
+            return hashFlushing;
+    }
+    return base->GetBestBlock();
+}
+
+bool CCoinsViewBackgroundFlush::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock)
+{
+    if (!WaitForFlush())
+        return false;
+
+    std::shared_ptr<CCoinsMap> pmap = std::make_shared<CCoinsMap>();
+    pmap->swap(mapCoins);
+    {
+        LOCK(cs);
+        pmapFlushing = pmap;
+        hashFlushing = hashBlock;
+    }
+
+    futureFlush = pool->push([this, pmap, hashBlock](int threadId) {
+        int64_t nTimeStart = GetTimeMicros();
+        bool fOk = false;
+        try {
+            fOk = pdb->WriteCoins(*pmap, hashBlock) && (!fnAfterWrite || fnAfterWrite());
+        } catch (const std::runtime_error& e) {
+            LogPrintf("CCoinsViewBackgroundFlush: error writing to database: %s\n", e.what());
+        }
+        // the coins stay in memory if they could not be written, reading them from disk would be wrong
+        if (fOk) {
+            LOCK(cs);
+            pmapFlushing.reset();
+            hashFlushing.SetNull();
+        }
+        LogPrint("coindb", "Background flush of %u coins took %.2fms\n", (unsigned int)pmap->size(), 0.001 * (GetTimeMicros() - nTimeStart));
+        return fOk;
+    });
+    return true;
+}
+
+bool CCoinsViewBackgroundFlush::WaitForFlush()
+{
+    // a failed flush left a gap on disk, nothing written after it would be consistent
+    if (fFlushFailed)
+        return false;
+    if (!futureFlush.valid())
+        return true;
+    if (!futureFlush.get())
+        fFlushFailed = true;
+    return !fFlushFailed;
+}
+
+bool CCoinsViewBackgroundFlush::IsFlushing() const
+{
+    LOCK(cs);
+    return pmapFlushing != nullptr;
+}
+
 CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe) {
 }
 
@@ -10,8 +10,12 @@
 #include "dbwrapper.h"
 #include "chain.h"
 #include "spentindex.h"
+#include "sync.h"
 
+#include <functional>
+#include <future>
 #include <map>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -22,6 +26,10 @@ class CBlockIndex;
 class CCoinsViewDBCursor;
 class uint256;
 
+namespace ctpl {
+    class thread_pool;
+}
+
 //! Compensate for extra memory peak (x1.5-x1.9) at flush time.
 static constexpr int DB_PEAK_USAGE_FACTOR = 2;
 //! No need to periodic flush if at least this much space still available.
@@ -81,11 +89,54 @@ public:
     bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
     CCoinsViewCursor *Cursor() const override;
 
+    //! Write the dirty coins and the best block in one batch, without modifying mapCoins
+    bool WriteCoins(const CCoinsMap &mapCoins, const uint256 &hashBlock);
+
     //! Attempt to update from an older database format. Returns whether an error occurred.
     bool Upgrade();
     size_t EstimateSize() const override;
 };
 
+/**
+ * CCoinsView which writes flushed coins to the coin database on a background thread, so that
+ * validation can continue on an empty cache instead of waiting for the write. Until they are
+ * written, the flushed coins are served from memory. Only one flush is written at a time and each
+ * one is a single batch together with its best block, so the database on disk always matches a
+ * best block marker.
+ */
+class CCoinsViewBackgroundFlush : public CCoinsViewBacked
+{
+private:
+    CCoinsViewDB *pdb;
+    //! Runs on the flush thread after the coins of a flush are written, for state which must follow them on disk
+    std::function<bool()> fnAfterWrite;
+    std::unique_ptr<ctpl::thread_pool> pool;
+
+    mutable CCriticalSection cs;
+    //! The coins being written and the best block they leave on disk, null when nothing is pending
+    std::shared_ptr<const CCoinsMap> pmapFlushing;
+    uint256 hashFlushing;
+
+    std::future<bool> futureFlush;
+    //! A flush failed, no further ones are started after that
+    bool fFlushFailed;
+
+public:
+    CCoinsViewBackgroundFlush(CCoinsView *viewIn, CCoinsViewDB *pdbIn, std::function<bool()> fnAfterWriteIn = nullptr);
+    ~CCoinsViewBackgroundFlush();
+
+    bool GetCoin(const COutPoint &outpoint, Coin &coin) const override;
+    bool HaveCoin(const COutPoint &outpoint) const override;
+    uint256 GetBestBlock() const override;
+    //! Waits for the previous flush to be written and starts writing mapCoins, which is left empty.
+    //! Fails without touching mapCoins once any flush failed.
+    bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
+
+    //! Waits until the pending flush is written, returns false if writing it or any earlier flush failed
+    bool WaitForFlush();
+    bool IsFlushing() const;
+};
+
 /** Specialization of CCoinsViewCursor to iterate over a CCoinsViewDB */
 class CCoinsViewDBCursor: public CCoinsViewCursor
 {
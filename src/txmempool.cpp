@@ -491,61 +491,86 @@ bool CTxMemPool::addUnchecked(const uint256& hash, const CTxMemPoolEntry &entry,
     return true;
 }
 
+// Type and hash of the address a script pays to, false if the address index doesn't cover it
+static bool GetMempoolAddress(const CScript& scriptPubKey, int& typeRet, uint160& hashBytesRet)
+{
+    if (scriptPubKey.IsPayToScriptHash()) {
+        typeRet = 2;
+        hashBytesRet = uint160(std::vector<unsigned char>(scriptPubKey.begin()+2, scriptPubKey.begin()+22));
+    } else if (scriptPubKey.IsPayToPublicKeyHash()) {
+        typeRet = 1;
+        hashBytesRet = uint160(std::vector<unsigned char>(scriptPubKey.begin()+3, scriptPubKey.begin()+23));
+    } else if (scriptPubKey.IsPayToPublicKey()) {
+        typeRet = 1;
+        hashBytesRet = Hash160(scriptPubKey.begin()+1, scriptPubKey.end()-1);
+    } else {
+        return false;
+    }
+    return true;
+}
+
 void CTxMemPool::addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewCache &view)
 {
     LOCK(cs);
     const CTransaction& tx = entry.GetTx();
-    std::vector<CMempoolAddressDeltaKey> inserted;
-
     uint256 txhash = tx.GetHash();
+
+    std::pair<addressDeltaMapInserted::iterator, bool> ret = mapAddressInserted.emplace(txhash, CMempoolAddressDeltaTx());
+    if (!ret.second) {
+        return;
+    }
+    CMempoolAddressDeltaTx& deltaTx = ret.first->second;
+    deltaTx.txhash = txhash;
+    deltaTx.time = entry.GetTime();
+
+    // all entries are created before any is linked, vecEntries must not reallocate afterwards
+    std::vector<CMempoolAddressKey> vecKeys;
+    vecKeys.reserve(tx.vin.size() + tx.vout.size());
+    deltaTx.vecEntries.reserve(tx.vin.size() + tx.vout.size());
+    int type;
+    uint160 hashBytes;
+
     for (unsigned int j = 0; j < tx.vin.size(); j++) {
-        const CTxIn input = tx.vin[j];
-        const Coin& coin = view.AccessCoin(input.prevout);
-        const CTxOut &prevout = coin.out;
-        if (prevout.scriptPubKey.IsPayToScriptHash()) {
-            std::vector<unsigned char> hashBytes(prevout.scriptPubKey.begin()+2, prevout.scriptPubKey.begin()+22);
-            CMempoolAddressDeltaKey key(2, uint160(hashBytes), txhash, j, 1);
-            CMempoolAddressDelta delta(entry.GetTime(), prevout.nValue * -1, input.prevout.hash, input.prevout.n);
-            mapAddress.insert(std::make_pair(key, delta));
-            inserted.push_back(key);
-        } else if (prevout.scriptPubKey.IsPayToPublicKeyHash()) {
-            std::vector<unsigned char> hashBytes(prevout.scriptPubKey.begin()+3, prevout.scriptPubKey.begin()+23);
-            CMempoolAddressDeltaKey key(1, uint160(hashBytes), txhash, j, 1);
-            CMempoolAddressDelta delta(entry.GetTime(), prevout.nValue * -1, input.prevout.hash, input.prevout.n);
-            mapAddress.insert(std::make_pair(key, delta));
-            inserted.push_back(key);
-        } else if (prevout.scriptPubKey.IsPayToPublicKey()) {
-            uint160 hashBytes(Hash160(prevout.scriptPubKey.begin()+1, prevout.scriptPubKey.end()-1));
-            CMempoolAddressDeltaKey key(1, hashBytes, txhash, j, 1);
-            CMempoolAddressDelta delta(entry.GetTime(), prevout.nValue * -1, input.prevout.hash, input.prevout.n);
-            mapAddress.insert(std::make_pair(key, delta));
-            inserted.push_back(key);
-        }
+        const CTxIn& input = tx.vin[j];
+        const CTxOut& prevout = view.AccessCoin(input.prevout).out;
+        if (!GetMempoolAddress(prevout.scriptPubKey, type, hashBytes)) continue;
+        vecKeys.emplace_back(type, hashBytes);
+        CMempoolAddressDeltaEntry delta;
+        delta.ptx = &deltaTx;
+        delta.index = j;
+        delta.fSpending = true;
+        delta.amount = prevout.nValue * -1;
+        delta.prevout = input.prevout;
+        deltaTx.vecEntries.push_back(delta);
     }
 
     for (unsigned int k = 0; k < tx.vout.size(); k++) {
-        const CTxOut &out = tx.vout[k];
-        if (out.scriptPubKey.IsPayToScriptHash()) {
-            std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+2, out.scriptPubKey.begin()+22);
-            CMempoolAddressDeltaKey key(2, uint160(hashBytes), txhash, k, 0);
-            mapAddress.insert(std::make_pair(key, CMempoolAddressDelta(entry.GetTime(), out.nValue)));
-            inserted.push_back(key);
-        } else if (out.scriptPubKey.IsPayToPublicKeyHash()) {
-            std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+3, out.scriptPubKey.begin()+23);
-            std::pair<addressDeltaMap::iterator,bool> ret;
-            CMempoolAddressDeltaKey key(1, uint160(hashBytes), txhash, k, 0);
-            mapAddress.insert(std::make_pair(key, CMempoolAddressDelta(entry.GetTime(), out.nValue)));
-            inserted.push_back(key);
-        } else if (out.scriptPubKey.IsPayToPublicKey()) {
-            uint160 hashBytes(Hash160(out.scriptPubKey.begin()+1, out.scriptPubKey.end()-1));
-            std::pair<addressDeltaMap::iterator,bool> ret;
-            CMempoolAddressDeltaKey key(1, hashBytes, txhash, k, 0);
-            mapAddress.insert(std::make_pair(key, CMempoolAddressDelta(entry.GetTime(), out.nValue)));
-            inserted.push_back(key);
-        }
-    }
-
-    mapAddressInserted.insert(std::make_pair(txhash, inserted));
+        const CTxOut& out = tx.vout[k];
+        if (!GetMempoolAddress(out.scriptPubKey, type, hashBytes)) continue;
+        vecKeys.emplace_back(type, hashBytes);
+        CMempoolAddressDeltaEntry delta;
+        delta.ptx = &deltaTx;
+        delta.index = k;
+        delta.fSpending = false;
+        delta.amount = out.nValue;
+        deltaTx.vecEntries.push_back(delta);
+    }
+
+    // append to the buckets, which keeps them in the order transactions entered the mempool
+    for (size_t i = 0; i < vecKeys.size(); i++) {
+        CMempoolAddressDeltaEntry& delta = deltaTx.vecEntries[i];
+        std::pair<const CMempoolAddressKey, CMempoolAddressBucket>& bucketPair = *mapAddress.emplace(vecKeys[i], CMempoolAddressBucket()).first;
+        CMempoolAddressBucket& bucket = bucketPair.second;
+        delta.pbucket = &bucketPair;
+        delta.pprev = bucket.plast;
+        delta.pnext = nullptr;
+        if (bucket.plast) {
+            bucket.plast->pnext = &delta;
+        } else {
+            bucket.pfirst = &delta;
+        }
+        bucket.plast = &delta;
+    }
 }
 
 bool CTxMemPool::getAddressIndex(std::vector<std::pair<uint160, int> > &addresses,
@@ -553,10 +578,15 @@ bool CTxMemPool::getAddressIndex(std::vector<std::pair<uint160, int> > &addresse
 {
     LOCK(cs);
     for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        addressDeltaMap::iterator ait = mapAddress.lower_bound(CMempoolAddressDeltaKey((*it).second, (*it).first));
-        while (ait != mapAddress.end() && (*ait).first.addressBytes == (*it).first && (*ait).first.type == (*it).second) {
-            results.push_back(*ait);
-            ait++;
+        addressBucketMap::const_iterator bit = mapAddress.find(CMempoolAddressKey((*it).second, (*it).first));
+        if (bit == mapAddress.end()) continue;
+        for (const CMempoolAddressDeltaEntry* pdelta = bit->second.pfirst; pdelta; pdelta = pdelta->pnext) {
+            CMempoolAddressDeltaKey key((*it).second, (*it).first, pdelta->ptx->txhash, pdelta->index, pdelta->fSpending ? 1 : 0);
+            if (pdelta->fSpending) {
+                results.push_back(std::make_pair(key, CMempoolAddressDelta(pdelta->ptx->time, pdelta->amount, pdelta->prevout.hash, pdelta->prevout.n)));
+            } else {
+                results.push_back(std::make_pair(key, CMempoolAddressDelta(pdelta->ptx->time, pdelta->amount)));
+            }
         }
     }
     return true;
@@ -568,10 +598,25 @@ bool CTxMemPool::removeAddressIndex(const uint256 txhash)
     addressDeltaMapInserted::iterator it = mapAddressInserted.find(txhash);
 
     if (it != mapAddressInserted.end()) {
-        std::vector<CMempoolAddressDeltaKey> keys = (*it).second;
-        for (std::vector<CMempoolAddressDeltaKey>::iterator mit = keys.begin(); mit != keys.end(); mit++) {
-            mapAddress.erase(*mit);
+        for (CMempoolAddressDeltaEntry& delta : it->second.vecEntries) {
+            CMempoolAddressBucket& bucket = delta.pbucket->second;
+            if (delta.pprev) {
+                delta.pprev->pnext = delta.pnext;
+            } else {
+                bucket.pfirst = delta.pnext;
+            }
+            if (delta.pnext) {
+                delta.pnext->pprev = delta.pprev;
+            } else {
+                bucket.plast = delta.pprev;
+            }
+            if (!bucket.pfirst) {
+                // copy the key, it's destroyed together with the bucket
+                CMempoolAddressKey key = delta.pbucket->first;
+                mapAddress.erase(key);
+            }
         }
+        // frees all entries of the transaction at once
         mapAddressInserted.erase(it);
     }
 
@@ -1647,3 +1692,7 @@ bool CTxMemPool::TransactionWithinChainLimit(const uint256& txid, size_t chainLi
 }
 
 SaltedTxidHasher::SaltedTxidHasher() : k0(GetRand(std::numeric_limits<uint64_t>::max())), k1(GetRand(std::numeric_limits<uint64_t>::max())) {}
+
+SaltedSpentIndexKeyHasher::SaltedSpentIndexKeyHasher() : k0(GetRand(std::numeric_limits<uint64_t>::max())), k1(GetRand(std::numeric_limits<uint64_t>::max())) {}
+
+SaltedAddressHasher::SaltedAddressHasher() : k0(GetRand(std::numeric_limits<uint64_t>::max())), k1(GetRand(std::numeric_limits<uint64_t>::max())) {}
@@ -9,6 +9,7 @@
 #include <memory>
 #include <set>
 #include <map>
+#include <unordered_map>
 #include <vector>
 #include <utility>
 #include <string>
@@ -359,7 +360,7 @@ class SaltedTxidHasher
 {
 private:
     /** Salt */
-    const uint64_t k0, k1;
+    uint64_t k0, k1;
 
 public:
     SaltedTxidHasher();
@@ -369,6 +370,86 @@ public:
     }
 };
 
+class SaltedSpentIndexKeyHasher
+{
+private:
+    /** Salt */
+    uint64_t k0, k1;
+
+public:
+    SaltedSpentIndexKeyHasher();
+
+    size_t operator()(const CSpentIndexKey& key) const {
+        return SipHashUint256Extra(k0, k1, key.txid, key.outputIndex);
+    }
+};
+
+/** Type and hash of an address, the key of its bucket in the mempool address index */
+struct CMempoolAddressKey
+{
+    int type;
+    uint160 addressBytes;
+
+    CMempoolAddressKey(int addressType, const uint160& addressHash) : type(addressType), addressBytes(addressHash) {}
+
+    bool operator==(const CMempoolAddressKey& other) const
+    {
+        return type == other.type && addressBytes == other.addressBytes;
+    }
+};
+
+class SaltedAddressHasher
+{
+private:
+    /** Salt */
+    uint64_t k0, k1;
+
+public:
+    SaltedAddressHasher();
+
+    size_t operator()(const CMempoolAddressKey& key) const {
+        return CSipHasher(k0, k1).Write(key.type).Write(key.addressBytes.begin(), key.addressBytes.size()).Finalize();
+    }
+};
+
+struct CMempoolAddressBucket;
+struct CMempoolAddressDeltaTx;
+
+/**
+ * An input or output of a mempool transaction in the bucket of its address. The transaction's
+ * hash and time are shared by all of its entries, the address is the bucket's.
+ */
+struct CMempoolAddressDeltaEntry
+{
+    //! neighbours in the bucket, in the order the entries were added
+    CMempoolAddressDeltaEntry* pprev;
+    CMempoolAddressDeltaEntry* pnext;
+    std::pair<const CMempoolAddressKey, CMempoolAddressBucket>* pbucket;
+    const CMempoolAddressDeltaTx* ptx;
+    uint32_t index;
+    bool fSpending;
+    CAmount amount;
+    //! spent outpoint of inputs, null for outputs
+    COutPoint prevout;
+};
+
+/** The entries of one address, a list through the entries so that removing one doesn't need to search the bucket */
+struct CMempoolAddressBucket
+{
+    CMempoolAddressDeltaEntry* pfirst;
+    CMempoolAddressDeltaEntry* plast;
+
+    CMempoolAddressBucket() : pfirst(nullptr), plast(nullptr) {}
+};
+
+/** The address index entries of one transaction, allocated at once when it's added and freed at once when it's removed */
+struct CMempoolAddressDeltaTx
+{
+    uint256 txhash;
+    int64_t time;
+    std::vector<CMempoolAddressDeltaEntry> vecEntries;
+};
+
 /**
  * CTxMemPool stores valid-according-to-the-current-best-chain transactions
  * that may be included in the next block.
@@ -526,16 +607,17 @@ private:
     typedef std::map<txiter, TxLinks, CompareIteratorByHash> txlinksMap;
     txlinksMap mapLinks;
 
-    typedef std::map<CMempoolAddressDeltaKey, CMempoolAddressDelta, CMempoolAddressDeltaKeyCompare> addressDeltaMap;
-    addressDeltaMap mapAddress;
+    // Node based, so entries may keep pointers to buckets and to the entries of other transactions
+    typedef std::unordered_map<CMempoolAddressKey, CMempoolAddressBucket, SaltedAddressHasher> addressBucketMap;
+    addressBucketMap mapAddress;
 
-    typedef std::map<uint256, std::vector<CMempoolAddressDeltaKey> > addressDeltaMapInserted;
+    typedef std::unordered_map<uint256, CMempoolAddressDeltaTx, SaltedTxidHasher> addressDeltaMapInserted;
     addressDeltaMapInserted mapAddressInserted;
 
-    typedef std::map<CSpentIndexKey, CSpentIndexValue, CSpentIndexKeyCompare> mapSpentIndex;
+    typedef std::unordered_map<CSpentIndexKey, CSpentIndexValue, SaltedSpentIndexKeyHasher> mapSpentIndex;
     mapSpentIndex mapSpent;
 
-    typedef std::map<uint256, std::vector<CSpentIndexKey> > mapSpentIndexInserted;
+    typedef std::unordered_map<uint256, std::vector<CSpentIndexKey>, SaltedTxidHasher> mapSpentIndexInserted;
     mapSpentIndexInserted mapSpentInserted;
 
     std::multimap<uint256, uint256> mapProTxRefs; // proTxHash -> transaction (all TXs that refer to an existing proTx)
@@ -287,6 +287,8 @@ bool LogAcceptCategory(const char* category)
                     ptrCategory->insert(std::string("keepass"));
                     ptrCategory->insert(std::string("mnpayments"));
                     ptrCategory->insert(std::string("gobject"));
+                    ptrCategory->insert(std::string("staking"));
+                    ptrCategory->insert(std::string("sigverify"));
                 }
             } else {
                 ptrCategory.reset(new std::set<std::string>());
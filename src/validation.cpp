@@ -13,6 +13,7 @@
 #include "chainparams.h"
 #include "checkpoints.h"
 #include "checkqueue.h"
+#include "ctpl.h"
 #include "consensus/consensus.h"
 #include "consensus/merkle.h"
 #include "consensus/validation.h"
@@ -249,6 +250,7 @@ static int64_t GetMaxFutureBlockTime(const CBlockIndex *pindexPrev, const Consen
 }
 
 CCoinsViewDB *pcoinsdbview = NULL;
+CCoinsViewBackgroundFlush *pcoinsflushview = NULL;
 CCoinsViewCache *pcoinsTip = NULL;
 CBlockTreeDB *pblocktree = NULL;
 
@@ -2125,6 +2127,38 @@ static void AcceptProofOfStakeBlock(const CBlock &block, CBlockIndex *pindexNew)
 
 }
 
+/** Whether the block is buried deep enough below the assumed valid block to skip its script and stake
+ *  kernel checks. */
+static bool IsAssumedValid(const CBlockIndex* pindex, const Consensus::Params& consensusParams)
+{
+    AssertLockHeld(cs_main);
+
+    if (hashAssumeValid.IsNull() || pindexBestHeader == NULL)
+        return false;
+    // We've been configured with the hash of a block which has been externally verified to have a valid history.
+    // A suitable default value is included with the software and updated from time to time.  Because validity
+    //  relative to a piece of software is an objective fact these defaults can be easily reviewed.
+    // This setting doesn't force the selection of any particular chain but makes validating some faster by
+    //  effectively caching the result of part of the verification.
+    BlockMap::const_iterator  it = mapBlockIndex.find(hashAssumeValid);
+    if (it == mapBlockIndex.end())
+        return false;
+    if (it->second->GetAncestor(pindex->nHeight) != pindex ||
+        pindexBestHeader->GetAncestor(pindex->nHeight) != pindex ||
+        pindexBestHeader->nChainWork < UintToArith256(consensusParams.nMinimumChainWork))
+        return false;
+    // This block is a member of the assumed verified chain and an ancestor of the best header.
+    // The equivalent time check discourages hashpower from extorting the network via DOS attack
+    //  into accepting an invalid block through telling users they must manually set assumevalid.
+    //  Requiring a software change or burying the invalid block, regardless of the setting, makes
+    //  it hard to hide the implication of the demand.  This also avoids having release candidates
+    //  that are hardly doing any signature verification at all in testing without having to
+    //  artificially set the default assumed verified block further back.
+    // The test against nMinimumChainWork prevents the skipping when denied access to any chain at
+    //  least as good as the expected chain.
+    return GetBlockProofEquivalentTime(*pindexBestHeader, *pindex, *pindexBestHeader, consensusParams) > 60 * 60 * 24 * 7 * 2;
+}
+
 /** Apply the effects of this block (with given index) on the UTXO set represented by coins.
  *  Validity checks that depend on the UTXO set are also done; ConnectBlock()
  *  can fail if those validity checks fail (among other reasons). */
@@ -2165,31 +2199,7 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
                          REJECT_INVALID, "PoW-ended");
     }
 
-    bool fScriptChecks = true;
-    if (!hashAssumeValid.IsNull()) {
-        // We've been configured with the hash of a block which has been externally verified to have a valid history.
-        // A suitable default value is included with the software and updated from time to time.  Because validity
-        //  relative to a piece of software is an objective fact these defaults can be easily reviewed.
-        // This setting doesn't force the selection of any particular chain but makes validating some faster by
-        //  effectively caching the result of part of the verification.
-        BlockMap::const_iterator  it = mapBlockIndex.find(hashAssumeValid);
-        if (it != mapBlockIndex.end()) {
-            if (it->second->GetAncestor(pindex->nHeight) == pindex &&
-                pindexBestHeader->GetAncestor(pindex->nHeight) == pindex &&
-                pindexBestHeader->nChainWork >= UintToArith256(chainparams.GetConsensus().nMinimumChainWork)) {
-                // This block is a member of the assumed verified chain and an ancestor of the best header.
-                // The equivalent time check discourages hashpower from extorting the network via DOS attack
-                //  into accepting an invalid block through telling users they must manually set assumevalid.
-                //  Requiring a software change or burying the invalid block, regardless of the setting, makes
-                //  it hard to hide the implication of the demand.  This also avoids having release candidates
-                //  that are hardly doing any signature verification at all in testing without having to
-                //  artificially set the default assumed verified block further back.
-                // The test against nMinimumChainWork prevents the skipping when denied access to any chain at
-                //  least as good as the expected chain.
-                fScriptChecks = (GetBlockProofEquivalentTime(*pindexBestHeader, *pindex, *pindexBestHeader, chainparams.GetConsensus()) <= 60 * 60 * 24 * 7 * 2);
-            }
-        }
-    }
+    bool fScriptChecks = !IsAssumedValid(pindex, chainparams.GetConsensus());
 
     int64_t nTime1 = GetTimeMicros(); nTimeCheck += nTime1 - nTimeStart;
     LogPrint("bench", "    - Sanity checks: %.2fms [%.2fs]\n", 0.001 * (nTime1 - nTimeStart), nTimeCheck * 0.000001);
@@ -2572,6 +2582,8 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
  * if they're too large, if it's been a while since the last write,
  * or always and in all cases if we're in prune mode and are deleting files.
  */
+static int64_t nTimeFlushStall = 0;
+
 bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode, int nManualPruneHeight) {
     int64_t nMempoolUsage = mempool.DynamicMemoryUsage();
     const CChainParams& chainparams = Params();
@@ -2660,12 +2672,26 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode, int n
         // overwrite one. Still, use a conservative safety factor of 2.
         if (!CheckDiskSpace(48 * 2 * 2 * pcoinsTip->GetCacheSize()))
             return state.Error("out of disk space");
-        // Flush the chainstate (which may refer to block index entries).
+        // Only one flush is written at a time, validation stalls here if the previous one is not done yet.
+        int64_t nTimeStallStart = GetTimeMicros();
+        if (!pcoinsflushview->WaitForFlush())
+            return AbortNode(state, "Failed to write to coin database");
+        int64_t nTimeStall = GetTimeMicros() - nTimeStallStart;
+        nTimeFlushStall += nTimeStall;
+        // The EvoDB changes are written by the flush thread right after the coins, so that both
+        // databases on disk always agree on the best block.
+        evoDb->PrepareCommit();
+        // Flush the chainstate (which may refer to block index entries). The coins are written in the
+        // background, while the next blocks are connected on an empty cache.
         if (!pcoinsTip->Flush())
             return AbortNode(state, "Failed to write to coin database");
-        if (!evoDb->CommitRootTransaction()) {
-            return AbortNode(state, "Failed to commit EvoDB");
+        // Forced flushes are done before shutdown or before reading the database directly, and pruning
+        // must not get further ahead of the coins on disk than it used to
+        if (mode == FLUSH_STATE_ALWAYS || fFlushForPrune) {
+            if (!pcoinsflushview->WaitForFlush())
+                return AbortNode(state, "Failed to write to coin database");
         }
+        LogPrint("bench", "  - Flush state: stall %.2fms, total %.2fms [stall %.2fs]\n", nTimeStall * 0.001, (GetTimeMicros() - nTimeStallStart) * 0.001, nTimeFlushStall * 0.000001);
         nLastFlush = nNow;
     }
     if (fDoFullFlush || ((mode == FLUSH_STATE_ALWAYS || mode == FLUSH_STATE_PERIODIC) && nNow > nLastSetChain + (int64_t)DATABASE_WRITE_INTERVAL * 1000000)) {
@@ -2810,6 +2836,53 @@ static int64_t nTimeConnectTotal = 0;
 static int64_t nTimeFlush = 0;
 static int64_t nTimeChainState = 0;
 static int64_t nTimePostConnect = 0;
+static int64_t nTimePrefetchCoins = 0;
+
+/** Threads reading the coins spent by a block before ConnectBlock, only replaced while holding cs_main */
+static std::unique_ptr<ctpl::thread_pool> pcoinsPrefetchPool;
+
+void StartCoinsPrefetchThreads()
+{
+    LOCK(cs_main);
+    assert(!pcoinsPrefetchPool);
+    pcoinsPrefetchPool.reset(new ctpl::thread_pool(std::max(1, std::min(GetNumCores(), MAX_COINS_PREFETCH_THREADS))));
+    RenameThreadPool(*pcoinsPrefetchPool, "coinsprefetch");
+}
+
+void StopCoinsPrefetchThreads()
+{
+    LOCK(cs_main);
+    if (!pcoinsPrefetchPool)
+        return;
+    pcoinsPrefetchPool->stop(true);
+    pcoinsPrefetchPool.reset();
+}
+
+/**
+ * Load the coins spent by the block which aren't in pcoinsTip yet with parallel reads, so that ConnectBlock
+ * doesn't do them one at a time. Without the prefetch threads they are read here one after another. Requires cs_main,
+ * so that pcoinsTip isn't flushed while the reads are going on.
+ */
+static void PrefetchBlockCoins(const CBlock& block)
+{
+    AssertLockHeld(cs_main);
+
+    std::set<uint256> setBlockTxids;
+    for (const auto& tx : block.vtx) {
+        setBlockTxids.insert(tx->GetHash());
+    }
+    std::vector<COutPoint> vOutpoints;
+    for (const auto& tx : block.vtx) {
+        if (tx->IsCoinBase())
+            continue;
+        for (const CTxIn& txin : tx->vin) {
+            // outputs created in the same block aren't in the database
+            if (!setBlockTxids.count(txin.prevout.hash))
+                vOutpoints.push_back(txin.prevout);
+        }
+    }
+    pcoinsTip->PrefetchCoins(std::move(vOutpoints), pcoinsPrefetchPool.get());
+}
 
 /**
  * Used to track blocks whose transactions were applied to the UTXO state as a
@@ -2845,6 +2918,10 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
     int64_t nTime2 = GetTimeMicros(); nTimeReadFromDisk += nTime2 - nTime1;
     int64_t nTime3;
     LogPrint("bench", "  - Load block from disk: %.2fms [%.2fs]\n", (nTime2 - nTime1) * 0.001, nTimeReadFromDisk * 0.000001);
+    PrefetchBlockCoins(blockConnecting);
+    int64_t nTimePrefetched = GetTimeMicros(); nTimePrefetchCoins += nTimePrefetched - nTime2;
+    LogPrint("bench", "  - Prefetch coins: %.2fms [%.2fs]\n", (nTimePrefetched - nTime2) * 0.001, nTimePrefetchCoins * 0.000001);
+    nTime2 = nTimePrefetched;
     {
         auto dbTx = evoDb->BeginTransaction();
 
@@ -3484,7 +3561,7 @@ bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::P
         return false;
 
     // Check the merkle root.
-    if (fCheckMerkleRoot) {
+    if (fCheckMerkleRoot && !block.fCheckedMerkleRoot) {
         bool mutated;
         uint256 hashMerkleRoot2 = BlockMerkleRoot(block, &mutated);
         if (block.hashMerkleRoot != hashMerkleRoot2)
@@ -3495,6 +3572,7 @@ bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::P
         // while still invalidating it.
         if (mutated)
             return state.DoS(100, false, REJECT_INVALID, "bad-txns-duplicate", true, "duplicate transaction");
+        block.fCheckedMerkleRoot = true;
     }
 
     // All potential-corruption validation must be done before we do any
@@ -3523,7 +3601,15 @@ bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::P
         uint256 hashProofOfStake;
         uint256 hash = block.GetHash();
 
-        if(!CheckProofOfStake(block, hashProofOfStake)) {
+        // Headers come first, so a block being synced below the assumed valid block is known by then
+        bool fAssumeValid = false;
+        {
+            LOCK(cs_main);
+            BlockMap::const_iterator mi = mapBlockIndex.find(hash);
+            fAssumeValid = mi != mapBlockIndex.end() && IsAssumedValid(mi->second, consensusParams);
+        }
+
+        if(!CheckProofOfStake(block, hashProofOfStake, fAssumeValid)) {
             return state.DoS(100, error("CheckBlock(): check proof-of-stake failed for block %s\n", hash.ToString().c_str()));
         }
 
@@ -4451,21 +4537,188 @@ bool InitBlockIndex(const CChainParams& chainparams)
     return true;
 }
 
+/** A block read by LoadExternalBlockFile, which is deserialized and checked on the import pool */
+struct CImportedBlock
+{
+    std::shared_ptr<CBlock> pblock;
+    uint256 hash;
+    bool fHavePos;
+    CDiskBlockPos pos;
+    std::string strError;
+    int64_t nTimeDecode;
+};
+
+/** Threads deserializing and checking imported blocks, only replaced while no import is running */
+static std::unique_ptr<ctpl::thread_pool> pblockImportPool;
+
+void StartBlockImportThreads()
+{
+    assert(!pblockImportPool);
+    pblockImportPool.reset(new ctpl::thread_pool(std::max(1, std::min(GetNumCores(), MAX_BLOCK_IMPORT_THREADS))));
+    RenameThreadPool(*pblockImportPool, "blockimport");
+}
+
+void StopBlockImportThreads()
+{
+    if (!pblockImportPool)
+        return;
+    pblockImportPool->stop(true);
+    pblockImportPool.reset();
+}
+
+/**
+ * Deserialize a block and do the checks which need no chain state, so that AcceptBlock finds them done.
+ * The kernel of PoS blocks is checked by AcceptBlock, it needs the blocks before.
+ */
+static CImportedBlock DecodeImportedBlock(const std::vector<char>& vchBlock, const CDiskBlockPos* dbp, const Consensus::Params& consensusParams)
+{
+    int64_t nTimeStart = GetTimeMicros();
+    CImportedBlock imported;
+    imported.fHavePos = dbp != NULL;
+    if (dbp)
+        imported.pos = *dbp;
+    try {
+        CDataStream ss(vchBlock, SER_DISK, CLIENT_VERSION);
+        imported.pblock = std::make_shared<CBlock>();
+        ss >> *imported.pblock;
+        const CBlock& block = *imported.pblock;
+        imported.hash = block.GetHash();
+
+        CValidationState state;
+        if (block.IsProofOfWork()) {
+            CheckBlock(block, state, consensusParams);
+        } else {
+            bool mutated;
+            if (BlockMerkleRoot(block, &mutated) == block.hashMerkleRoot && !mutated)
+                block.fCheckedMerkleRoot = true;
+        }
+    } catch (const std::exception& e) {
+        imported.pblock.reset();
+        imported.strError = e.what();
+    }
+    imported.nTimeDecode = GetTimeMicros() - nTimeStart;
+    return imported;
+}
+
 bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskBlockPos *dbp)
 {
     // Map of disk positions for blocks with unknown parent (only used for reindex)
     static std::multimap<uint256, CDiskBlockPos> mapBlocksUnknownParent;
     int64_t nStart = GetTimeMillis();
+    int64_t nTimeRead = 0, nTimeDecode = 0, nTimeWait = 0, nTimeAccept = 0, nTimeActivate = 0;
+
+    // Blocks are read here, deserialized and checked on the import pool, and accepted in file order.
+    // Without the import threads every block is decoded right before it is accepted.
+    ctpl::thread_pool* pool = pblockImportPool.get();
+    const size_t nDecodeThreads = pool ? pool->size() : 0;
+    std::deque<std::future<CImportedBlock> > dequeDecoding;
+    const size_t nMaxDecoding = MAX_BLOCK_IMPORT_AHEAD_PER_THREAD * std::max(nDecodeThreads, (size_t)1);
 
     int nLoaded = 0;
+    bool fStop = false;
+
+    // Hand the oldest block being decoded to AcceptBlock and ActivateBestChain, returns false to stop the import
+    auto acceptNext = [&]() {
+        int64_t nTime1 = GetTimeMicros();
+        CImportedBlock imported = dequeDecoding.front().get();
+        dequeDecoding.pop_front();
+        int64_t nTime2 = GetTimeMicros(); nTimeWait += nTime2 - nTime1;
+        nTimeDecode += imported.nTimeDecode;
+
+        if (!imported.pblock) {
+            LogPrintf("LoadExternalBlockFile: Deserialize or I/O error - %s\n", imported.strError);
+            return true;
+        }
+        std::shared_ptr<CBlock> pblock = imported.pblock;
+        const CBlock& block = *pblock;
+        const uint256& hash = imported.hash;
+        CDiskBlockPos* pos = imported.fHavePos ? &imported.pos : NULL;
+        {
+            LOCK(cs_main);
+            // detect out of order blocks, and store them for later
+            if (hash != chainparams.GetConsensus().hashGenesisBlock && !LookupBlockIndex(block.hashPrevBlock)) {
+                LogPrintf("LoadExternalBlockFile: Out of order block %s, parent %s not known\n", hash.ToString(),
+                         block.hashPrevBlock.ToString());
+                if (pos)
+                    mapBlocksUnknownParent.insert(std::make_pair(block.hashPrevBlock, *pos));
+                nTimeAccept += GetTimeMicros() - nTime2;
+                return true;
+            }
+
+            // process in case the block isn't known yet
+            CBlockIndex* pindex = LookupBlockIndex(hash);
+            if (!pindex || (pindex->nStatus & BLOCK_HAVE_DATA) == 0) {
+                CValidationState state;
+                if (AcceptBlock(pblock, state, chainparams, nullptr, true, pos, nullptr)) {
+                    nLoaded++;
+                }
+                if (state.IsError()) {
+                    return false;
+                }
+            } else if (hash != chainparams.GetConsensus().hashGenesisBlock && pindex->nHeight % 1000 == 0) {
+                LogPrintf("Block Import: already had block %s at height %d\n", hash.ToString(), pindex->nHeight);
+            }
+        }
+        int64_t nTime3 = GetTimeMicros(); nTimeAccept += nTime3 - nTime2;
+
+        {
+            CValidationState state;
+            if (!ActivateBestChain(state, chainparams)) {
+                return false;
+            }
+        }
+
+        NotifyHeaderTip();
+        int64_t nTime4 = GetTimeMicros(); nTimeActivate += nTime4 - nTime3;
+
+        // Recursively process earlier encountered successors of this block
+        std::deque<uint256> queue;
+        queue.push_back(hash);
+        while (!queue.empty()) {
+            uint256 head = queue.front();
+            queue.pop_front();
+            std::pair<std::multimap<uint256, CDiskBlockPos>::iterator, std::multimap<uint256, CDiskBlockPos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
+            while (range.first != range.second) {
+                std::multimap<uint256, CDiskBlockPos>::iterator it = range.first;
+                std::shared_ptr<CBlock> pblockrecursive = std::make_shared<CBlock>();
+                if (ReadBlockFromDisk(*pblockrecursive, it->second, chainparams.GetConsensus()))
+                {
+                    LogPrintf("LoadExternalBlockFile: Processing out of order child %s of %s\n", pblockrecursive->GetHash().ToString(),
+                             head.ToString());
+                    LOCK(cs_main);
+                    CValidationState dummy;
+                    if (AcceptBlock(pblockrecursive, dummy, chainparams, nullptr, true, &it->second, nullptr))
+                    {
+                        nLoaded++;
+                        queue.push_back(pblockrecursive->GetHash());
+                    }
+                }
+                range.first++;
+                mapBlocksUnknownParent.erase(it);
+                NotifyHeaderTip();
+            }
+        }
+        nTimeAccept += GetTimeMicros() - nTime4;
+        return true;
+    };
+    auto processNext = [&]() {
+        try {
+            return acceptNext();
+        } catch (const std::exception& e) {
+            LogPrintf("LoadExternalBlockFile: Deserialize or I/O error - %s\n", e.what());
+            return true;
+        }
+    };
+
     try {
         unsigned int nMaxBlockSize = MaxBlockSize(true);
         // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
         CBufferedFile blkdat(fileIn, 2*nMaxBlockSize, nMaxBlockSize+8, SER_DISK, CLIENT_VERSION);
         uint64_t nRewind = blkdat.GetPos();
-        while (!blkdat.eof()) {
+        while (!blkdat.eof() && !fStop) {
             boost::this_thread::interruption_point();
 
+            int64_t nTimeReadStart = GetTimeMicros();
             blkdat.SetPos(nRewind);
             nRewind++; // start one byte further next time, in case of failure
             blkdat.SetLimit(); // remove former limit
@@ -4493,84 +4746,48 @@ bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskB
                     dbp->nPos = nBlockPos;
                 blkdat.SetLimit(nBlockPos + nSize);
                 blkdat.SetPos(nBlockPos);
-                std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
-                CBlock& block = *pblock;
-                blkdat >> block;
+                std::vector<char> vchBlock(nSize);
+                blkdat.read(vchBlock.data(), nSize);
                 nRewind = blkdat.GetPos();
 
-                uint256 hash = block.GetHash();
-                {
-                    LOCK(cs_main);
-                    // detect out of order blocks, and store them for later
-                    if (hash != chainparams.GetConsensus().hashGenesisBlock && !LookupBlockIndex(block.hashPrevBlock)) {
-                        LogPrintf("%s: Out of order block %s, parent %s not known\n", __func__, hash.ToString(),
-                                 block.hashPrevBlock.ToString());
-                        if (dbp)
-                            mapBlocksUnknownParent.insert(std::make_pair(block.hashPrevBlock, *dbp));
-                        continue;
-                    }
-
-                    // process in case the block isn't known yet
-                    CBlockIndex* pindex = LookupBlockIndex(hash);
-                    if (!pindex || (pindex->nStatus & BLOCK_HAVE_DATA) == 0) {
-                        CValidationState state;
-                        if (AcceptBlock(pblock, state, chainparams, nullptr, true, dbp, nullptr)) {
-                            nLoaded++;
-                        }
-                        if (state.IsError()) {
-                            break;
-                        }
-                    } else if (hash != chainparams.GetConsensus().hashGenesisBlock && pindex->nHeight % 1000 == 0) {
-                        LogPrintf("Block Import: already had block %s at height %d\n", hash.ToString(), pindex->nHeight);
-                    }
-
-                }
-
-                {
-                    CValidationState state;
-                    if (!ActivateBestChain(state, chainparams)) {
-                        break;
-                    }
-                }
-
-                NotifyHeaderTip();
-
-                // Recursively process earlier encountered successors of this block
-                std::deque<uint256> queue;
-                queue.push_back(hash);
-                while (!queue.empty()) {
-                    uint256 head = queue.front();
-                    queue.pop_front();
-                    std::pair<std::multimap<uint256, CDiskBlockPos>::iterator, std::multimap<uint256, CDiskBlockPos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
-                    while (range.first != range.second) {
-                        std::multimap<uint256, CDiskBlockPos>::iterator it = range.first;
-                        std::shared_ptr<CBlock> pblockrecursive = std::make_shared<CBlock>();
-                        if (ReadBlockFromDisk(*pblockrecursive, it->second, chainparams.GetConsensus()))
-                        {
-                            LogPrintf("%s: Processing out of order child %s of %s\n", __func__, pblockrecursive->GetHash().ToString(),
-                                     head.ToString());
-                            LOCK(cs_main);
-                            CValidationState dummy;
-                            if (AcceptBlock(pblockrecursive, dummy, chainparams, nullptr, true, &it->second, nullptr))
-                            {
-                                nLoaded++;
-                                queue.push_back(pblockrecursive->GetHash());
-                            }
-                        }
-                        range.first++;
-                        mapBlocksUnknownParent.erase(it);
-                        NotifyHeaderTip();
-                    }
-                }
+                CDiskBlockPos posBlock = dbp ? *dbp : CDiskBlockPos();
+                bool fHavePos = dbp != NULL;
+                const Consensus::Params& consensusParams = chainparams.GetConsensus();
+                auto decode = [vchBlock = std::move(vchBlock), posBlock, fHavePos, &consensusParams](int threadId) {
+                    return DecodeImportedBlock(vchBlock, fHavePos ? &posBlock : NULL, consensusParams);
+                };
+                if (pool)
+                    dequeDecoding.push_back(pool->push(std::move(decode)));
+                else
+                    dequeDecoding.push_back(std::async(std::launch::deferred, std::move(decode), 0));
             } catch (const std::exception& e) {
                 LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
             }
+            nTimeRead += GetTimeMicros() - nTimeReadStart;
+
+            while (!fStop && dequeDecoding.size() >= nMaxDecoding) {
+                fStop = !processNext();
+            }
+        }
+        while (!fStop && !dequeDecoding.empty()) {
+            boost::this_thread::interruption_point();
+            fStop = !processNext();
         }
     } catch (const std::runtime_error& e) {
         AbortNode(std::string("System error: ") + e.what());
     }
-    if (nLoaded > 0)
+    // Blocks still being decoded when the import stopped are dropped, the workers only touch their own copy.
+    // Blocks left to decode without the import threads are never decoded at all.
+    if (pool) {
+        for (std::future<CImportedBlock>& future : dequeDecoding) {
+            future.wait();
+        }
+    }
+    if (nLoaded > 0) {
         LogPrintf("Loaded %i blocks from external file in %dms\n", nLoaded, GetTimeMillis() - nStart);
+        LogPrintf("Block import stages: read %.2fms, decode %.2fms on %u threads (waited %.2fms), accept %.2fms, activate %.2fms\n",
+                  nTimeRead * 0.001, nTimeDecode * 0.001, (unsigned int)nDecodeThreads, nTimeWait * 0.001, nTimeAccept * 0.001, nTimeActivate * 0.001);
+    }
     return nLoaded > 0;
 }
 
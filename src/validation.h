@@ -38,6 +38,7 @@ class CBlockIndex;
 class CBlockTreeDB;
 class CBloomFilter;
 class CChainParams;
+class CCoinsViewBackgroundFlush;
 class CCoinsViewDB;
 class CInv;
 class CConnman;
@@ -84,7 +85,13 @@ static const unsigned int BLOCKFILE_CHUNK_SIZE = 0x1000000; // 16 MiB
 static const unsigned int UNDOFILE_CHUNK_SIZE = 0x100000; // 1 MiB
 
 /** Maximum number of script-checking threads allowed */
-static const int MAX_SCRIPTCHECK_THREADS = 16;
+static const int MAX_SCRIPTCHECK_THREADS = 64;
+/** Maximum number of threads reading the coins spent by a block ahead of ConnectBlock */
+static const int MAX_COINS_PREFETCH_THREADS = 8;
+/** Maximum number of threads deserializing and checking blocks during -reindex and -loadblock */
+static const int MAX_BLOCK_IMPORT_THREADS = 8;
+/** Number of blocks read ahead of AcceptBlock per import thread */
+static const unsigned int MAX_BLOCK_IMPORT_AHEAD_PER_THREAD = 4;
 /** -par default (number of script-checking threads, 0 = auto) */
 static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
 /** Number of blocks that can be requested at any given time from a single peer. */
@@ -279,6 +286,14 @@ bool LoadBlockIndex(const CChainParams& chainparams);
 void UnloadBlockIndex();
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck();
+/** Create the threads ConnectTip reads the coins spent by a block with */
+void StartCoinsPrefetchThreads();
+/** Stop the coins prefetch threads, before pcoinsTip is deleted */
+void StopCoinsPrefetchThreads();
+/** Create the threads LoadExternalBlockFile deserializes and checks blocks with */
+void StartBlockImportThreads();
+/** Stop the block import threads, once no import is running anymore */
+void StopBlockImportThreads();
 /** Check whether we are doing an initial block download (synchronizing from disk or network) */
 bool IsInitialBlockDownload();
 /** Format a string that describes several potential problems detected by the core.
@@ -537,6 +552,9 @@ extern CChain chainActive;
 /** Global variable that points to the coins database (protected by cs_main) */
 extern CCoinsViewDB *pcoinsdbview;
 
+/** Global variable that points to the view between pcoinsTip and the coins database, which writes flushes in the background (protected by cs_main) */
+extern CCoinsViewBackgroundFlush *pcoinsflushview;
+
 /** Global variable that points to the active CCoinsView (protected by cs_main) */
 extern CCoinsViewCache *pcoinsTip;
 
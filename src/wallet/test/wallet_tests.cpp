@@ -9,9 +9,13 @@
 #include <utility>
 #include <vector>
 
+#include "consensus/validation.h"
+#include "kernel.h"
 #include "rpc/server.h"
+#include "script/interpreter.h"
 #include "test/test_polis.h"
 #include "validation.h"
+#include "validationinterface.h"
 #include "wallet/test/wallet_test_fixture.h"
 
 #include <boost/foreach.hpp>
@@ -53,8 +57,7 @@ static void add_coin(const CAmount& nValue, int nAge = 6*24, bool fIsFromMe = fa
     std::unique_ptr<CWalletTx> wtx(new CWalletTx(&wallet, MakeTransactionRef(std::move(tx))));
     if (fIsFromMe)
     {
-        wtx->fDebitCached = true;
-        wtx->nDebitCached = 1;
+        wtx->amountCache.Set(CWalletTxAmountCache::DEBIT, 1);
     }
     COutput output(wtx.get(), nInput, nAge, true, true);
     vCoins.push_back(output);
@@ -361,6 +364,35 @@ BOOST_AUTO_TEST_CASE(ApproximateBestSubset)
     empty_wallet();
 }
 
+BOOST_AUTO_TEST_CASE(wallet_tx_amount_cache)
+{
+    CWalletTxAmountCache cache;
+    CAmount nAmount = -1;
+    BOOST_CHECK(!cache.Get(CWalletTxAmountCache::CREDIT, nAmount));
+    BOOST_CHECK_EQUAL(cache.DynamicMemoryUsage(), 0U);
+
+    // cached zero amounts are distinct from missing ones
+    cache.Set(CWalletTxAmountCache::CREDIT, 0);
+    cache.Set(CWalletTxAmountCache::CHANGE, 5 * COIN);
+    BOOST_CHECK(cache.Get(CWalletTxAmountCache::CREDIT, nAmount));
+    BOOST_CHECK_EQUAL(nAmount, 0);
+    BOOST_CHECK(cache.Get(CWalletTxAmountCache::CHANGE, nAmount));
+    BOOST_CHECK_EQUAL(nAmount, 5 * COIN);
+    BOOST_CHECK(!cache.Get(CWalletTxAmountCache::DEBIT, nAmount));
+    BOOST_CHECK(cache.DynamicMemoryUsage() > 0);
+
+    // copies start out empty
+    CWalletTxAmountCache cacheCopy(cache);
+    BOOST_CHECK(!cacheCopy.Get(CWalletTxAmountCache::CHANGE, nAmount));
+    cacheCopy.Set(CWalletTxAmountCache::DEBIT, COIN);
+    cacheCopy = cache;
+    BOOST_CHECK(!cacheCopy.Get(CWalletTxAmountCache::DEBIT, nAmount));
+
+    cache.Clear();
+    BOOST_CHECK(!cache.Get(CWalletTxAmountCache::CHANGE, nAmount));
+    BOOST_CHECK_EQUAL(cache.DynamicMemoryUsage(), 0U);
+}
+
 BOOST_FIXTURE_TEST_CASE(rescan, TestChain100Setup)
 {
     LOCK(cs_main);
@@ -488,4 +520,136 @@ BOOST_FIXTURE_TEST_CASE(importwallet_rescan, TestChain100Setup)
     ::pwalletMain = pwalletMainBackup;
 }
 
+// Exposes the stake candidate queues of the wallet
+class CStakeTestWallet : public CWallet
+{
+public:
+    using CWallet::mapStakeCandidates;
+    using CWallet::UpdateStakeCandidates;
+
+    // height at which the outpoint is queued to reach the stake min depth, -1 if it isn't
+    int GetQueuedHeight(const COutPoint& outpoint) const
+    {
+        for (const auto& pair : mapStakeDepthQueue) {
+            if (pair.second == outpoint)
+                return pair.first;
+        }
+        return -1;
+    }
+
+    // time at which the outpoint is queued to reach the stake min age, -1 if it isn't
+    int64_t GetQueuedTime(const COutPoint& outpoint) const
+    {
+        for (const auto& pair : mapStakeAgeQueue) {
+            if (pair.second == outpoint)
+                return pair.first;
+        }
+        return -1;
+    }
+};
+
+static CMutableTransaction CreateSpend(const CKey& key, const CTransaction& txFrom, unsigned int n, const std::vector<CTxOut>& vout)
+{
+    CMutableTransaction tx;
+    tx.nVersion = 1;
+    tx.vin.resize(1);
+    tx.vin[0].prevout = COutPoint(txFrom.GetHash(), n);
+    tx.vout = vout;
+
+    std::vector<unsigned char> vchSig;
+    uint256 hash = SignatureHash(txFrom.vout[n].scriptPubKey, tx, 0, SIGHASH_ALL);
+    BOOST_CHECK(key.Sign(hash, vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    tx.vin[0].scriptSig << vchSig;
+    return tx;
+}
+
+// Confirmed coins are queued for their depth and then for their age, spends drop them and disconnected spends
+// queue them again
+BOOST_FIXTURE_TEST_CASE(stake_candidates, TestChain100Setup)
+{
+    SetMockTime(chainActive.Tip()->GetBlockTimeMax() + 5);
+    const CScript scriptMine = GetScriptForRawPubKey(coinbaseKey.GetPubKey());
+    CKey keyWatch;
+    keyWatch.MakeNewKey(true);
+    const CScript scriptWatch = GetScriptForRawPubKey(keyWatch.GetPubKey());
+    CKey keyOther;
+    keyOther.MakeNewKey(true);
+    BOOST_REQUIRE(coinbaseTxns[0].vout[0].scriptPubKey == scriptMine);
+
+    CStakeTestWallet wallet;
+    {
+        LOCK2(cs_main, wallet.cs_wallet);
+        wallet.AddKeyPubKey(coinbaseKey, coinbaseKey.GetPubKey());
+        wallet.AddWatchOnly(scriptWatch, 0);
+        wallet.UpdateStakeCandidates();
+    }
+    RegisterValidationInterface(&wallet);
+
+    // a coin of ours and a watch-only one, confirmed in block 101
+    CMutableTransaction txFund = CreateSpend(coinbaseKey, coinbaseTxns[0], 0, {CTxOut(1000 * COIN, scriptMine), CTxOut(1000 * COIN, scriptWatch)});
+    CreateAndProcessBlock({txFund}, scriptMine);
+    const COutPoint outpointMine(txFund.GetHash(), 0);
+    const COutPoint outpointWatch(txFund.GetHash(), 1);
+    {
+        LOCK2(cs_main, wallet.cs_wallet);
+        BOOST_CHECK_EQUAL(chainActive.Height(), 101);
+        wallet.UpdateStakeCandidates();
+        BOOST_CHECK_EQUAL(wallet.GetQueuedHeight(outpointMine), 110);
+        BOOST_CHECK_EQUAL(wallet.GetQueuedTime(outpointMine), -1);
+        BOOST_CHECK_EQUAL(wallet.GetQueuedHeight(outpointWatch), -1);
+        BOOST_CHECK_EQUAL(wallet.GetQueuedTime(outpointWatch), -1);
+    }
+
+    // with 10 confirmations it waits for the min stake age
+    for (int i = 0; i < 9; i++)
+        CreateAndProcessBlock({}, scriptMine);
+    {
+        LOCK2(cs_main, wallet.cs_wallet);
+        BOOST_CHECK_EQUAL(chainActive.Height(), 110);
+        wallet.UpdateStakeCandidates();
+        const CWalletTx* pwtx = wallet.GetWalletTx(txFund.GetHash());
+        BOOST_REQUIRE(pwtx);
+        BOOST_CHECK_EQUAL(wallet.GetQueuedHeight(outpointMine), -1);
+        BOOST_CHECK_EQUAL(wallet.GetQueuedTime(outpointMine), pwtx->GetTxTime() + CurrentMinStakeAge(pwtx->GetTxTime()));
+        BOOST_CHECK_EQUAL(wallet.GetQueuedTime(outpointWatch), -1);
+        BOOST_CHECK_EQUAL(wallet.GetStakeInputs(), 0);
+
+        // as if it had reached the min stake age and its stake modifier were known
+        CStakeCandidate candidate;
+        candidate.prevout = outpointMine;
+        candidate.txout = txFund.vout[0];
+        candidate.nTimeBlockFrom = chainActive[101]->GetBlockTime();
+        candidate.nStakeModifier = 0;
+        wallet.mapStakeCandidates[outpointMine] = candidate;
+        BOOST_CHECK_EQUAL(wallet.GetStakeInputs(), 1);
+    }
+
+    // spending it in a block drops the candidate
+    CMutableTransaction txSpend = CreateSpend(coinbaseKey, txFund, 0, {CTxOut(999 * COIN, GetScriptForRawPubKey(keyOther.GetPubKey()))});
+    CreateAndProcessBlock({txSpend}, scriptMine);
+    {
+        LOCK2(cs_main, wallet.cs_wallet);
+        BOOST_CHECK_EQUAL(chainActive.Height(), 111);
+        BOOST_CHECK_EQUAL(wallet.GetStakeInputs(), 0);
+    }
+
+    // disconnecting the block queues the coin it spent again
+    {
+        LOCK(cs_main);
+        CValidationState state;
+        BOOST_CHECK(InvalidateBlock(state, Params(), chainActive.Tip()));
+    }
+    {
+        LOCK2(cs_main, wallet.cs_wallet);
+        BOOST_CHECK_EQUAL(chainActive.Height(), 110);
+        BOOST_CHECK_EQUAL(wallet.GetQueuedHeight(outpointMine), 110);
+        BOOST_CHECK_EQUAL(wallet.GetQueuedHeight(outpointWatch), -1);
+        BOOST_CHECK_EQUAL(wallet.GetQueuedTime(outpointWatch), -1);
+    }
+
+    UnregisterValidationInterface(&wallet);
+    SetMockTime(0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -12,6 +12,8 @@
 #include "wallet/coincontrol.h"
 #include "consensus/consensus.h"
 #include "consensus/validation.h"
+#include "core_memusage.h"
+#include "ctpl.h"
 #include "key.h"
 #include "keystore.h"
 #include "kernel.h"
@@ -39,6 +41,8 @@
 #include "evo/providertx.h"
 
 #include <assert.h>
+#include <future>
+#include <unordered_set>
 
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/filesystem.hpp>
@@ -122,8 +126,9 @@ CPubKey CWallet::GenerateNewKey(uint32_t nAccountIndex, bool fInternal)
     CPubKey pubkey;
     // use HD key derivation if HD was enabled during wallet creation
     if (IsHDEnabled()) {
-        DeriveNewChildKey(metadata, secret, nAccountIndex, fInternal);
-        pubkey = secret.GetPubKey();
+        std::vector<CPubKey> vecPubKeys;
+        DeriveNewChildKeys(metadata, nAccountIndex, fInternal, 1, vecPubKeys);
+        pubkey = vecPubKeys[0];
     } else {
         secret.MakeNewKey(fCompressed);
 
@@ -144,8 +149,42 @@ CPubKey CWallet::GenerateNewKey(uint32_t nAccountIndex, bool fInternal)
     return pubkey;
 }
 
-void CWallet::DeriveNewChildKey(const CKeyMetadata& metadata, CKey& secretRet, uint32_t nAccountIndex, bool fInternal)
+/** Derives the children nFirstChild..nFirstChild+nCount-1 of parentKey, splits larger batches over several threads */
+static std::vector<CExtPubKey> DeriveChildExtPubKeys(const CExtKey& parentKey, uint32_t nFirstChild, size_t nCount)
 {
+    std::vector<CExtPubKey> vecRet(nCount);
+    auto derive = [&](size_t nBegin, size_t nEnd) {
+        CExtKey childKey;
+        for (size_t i = nBegin; i < nEnd; i++) {
+            parentKey.Derive(childKey, nFirstChild + i);
+            vecRet[i] = childKey.Neuter();
+            assert(childKey.key.VerifyPubKey(vecRet[i].pubkey));
+        }
+    };
+
+    size_t nThreads = std::min((size_t)std::max(1, std::min(GetNumCores(), MAX_KEY_DERIVATION_THREADS)), nCount / MIN_KEYS_PER_DERIVATION_THREAD);
+    if (nThreads <= 1) {
+        derive(0, nCount);
+        return vecRet;
+    }
+
+    ctpl::thread_pool workerPool(nThreads);
+    RenameThreadPool(workerPool, "keyderive");
+    std::vector<std::future<void> > vFutures;
+    for (size_t i = 0; i < nThreads; i++) {
+        vFutures.emplace_back(workerPool.push([&, i](int) {
+            derive(nCount * i / nThreads, nCount * (i + 1) / nThreads);
+        }));
+    }
+    for (auto& future : vFutures)
+        future.get();
+    return vecRet;
+}
+
+void CWallet::DeriveNewChildKeys(const CKeyMetadata& metadata, uint32_t nAccountIndex, bool fInternal, size_t nCount, std::vector<CPubKey>& vecPubKeysRet, CWalletDB* pwalletdb)
+{
+    AssertLockHeld(cs_wallet); // mapKeyMetadata
+
     CHDChain hdChainTmp;
     if (!GetHDChain(hdChainTmp)) {
         throw std::runtime_error(std::string(__func__) + ": GetHDChain failed");
@@ -161,21 +200,37 @@ void CWallet::DeriveNewChildKey(const CKeyMetadata& metadata, CKey& secretRet, u
     if (!hdChainTmp.GetAccount(nAccountIndex, acc))
         throw std::runtime_error(std::string(__func__) + ": Wrong HD account!");
 
-    // derive child key at next index, skip keys already known to the wallet
-    CExtKey childKey;
+    // all keys share m/purpose'/coin_type'/account'/change, derive it once instead of from the seed for every key
+    CExtKey changeKey;
+    hdChainTmp.DeriveChangeExtKey(nAccountIndex, fInternal, changeKey);
+
+    // derive child keys starting at next index, skip keys already known to the wallet
+    std::vector<CExtPubKey> vecExtPubKeys;
     uint32_t nChildIndex = fInternal ? acc.nInternalChainCounter : acc.nExternalChainCounter;
-    do {
-        hdChainTmp.DeriveChildExtKey(nAccountIndex, fInternal, nChildIndex, childKey);
-        // increment childkey index
-        nChildIndex++;
-    } while (HaveKey(childKey.key.GetPubKey().GetID()));
-    secretRet = childKey.key;
-
-    CPubKey pubkey = secretRet.GetPubKey();
-    assert(secretRet.VerifyPubKey(pubkey));
-
-    // store metadata
-    mapKeyMetadata[pubkey.GetID()] = metadata;
+    while (vecExtPubKeys.size() < nCount) {
+        std::vector<CExtPubKey> vecDerived = DeriveChildExtPubKeys(changeKey, nChildIndex, nCount - vecExtPubKeys.size());
+        nChildIndex += vecDerived.size();
+        for (const CExtPubKey& extPubKey : vecDerived) {
+            if (!HaveKey(extPubKey.pubkey.GetID()))
+                vecExtPubKeys.push_back(extPubKey);
+        }
+    }
+
+    std::unique_ptr<CWalletDB> walletdbLocal;
+    if (!fFileBacked) {
+        pwalletdb = NULL;
+    } else if (!pwalletdb) {
+        walletdbLocal.reset(new CWalletDB(strWalletFile));
+        pwalletdb = walletdbLocal.get();
+    }
+
+    for (const CExtPubKey& extPubKey : vecExtPubKeys) {
+        // store metadata
+        mapKeyMetadata[extPubKey.pubkey.GetID()] = metadata;
+        if (!AddHDPubKey(extPubKey, fInternal, hdChainTmp.GetID(), pwalletdb))
+            throw std::runtime_error(std::string(__func__) + ": AddHDPubKey failed");
+        vecPubKeysRet.push_back(extPubKey.pubkey);
+    }
     UpdateTimeFirstKey(metadata.nCreateTime);
 
     // update the chain model in the database
@@ -192,56 +247,21 @@ void CWallet::DeriveNewChildKey(const CKeyMetadata& metadata, CKey& secretRet, u
     if (!hdChainCurrent.SetAccount(nAccountIndex, acc))
         throw std::runtime_error(std::string(__func__) + ": SetAccount failed");
 
+    // write through pwalletdb so that the chain is part of the caller's transaction
     if (IsCrypted()) {
-        if (!SetCryptedHDChain(hdChainCurrent, false))
+        if (!SetCryptedHDChain(hdChainCurrent, true) || (pwalletdb && !pwalletdb->WriteCryptedHDChain(hdChainCurrent)))
             throw std::runtime_error(std::string(__func__) + ": SetCryptedHDChain failed");
     }
     else {
-        if (!SetHDChain(hdChainCurrent, false))
+        if (!SetHDChain(hdChainCurrent, true) || (pwalletdb && !pwalletdb->WriteHDChain(hdChainCurrent)))
             throw std::runtime_error(std::string(__func__) + ": SetHDChain failed");
     }
-
-    if (!AddHDPubKey(childKey.Neuter(), fInternal))
-        throw std::runtime_error(std::string(__func__) + ": AddHDPubKey failed");
 }
 
 CAmount GetStakeReward(CAmount blockReward, unsigned int percentage)
 {
     return (blockReward / 100) * percentage;
 }
-bool CWallet::CreateCoinStakeKernel(CScript &kernelScript, const CScript &stakeScript,
-                                    unsigned int nBits, const CBlock &blockFrom,
-                                    unsigned int nTxPrevOffset, const CTransactionRef &txPrev,
-                                    const COutPoint &prevout, unsigned int &nTimeTx, bool fPrintProofOfStake) const
-{
-    unsigned int nTryTime = 0;
-    uint256 hashProofOfStake;
-
-    auto nStakeMinAge = CurrentMinStakeAge(blockFrom.GetBlockTime());
-
-    if (blockFrom.GetBlockTime() + nStakeMinAge + nHashDrift > nTimeTx) // Min age requirement
-        return false;
-    for(unsigned int i = 0; i < nHashDrift; ++i)
-    {
-        nTryTime = nTimeTx + nHashDrift - i;
-        if (CheckStakeKernelHash(nBits, blockFrom, nTxPrevOffset, txPrev, prevout, nTryTime, hashProofOfStake))
-        {
-            //Double check that this will pass time requirements
-            if (nTryTime <= chainActive.Tip()->GetMedianTimePast()) {
-                LogPrintf("CreateCoinStakeKernel() : kernel found, but it is too far in the past \n");
-                continue;
-            }
-            // Found a kernel
-            if (fDebug && GetBoolArg("-printcoinstake", false))
-                LogPrintf("CreateCoinStakeKernel : kernel found\n");
-            kernelScript.clear();
-            kernelScript = stakeScript;
-            nTimeTx = nTryTime;
-            return true;
-        }
-    }
-    return false;
-}
 void CWallet::FillCoinStakePayments(CMutableTransaction &transaction,
                                     const CScript &scriptPubKeyOut,
                                     const COutPoint &stakePrevout,
@@ -326,16 +346,13 @@ bool CWallet::LoadHDPubKey(const CHDPubKey &hdPubKey)
     return true;
 }
 
-bool CWallet::AddHDPubKey(const CExtPubKey &extPubKey, bool fInternal)
+bool CWallet::AddHDPubKey(const CExtPubKey &extPubKey, bool fInternal, const uint256& hdchainID, CWalletDB* pwalletdb)
 {
     AssertLockHeld(cs_wallet);
 
-    CHDChain hdChainCurrent;
-    GetHDChain(hdChainCurrent);
-
     CHDPubKey hdPubKey;
     hdPubKey.extPubKey = extPubKey;
-    hdPubKey.hdchainID = hdChainCurrent.GetID();
+    hdPubKey.hdchainID = hdchainID;
     hdPubKey.nChangeIndex = fInternal ? 1 : 0;
     mapHdPubKeys[extPubKey.pubkey.GetID()] = hdPubKey;
 
@@ -343,14 +360,16 @@ bool CWallet::AddHDPubKey(const CExtPubKey &extPubKey, bool fInternal)
     CScript script;
     script = GetScriptForDestination(extPubKey.pubkey.GetID());
     if (HaveWatchOnly(script))
-        RemoveWatchOnly(script);
+        RemoveWatchOnly(script, pwalletdb);
     script = GetScriptForRawPubKey(extPubKey.pubkey);
     if (HaveWatchOnly(script))
-        RemoveWatchOnly(script);
+        RemoveWatchOnly(script, pwalletdb);
 
     if (!fFileBacked)
         return true;
 
+    if (pwalletdb)
+        return pwalletdb->WriteHDPubKey(hdPubKey, mapKeyMetadata[extPubKey.pubkey.GetID()]);
     return CWalletDB(strWalletFile).WriteHDPubKey(hdPubKey, mapKeyMetadata[extPubKey.pubkey.GetID()]);
 }
 
@@ -469,15 +488,25 @@ bool CWallet::AddWatchOnly(const CScript& dest, int64_t nCreateTime)
 }
 
 bool CWallet::RemoveWatchOnly(const CScript &dest)
+{
+    return RemoveWatchOnly(dest, NULL);
+}
+
+bool CWallet::RemoveWatchOnly(const CScript &dest, CWalletDB* pwalletdb)
 {
     AssertLockHeld(cs_wallet);
     if (!CCryptoKeyStore::RemoveWatchOnly(dest))
         return false;
     if (!HaveWatchOnly())
         NotifyWatchonlyChanged(false);
-    if (fFileBacked)
-        if (!CWalletDB(strWalletFile).EraseWatchOnly(dest))
+    if (fFileBacked) {
+        if (pwalletdb) {
+            if (!pwalletdb->EraseWatchOnly(dest))
+                return false;
+        } else if (!CWalletDB(strWalletFile).EraseWatchOnly(dest)) {
             return false;
+        }
+    }
 
     return true;
 }
@@ -674,6 +703,18 @@ std::set<uint256> CWallet::GetConflicts(const uint256& txid) const
 
 void CWallet::Flush(bool shutdown)
 {
+    if (shutdown && fFileBacked) {
+        // keep the PrivateSend rounds of our unspent outputs, these are the inputs of whatever gets mixed next
+        LOCK(cs_wallet);
+        std::map<COutPoint, int> mapRounds;
+        for (const auto& outpoint : setWalletUTXO) {
+            std::map<COutPoint, int>::const_iterator it = mapOutpointPrivateSendRounds.find(outpoint);
+            if (it != mapOutpointPrivateSendRounds.end()) {
+                mapRounds.insert(*it);
+            }
+        }
+        CWalletDB(strWalletFile).WritePrivateSendRounds(nOrderPosNext, mapRounds);
+    }
     bitdb.Flush(shutdown);
 }
 
@@ -799,7 +840,7 @@ bool CWallet::IsSpent(const uint256& hash, unsigned int n) const
 void CWallet::AddToSpends(const COutPoint& outpoint, const uint256& wtxid)
 {
     mapTxSpends.insert(std::make_pair(outpoint, wtxid));
-    setWalletUTXO.erase(outpoint);
+    EraseWalletUTXO(outpoint);
 
     std::pair<TxSpends::iterator, TxSpends::iterator> range;
     range = mapTxSpends.equal_range(outpoint);
@@ -818,6 +859,88 @@ void CWallet::AddToSpends(const uint256& wtxid)
         AddToSpends(txin.prevout, wtxid);
 }
 
+void CWallet::InsertWalletUTXO(const COutPoint& outpoint, CAmount nValue)
+{
+    setWalletUTXO.insert(outpoint);
+    if (CPrivateSend::IsDenominatedAmount(nValue))
+        mapDenominatedUTXO[nValue].insert(outpoint);
+}
+
+void CWallet::EraseWalletUTXO(const COutPoint& outpoint)
+{
+    if (!setWalletUTXO.erase(outpoint))
+        return;
+    // there are only a handful of denominations, cheaper than looking up the value
+    for (auto& bucket : mapDenominatedUTXO) {
+        if (bucket.second.erase(outpoint))
+            break;
+    }
+}
+
+void CWallet::AddToWalletUTXO(const COutPoint& outpoint)
+{
+    std::map<uint256, CWalletTx>::const_iterator it = mapWallet.find(outpoint.hash);
+    if (it == mapWallet.end() || outpoint.n >= it->second.tx->vout.size())
+        return;
+    if (IsMine(it->second.tx->vout[outpoint.n]) && !IsSpent(outpoint.hash, outpoint.n))
+        InsertWalletUTXO(outpoint, it->second.tx->vout[outpoint.n].nValue);
+}
+
+void CWallet::RebuildWalletUTXO()
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
+
+    setWalletUTXO.clear();
+    mapDenominatedUTXO.clear();
+    for (auto& pair : mapWallet) {
+        for(unsigned int i = 0; i < pair.second.tx->vout.size(); ++i) {
+            if (IsMine(pair.second.tx->vout[i]) && !IsSpent(pair.first, i)) {
+                InsertWalletUTXO(COutPoint(pair.first, i), pair.second.tx->vout[i].nValue);
+            }
+        }
+    }
+}
+
+std::vector<const CWalletTx*> CWallet::GetWalletUTXOTxes() const
+{
+    AssertLockHeld(cs_wallet);
+
+    std::vector<const CWalletTx*> vecTxes;
+    // outpoints are ordered by hash, so outputs of the same transaction are next to each other
+    const uint256* pLastHash = nullptr;
+    for (const auto& outpoint : setWalletUTXO) {
+        if (pLastHash && *pLastHash == outpoint.hash)
+            continue;
+        pLastHash = &outpoint.hash;
+        std::map<uint256, CWalletTx>::const_iterator it = mapWallet.find(outpoint.hash);
+        if (it != mapWallet.end())
+            vecTxes.push_back(&it->second);
+    }
+    return vecTxes;
+}
+
+std::vector<const CWalletTx*> CWallet::GetDenominatedUTXOTxes(const std::vector<CAmount>& vecDenominations) const
+{
+    AssertLockHeld(cs_wallet);
+
+    std::set<uint256> setHashes;
+    for (const auto& bucket : mapDenominatedUTXO) {
+        if (!vecDenominations.empty() && std::find(vecDenominations.begin(), vecDenominations.end(), bucket.first) == vecDenominations.end())
+            continue;
+        for (const auto& outpoint : bucket.second)
+            setHashes.insert(outpoint.hash);
+    }
+
+    std::vector<const CWalletTx*> vecTxes;
+    for (const uint256& hash : setHashes) {
+        std::map<uint256, CWalletTx>::const_iterator it = mapWallet.find(hash);
+        if (it != mapWallet.end())
+            vecTxes.push_back(&it->second);
+    }
+    return vecTxes;
+}
+
 bool CWallet::EncryptWallet(const SecureString& strWalletPassphrase)
 {
     if (IsCrypted())
@@ -1113,9 +1236,11 @@ bool CWallet::GetAccountPubkey(CPubKey &pubKey, std::string strAccount, bool bFo
 void CWallet::MarkDirty()
 {
     {
-        LOCK(cs_wallet);
+        LOCK2(cs_main, cs_wallet);
         BOOST_FOREACH(PAIRTYPE(const uint256, CWalletTx)& item, mapWallet)
             item.second.MarkDirty();
+        // called after keys or scripts were imported, outputs might have become ours
+        RebuildWalletUTXO();
     }
 
     fAnonymizableTallyCached = false;
@@ -1186,10 +1311,12 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
                          wtxIn.hashBlock.ToString());
         }
         AddToSpends(hash);
+        // descendants already in the wallet (e.g. found first by a rescan) were computed without this one
+        InvalidatePrivateSendRounds(hash);
 
         for(unsigned int i = 0; i < wtx.tx->vout.size(); ++i) {
             if (IsMine(wtx.tx->vout[i]) && !IsSpent(hash, i)) {
-                setWalletUTXO.insert(COutPoint(hash, i));
+                InsertWalletUTXO(COutPoint(hash, i), wtx.tx->vout[i].nValue);
                 if (deterministicMNManager->IsProTxWithCollateral(wtx.tx, i) || deterministicMNManager->HasMNCollateralAtChainTip(COutPoint(hash, i))) {
                     LockCoin(COutPoint(hash, i));
                 }
@@ -1257,8 +1384,8 @@ bool CWallet::LoadToWallet(const CWalletTx& wtxIn)
 {
     uint256 hash = wtxIn.GetHash();
 
-    mapWallet[hash] = wtxIn;
     CWalletTx& wtx = mapWallet[hash];
+    wtx = wtxIn;
     wtx.BindWallet(this);
     wtxOrdered.insert(std::make_pair(wtx.nOrderPos, TxPair(&wtx, (CAccountingEntry*)0)));
     AddToSpends(hash);
@@ -1371,6 +1498,7 @@ bool CWallet::AbandonTransaction(const uint256& hashTx)
             {
                 if (mapWallet.count(txin.prevout.hash))
                     mapWallet[txin.prevout.hash].MarkDirty();
+                AddToWalletUTXO(txin.prevout);
             }
         }
     }
@@ -1435,6 +1563,7 @@ void CWallet::MarkConflicted(const uint256& hashBlock, const uint256& hashTx)
             {
                 if (mapWallet.count(txin.prevout.hash))
                     mapWallet[txin.prevout.hash].MarkDirty();
+                AddToWalletUTXO(txin.prevout);
             }
         }
     }
@@ -1450,6 +1579,25 @@ void CWallet::SyncTransaction(const CTransaction& tx, const CBlockIndex *pindex,
     if (!AddToWalletIfInvolvingMe(tx, pindex, posInBlock, true))
         return; // Not one of ours
 
+    if (posInBlock != CMainSignals::SYNC_TRANSACTION_NOT_IN_BLOCK) {
+        // outputs spent in a block can't be staked anymore, new outputs can be once they are old enough
+        for (const CTxIn& txin : tx.vin)
+            mapStakeCandidates.erase(txin.prevout);
+        QueueStakeCoins(mapWallet[tx.GetHash()]);
+    } else {
+        // the transaction isn't in the chain (anymore), so neither are its outputs
+        for (unsigned int i = 0; i < tx.vout.size(); i++)
+            mapStakeCandidates.erase(COutPoint(tx.GetHash(), i));
+        // and when it was disconnected, the coins it spent are unspent in the chain again
+        if (pindex) {
+            for (const CTxIn& txin : tx.vin) {
+                std::map<uint256, CWalletTx>::const_iterator mi = mapWallet.find(txin.prevout.hash);
+                if (mi != mapWallet.end())
+                    QueueStakeCoins(mi->second);
+            }
+        }
+    }
+
     // If a transaction changes 'conflicted' state, that changes the balance
     // available of the outputs it spends. So force those to be
     // recomputed, also:
@@ -1457,6 +1605,7 @@ void CWallet::SyncTransaction(const CTransaction& tx, const CBlockIndex *pindex,
     {
         if (mapWallet.count(txin.prevout.hash))
             mapWallet[txin.prevout.hash].MarkDirty();
+        AddToWalletUTXO(txin.prevout);
     }
 
     fAnonymizableTallyCached = false;
@@ -1497,86 +1646,146 @@ CAmount CWallet::GetDebit(const CTxIn &txin, const isminefilter& filter) const
     return 0;
 }
 
-// Recursively determine the rounds of a given input (How deep is the PrivateSend chain for a given input)
-int CWallet::GetRealOutpointPrivateSendRounds(const COutPoint& outpoint, int nRounds) const
+bool CWallet::ComputeOutpointPrivateSendRounds(const COutPoint& outpoint, std::vector<COutPoint>& vecMissing, int& nRoundsRet) const
 {
-    static std::map<uint256, CMutableTransaction> mDenomWtxes;
+    AssertLockHeld(cs_wallet);
+
+    // callers only ask for outputs of transactions in the wallet
+    const CWalletTx* wtx = GetWalletTx(outpoint.hash);
+    assert(wtx != NULL);
 
-    if(nRounds >= MAX_PRIVATESEND_ROUNDS) {
-        // there can only be MAX_PRIVATESEND_ROUNDS rounds max
-        return MAX_PRIVATESEND_ROUNDS - 1;
+    // bounds check
+    if (outpoint.n >= wtx->tx->vout.size()) {
+        // should never actually hit this
+        nRoundsRet = -4;
+        return true;
     }
 
-    uint256 hash = outpoint.hash;
-    unsigned int nout = outpoint.n;
+    if (CPrivateSend::IsCollateralAmount(wtx->tx->vout[outpoint.n].nValue)) {
+        nRoundsRet = -3;
+        return true;
+    }
 
-    const CWalletTx* wtx = GetWalletTx(hash);
-    if(wtx != NULL)
-    {
-        std::map<uint256, CMutableTransaction>::const_iterator mdwi = mDenomWtxes.find(hash);
-        if (mdwi == mDenomWtxes.end()) {
-            // not known yet, let's add it
-            LogPrint("privatesend", "GetRealOutpointPrivateSendRounds INSERTING %s\n", hash.ToString());
-            mDenomWtxes[hash] = CMutableTransaction(*wtx);
-        } else if(mDenomWtxes[hash].vout[nout].nRounds != -10) {
-            // found and it's not an initial value, just return it
-            return mDenomWtxes[hash].vout[nout].nRounds;
-        }
+    //make sure the final output is non-denominate
+    if (!CPrivateSend::IsDenominatedAmount(wtx->tx->vout[outpoint.n].nValue)) { //NOT DENOM
+        nRoundsRet = -2;
+        return true;
+    }
 
+    bool fAllDenoms = true;
+    for (const auto& out : wtx->tx->vout) {
+        fAllDenoms = fAllDenoms && CPrivateSend::IsDenominatedAmount(out.nValue);
+    }
 
-        // bounds check
-        if (nout >= wtx->tx->vout.size()) {
-            // should never actually hit this
-            LogPrint("privatesend", "GetRealOutpointPrivateSendRounds UPDATED   %s %3d %3d\n", hash.ToString(), nout, -4);
-            return -4;
-        }
+    // this one is denominated but there is another non-denominated output found in the same tx
+    if (!fAllDenoms) {
+        nRoundsRet = 0;
+        return true;
+    }
 
-        if (CPrivateSend::IsCollateralAmount(wtx->tx->vout[nout].nValue)) {
-            mDenomWtxes[hash].vout[nout].nRounds = -3;
-            LogPrint("privatesend", "GetRealOutpointPrivateSendRounds UPDATED   %s %3d %3d\n", hash.ToString(), nout, mDenomWtxes[hash].vout[nout].nRounds);
-            return mDenomWtxes[hash].vout[nout].nRounds;
+    int nShortest = -10; // an initial value, should be no way to get this by calculations
+    bool fDenomFound = false;
+    bool fMissing = false;
+    // only denoms here so let's look up, IsMine implies that the input's transaction is in the wallet
+    for (const auto& txinNext : wtx->tx->vin) {
+        if (!IsMine(txinNext)) continue;
+        std::map<COutPoint, int>::const_iterator it = mapOutpointPrivateSendRounds.find(txinNext.prevout);
+        if (it == mapOutpointPrivateSendRounds.end()) {
+            vecMissing.push_back(txinNext.prevout);
+            fMissing = true;
+            continue;
         }
-
-        //make sure the final output is non-denominate
-        if (!CPrivateSend::IsDenominatedAmount(wtx->tx->vout[nout].nValue)) { //NOT DENOM
-            mDenomWtxes[hash].vout[nout].nRounds = -2;
-            LogPrint("privatesend", "GetRealOutpointPrivateSendRounds UPDATED   %s %3d %3d\n", hash.ToString(), nout, mDenomWtxes[hash].vout[nout].nRounds);
-            return mDenomWtxes[hash].vout[nout].nRounds;
+        int n = it->second;
+        // denom found, find the shortest chain or initially assign nShortest with the first found value
+        if (n >= 0 && (n < nShortest || nShortest == -10)) {
+            nShortest = n;
+            fDenomFound = true;
         }
+    }
+    if (fMissing) {
+        return false;
+    }
 
-        bool fAllDenoms = true;
-        for (const auto& out : wtx->tx->vout) {
-            fAllDenoms = fAllDenoms && CPrivateSend::IsDenominatedAmount(out.nValue);
-        }
+    nRoundsRet = fDenomFound
+            ? (nShortest >= MAX_PRIVATESEND_ROUNDS - 1 ? MAX_PRIVATESEND_ROUNDS : nShortest + 1) // good, we a +1 to the shortest one but only MAX_PRIVATESEND_ROUNDS rounds max allowed
+            : 0;            // too bad, we are the fist one in that chain
+    return true;
+}
+
+// Determine the rounds of a given input (How deep is the PrivateSend chain for a given input). Ancestors are
+// walked depth first with an explicit stack, every outpoint on the way is computed once and memoized.
+int CWallet::GetRealOutpointPrivateSendRounds(const COutPoint& outpoint) const
+{
+    LOCK(cs_wallet);
+
+    std::map<COutPoint, int>::const_iterator it = mapOutpointPrivateSendRounds.find(outpoint);
+    if (it != mapOutpointPrivateSendRounds.end()) {
+        return it->second;
+    }
+    if (!mapWallet.count(outpoint.hash)) {
+        return -1;
+    }
 
-        // this one is denominated but there is another non-denominated output found in the same tx
-        if (!fAllDenoms) {
-            mDenomWtxes[hash].vout[nout].nRounds = 0;
-            LogPrint("privatesend", "GetRealOutpointPrivateSendRounds UPDATED   %s %3d %3d\n", hash.ToString(), nout, mDenomWtxes[hash].vout[nout].nRounds);
-            return mDenomWtxes[hash].vout[nout].nRounds;
+    std::vector<COutPoint> vecStack(1, outpoint);
+    while (!vecStack.empty()) {
+        const COutPoint current = vecStack.back();
+        // outpoints with several spenders on the stack may have been computed meanwhile
+        if (mapOutpointPrivateSendRounds.count(current)) {
+            vecStack.pop_back();
+            continue;
         }
+        int nRounds;
+        if (!ComputeOutpointPrivateSendRounds(current, vecStack, nRounds)) {
+            // its inputs were pushed, come back once they are done
+            continue;
+        }
+        vecStack.pop_back();
+        mapOutpointPrivateSendRounds.emplace(current, nRounds);
+        LogPrint("privatesend", "GetRealOutpointPrivateSendRounds UPDATED   %s %3d %3d\n", current.hash.ToString(), current.n, nRounds);
+    }
 
-        int nShortest = -10; // an initial value, should be no way to get this by calculations
-        bool fDenomFound = false;
-        // only denoms here so let's look up
-        for (const auto& txinNext : wtx->tx->vin) {
-            if (IsMine(txinNext)) {
-                int n = GetRealOutpointPrivateSendRounds(txinNext.prevout, nRounds + 1);
-                // denom found, find the shortest chain or initially assign nShortest with the first found value
-                if(n >= 0 && (n < nShortest || nShortest == -10)) {
-                    nShortest = n;
-                    fDenomFound = true;
-                }
+    return mapOutpointPrivateSendRounds.at(outpoint);
+}
+
+void CWallet::InvalidatePrivateSendRounds(const uint256& hashTx)
+{
+    AssertLockHeld(cs_wallet);
+
+    if (mapOutpointPrivateSendRounds.empty()) {
+        return;
+    }
+
+    std::vector<uint256> vecToVisit(1, hashTx);
+    std::set<uint256> setVisited;
+    while (!vecToVisit.empty()) {
+        uint256 hash = vecToVisit.back();
+        vecToVisit.pop_back();
+        if (!setVisited.insert(hash).second) continue;
+
+        std::map<uint256, CWalletTx>::const_iterator mi = mapWallet.find(hash);
+        if (mi == mapWallet.end()) continue;
+        for (unsigned int i = 0; i < mi->second.tx->vout.size(); i++) {
+            COutPoint outpoint(hash, i);
+            mapOutpointPrivateSendRounds.erase(outpoint);
+            std::pair<TxSpends::const_iterator, TxSpends::const_iterator> range = mapTxSpends.equal_range(outpoint);
+            for (TxSpends::const_iterator itSpend = range.first; itSpend != range.second; ++itSpend) {
+                vecToVisit.push_back(itSpend->second);
             }
         }
-        mDenomWtxes[hash].vout[nout].nRounds = fDenomFound
-                ? (nShortest >= MAX_PRIVATESEND_ROUNDS - 1 ? MAX_PRIVATESEND_ROUNDS : nShortest + 1) // good, we a +1 to the shortest one but only MAX_PRIVATESEND_ROUNDS rounds max allowed
-                : 0;            // too bad, we are the fist one in that chain
-        LogPrint("privatesend", "GetRealOutpointPrivateSendRounds UPDATED   %s %3d %3d\n", hash.ToString(), nout, mDenomWtxes[hash].vout[nout].nRounds);
-        return mDenomWtxes[hash].vout[nout].nRounds;
     }
+}
+
+void CWallet::LoadPrivateSendRounds(int64_t nOrderPosNextWritten, const std::map<COutPoint, int>& mapRounds)
+{
+    LOCK(cs_wallet);
+    mapOutpointPrivateSendRounds = mapRounds;
+    nPrivateSendRoundsOrderPos = nOrderPosNextWritten;
+}
 
-    return nRounds - 1;
+void CWallet::ClearPrivateSendRounds()
+{
+    LOCK(cs_wallet);
+    mapOutpointPrivateSendRounds.clear();
 }
 
 // respect current settings
@@ -1948,22 +2157,149 @@ void CWalletTx::GetAccountAmounts(const std::string& strAccount, CAmount& nRecei
     }
 }
 
+/**
+ * Cheap check whether a transaction might concern the wallet, run on the rescan threads so that
+ * only few transactions have to go through AddToWalletIfInvolvingMe under cs_main and cs_wallet.
+ * Never misses a transaction AddToWalletIfInvolvingMe would add, but may match others.
+ */
+class CWalletScanFilter
+{
+private:
+    struct IdHasher
+    {
+        size_t operator()(const uint160& id) const { return ReadLE64(id.begin()); }
+    };
+
+    // key and script ids we have keys or redeem scripts for
+    std::unordered_set<uint160, IdHasher> setIds;
+    std::set<CScript> setWatchOnly;
+    // wallet transactions and the transactions they spend, to find spends and conflicts
+    std::unordered_set<uint256, SaltedTxidHasher> setTxids;
+    size_t nKeys;
+
+    static size_t GetKeyCount(const CWallet& wallet)
+    {
+        std::set<CKeyID> setKeys;
+        wallet.GetKeys(setKeys);
+        LOCK(wallet.cs_KeyStore);
+        return setKeys.size() + wallet.mapHdPubKeys.size() + wallet.mapScripts.size() + wallet.setWatchOnly.size();
+    }
+
+    bool MatchesOutput(const CScript& scriptPubKey) const
+    {
+        if (!setWatchOnly.empty() && setWatchOnly.count(scriptPubKey))
+            return true;
+        txnouttype whichType;
+        std::vector<std::vector<unsigned char> > vSolutions;
+        if (!Solver(scriptPubKey, whichType, vSolutions))
+            return false;
+        switch (whichType) {
+        case TX_PUBKEYHASH:
+        case TX_SCRIPTHASH:
+            return setIds.count(uint160(vSolutions[0])) != 0;
+        case TX_PUBKEY:
+            return setIds.count(CPubKey(vSolutions[0]).GetID()) != 0;
+        case TX_MULTISIG:
+            // first and last solutions are the number of required and total keys
+            for (size_t i = 1; i + 1 < vSolutions.size(); i++) {
+                if (setIds.count(CPubKey(vSolutions[i]).GetID()))
+                    return true;
+            }
+            return false;
+        default:
+            return false;
+        }
+    }
+
+public:
+    CWalletScanFilter() : nKeys(0) {}
+
+    /** Collects keys, scripts and transactions of the wallet, requires cs_wallet */
+    void Update(const CWallet& wallet)
+    {
+        AssertLockHeld(wallet.cs_wallet);
+
+        std::set<CKeyID> setKeys;
+        wallet.GetKeys(setKeys);
+        setIds.clear();
+        setIds.insert(setKeys.begin(), setKeys.end());
+        for (const auto& pair : wallet.mapHdPubKeys)
+            setIds.insert(pair.first);
+        {
+            LOCK(wallet.cs_KeyStore);
+            for (const auto& pair : wallet.mapScripts)
+                setIds.insert(pair.first);
+            setWatchOnly = wallet.setWatchOnly;
+        }
+        nKeys = GetKeyCount(wallet);
+
+        setTxids.clear();
+        for (const auto& pair : wallet.mapWallet) {
+            AddTx(*pair.second.tx);
+        }
+    }
+
+    /** Keys might be added while the wallet is updated (e.g. when the keypool is topped up) */
+    bool IsOutdated(const CWallet& wallet) const
+    {
+        return GetKeyCount(wallet) != nKeys;
+    }
+
+    /** Make spends of the given transaction's outputs and conflicts with its inputs match */
+    void AddTx(const CTransaction& tx)
+    {
+        setTxids.insert(tx.GetHash());
+        for (const CTxIn& txin : tx.vin)
+            setTxids.insert(txin.prevout.hash);
+    }
+
+    bool Matches(const CTransaction& tx) const
+    {
+        if (setTxids.count(tx.GetHash()))
+            return true;
+        for (const CTxIn& txin : tx.vin) {
+            if (setTxids.count(txin.prevout.hash))
+                return true;
+        }
+        for (const CTxOut& txout : tx.vout) {
+            if (MatchesOutput(txout.scriptPubKey))
+                return true;
+        }
+        return false;
+    }
+};
+
 /**
  * Scan the block chain (starting in pindexStart) for transactions
  * from or to us. If fUpdate is true, found transactions that already
  * exist in the wallet will be updated.
  *
+ * Blocks are read from disk and run through CWalletScanFilter on a thread pool,
+ * RESCAN_CHUNK_SIZE at a time. Only the transactions which passed the filter are
+ * then handed to AddToWalletIfInvolvingMe, cs_main and cs_wallet are only held for that step.
+ *
  * Returns pointer to the first block in the last contiguous range that was
  * successfully scanned.
- *
  */
 CBlockIndex* CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate)
 {
+    struct ScannedBlock
+    {
+        CBlock block;
+        bool fRead;
+        std::vector<size_t> vMatches;
+    };
+
     CBlockIndex* ret = nullptr;
     int64_t nNow = GetTime();
+    int64_t nTimeStart = GetTimeMillis();
+    int nBlocksScanned = 0;
     const CChainParams& chainParams = Params();
 
     CBlockIndex* pindex = pindexStart;
+    double dProgressStart;
+    double dProgressTip;
+    CWalletScanFilter filter;
     {
         LOCK2(cs_main, cs_wallet);
 
@@ -1973,31 +2309,114 @@ CBlockIndex* CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool f
             pindex = chainActive.Next(pindex);
 
         ShowProgress(_("Rescanning..."), 0); // show rescan progress in GUI as dialog or on splashscreen, if -rescan on startup
-        double dProgressStart = GuessVerificationProgress(chainParams.TxData(), pindex);
-        double dProgressTip = GuessVerificationProgress(chainParams.TxData(), chainActive.Tip());
-        while (pindex)
+        dProgressStart = GuessVerificationProgress(chainParams.TxData(), pindex);
+        dProgressTip = GuessVerificationProgress(chainParams.TxData(), chainActive.Tip());
+        filter.Update(*this);
+    }
+
+    int nThreads = std::max(1, std::min(GetNumCores(), MAX_RESCAN_THREADS));
+    ctpl::thread_pool workerPool(nThreads);
+    RenameThreadPool(workerPool, "rescan");
+
+    std::vector<CBlockIndex*> vChunk;
+    std::vector<ScannedBlock> vScanned;
+    while (pindex)
+    {
         {
-            if (pindex->nHeight % 100 == 0 && dProgressTip - dProgressStart > 0.0)
-                ShowProgress(_("Rescanning..."), std::max(1, std::min(99, (int)((GuessVerificationProgress(chainParams.TxData(), pindex) - dProgressStart) / (dProgressTip - dProgressStart) * 100))));
-            if (GetTime() >= nNow + 60) {
-                nNow = GetTime();
-                LogPrintf("Still rescanning. At block %d. Progress=%f\n", pindex->nHeight, GuessVerificationProgress(chainParams.TxData(), pindex));
-            }
+            LOCK(cs_main);
+            vChunk.clear();
+            for (CBlockIndex* pindexChunk = pindex; pindexChunk && vChunk.size() < (size_t)RESCAN_CHUNK_SIZE; pindexChunk = chainActive.Next(pindexChunk))
+                vChunk.push_back(pindexChunk);
+        }
+
+        // read and filter without holding any lock
+        vScanned.clear();
+        vScanned.resize(vChunk.size());
+        std::vector<std::future<void> > vFutures;
+        vFutures.reserve(vChunk.size());
+        for (size_t i = 0; i < vChunk.size(); i++) {
+            vFutures.emplace_back(workerPool.push([&, i](int) {
+                ScannedBlock& scanned = vScanned[i];
+                scanned.fRead = ReadBlockFromDisk(scanned.block, vChunk[i], chainParams.GetConsensus());
+                if (!scanned.fRead)
+                    return;
+                for (size_t posInBlock = 0; posInBlock < scanned.block.vtx.size(); ++posInBlock) {
+                    if (filter.Matches(*scanned.block.vtx[posInBlock]))
+                        scanned.vMatches.push_back(posInBlock);
+                }
+            }));
+        }
+        for (auto& future : vFutures)
+            future.get();
 
-            CBlock block;
-            if (ReadBlockFromDisk(block, pindex, Params().GetConsensus())) {
-                for (size_t posInBlock = 0; posInBlock < block.vtx.size(); ++posInBlock) {
-                    AddToWalletIfInvolvingMe(*block.vtx[posInBlock], pindex, posInBlock, fUpdate);
+        LOCK2(cs_main, cs_wallet);
+        // transactions added from this chunk, spends of them don't match the filter yet
+        std::unordered_set<uint256, SaltedTxidHasher> setAdded;
+        pindex = nullptr;
+        for (size_t i = 0; i < vChunk.size(); i++) {
+            if (!chainActive.Contains(vChunk[i])) {
+                // reorganized while we were reading, continue on the new chain
+                const CBlockIndex* pindexFork = chainActive.FindFork(vChunk[i]);
+                pindex = pindexFork ? chainActive.Next(pindexFork) : chainActive.Genesis();
+                break;
+            }
+            const ScannedBlock& scanned = vScanned[i];
+            if (!scanned.fRead) {
+                ret = nullptr;
+                continue;
+            }
+            size_t nMatch = 0;
+            for (size_t posInBlock = 0; posInBlock < scanned.block.vtx.size(); ++posInBlock) {
+                const CTransaction& tx = *scanned.block.vtx[posInBlock];
+                bool fMatch = nMatch < scanned.vMatches.size() && scanned.vMatches[nMatch] == posInBlock;
+                if (fMatch) {
+                    nMatch++;
+                } else if (!setAdded.empty()) {
+                    for (const CTxIn& txin : tx.vin) {
+                        if (setAdded.count(txin.prevout.hash)) {
+                            fMatch = true;
+                            break;
+                        }
+                    }
                 }
-                if (!ret) {
-                    ret = pindex;
+                if (fMatch && AddToWalletIfInvolvingMe(tx, vChunk[i], posInBlock, fUpdate)) {
+                    setAdded.insert(tx.GetHash());
+                    for (const CTxIn& txin : tx.vin)
+                        setAdded.insert(txin.prevout.hash);
+                    filter.AddTx(tx);
                 }
-            } else {
-                ret = nullptr;
             }
-            pindex = chainActive.Next(pindex);
+            if (!ret) {
+                ret = vChunk[i];
+            }
+            nBlocksScanned++;
+            if (i + 1 == vChunk.size())
+                pindex = chainActive.Next(vChunk[i]);
+        }
+
+        if (pindex) {
+            if (dProgressTip - dProgressStart > 0.0)
+                ShowProgress(_("Rescanning..."), std::max(1, std::min(99, (int)((GuessVerificationProgress(chainParams.TxData(), pindex) - dProgressStart) / (dProgressTip - dProgressStart) * 100))));
+            if (GetTime() >= nNow + 60) {
+                nNow = GetTime();
+                LogPrintf("Still rescanning. At block %d. Progress=%f, %.2f blocks/s\n", pindex->nHeight, GuessVerificationProgress(chainParams.TxData(), pindex),
+                          nBlocksScanned * 1000.0 / std::max((int64_t)1, GetTimeMillis() - nTimeStart));
+            }
         }
-        ShowProgress(_("Rescanning..."), 100); // hide progress dialog in GUI
+        if (filter.IsOutdated(*this))
+            filter.Update(*this);
+    }
+    ShowProgress(_("Rescanning..."), 100); // hide progress dialog in GUI
+
+    int64_t nDuration = std::max((int64_t)1, GetTimeMillis() - nTimeStart);
+    LogPrintf("Rescanned %d blocks in %dms (%.2f blocks/s) using %d threads\n", nBlocksScanned, nDuration, nBlocksScanned * 1000.0 / nDuration, nThreads);
+
+    {
+        LOCK(cs_wallet);
+        // AddToWalletIfInvolvingMe doesn't maintain the stake candidates, rebuild them on next use
+        fStakeCandidatesInitialized = false;
+        // keys imported before the rescan may have made inputs of known transactions ours
+        mapOutpointPrivateSendRounds.clear();
     }
     return ret;
 }
@@ -2083,25 +2502,23 @@ CAmount CWalletTx::GetDebit(const isminefilter& filter) const
     CAmount debit = 0;
     if(filter & ISMINE_SPENDABLE)
     {
-        if (fDebitCached)
-            debit += nDebitCached;
-        else
+        CAmount nDebit;
+        if (!amountCache.Get(CWalletTxAmountCache::DEBIT, nDebit))
         {
-            nDebitCached = pwallet->GetDebit(*this, ISMINE_SPENDABLE);
-            fDebitCached = true;
-            debit += nDebitCached;
+            nDebit = pwallet->GetDebit(*this, ISMINE_SPENDABLE);
+            amountCache.Set(CWalletTxAmountCache::DEBIT, nDebit);
         }
+        debit += nDebit;
     }
     if(filter & ISMINE_WATCH_ONLY)
     {
-        if(fWatchDebitCached)
-            debit += nWatchDebitCached;
-        else
+        CAmount nWatchDebit;
+        if (!amountCache.Get(CWalletTxAmountCache::WATCH_DEBIT, nWatchDebit))
         {
-            nWatchDebitCached = pwallet->GetDebit(*this, ISMINE_WATCH_ONLY);
-            fWatchDebitCached = true;
-            debit += nWatchDebitCached;
+            nWatchDebit = pwallet->GetDebit(*this, ISMINE_WATCH_ONLY);
+            amountCache.Set(CWalletTxAmountCache::WATCH_DEBIT, nWatchDebit);
         }
+        debit += nWatchDebit;
     }
     return debit;
 }
@@ -2116,25 +2533,23 @@ CAmount CWalletTx::GetCredit(const isminefilter& filter) const
     if (filter & ISMINE_SPENDABLE)
     {
         // GetBalance can assume transactions in mapWallet won't change
-        if (fCreditCached)
-            credit += nCreditCached;
-        else
+        CAmount nCredit;
+        if (!amountCache.Get(CWalletTxAmountCache::CREDIT, nCredit))
         {
-            nCreditCached = pwallet->GetCredit(*this, ISMINE_SPENDABLE);
-            fCreditCached = true;
-            credit += nCreditCached;
+            nCredit = pwallet->GetCredit(*this, ISMINE_SPENDABLE);
+            amountCache.Set(CWalletTxAmountCache::CREDIT, nCredit);
         }
+        credit += nCredit;
     }
     if (filter & ISMINE_WATCH_ONLY)
     {
-        if (fWatchCreditCached)
-            credit += nWatchCreditCached;
-        else
+        CAmount nWatchCredit;
+        if (!amountCache.Get(CWalletTxAmountCache::WATCH_CREDIT, nWatchCredit))
         {
-            nWatchCreditCached = pwallet->GetCredit(*this, ISMINE_WATCH_ONLY);
-            fWatchCreditCached = true;
-            credit += nWatchCreditCached;
+            nWatchCredit = pwallet->GetCredit(*this, ISMINE_WATCH_ONLY);
+            amountCache.Set(CWalletTxAmountCache::WATCH_CREDIT, nWatchCredit);
         }
+        credit += nWatchCredit;
     }
     return credit;
 }
@@ -2143,11 +2558,12 @@ CAmount CWalletTx::GetImmatureCredit(bool fUseCache) const
 {
     if (IsCoinBase() && GetBlocksToMaturity() > 0 && IsInMainChain())
     {
-        if (fUseCache && fImmatureCreditCached)
-            return nImmatureCreditCached;
-        nImmatureCreditCached = pwallet->GetCredit(*this, ISMINE_SPENDABLE);
-        fImmatureCreditCached = true;
-        return nImmatureCreditCached;
+        CAmount nCredit;
+        if (fUseCache && amountCache.Get(CWalletTxAmountCache::IMMATURE_CREDIT, nCredit))
+            return nCredit;
+        nCredit = pwallet->GetCredit(*this, ISMINE_SPENDABLE);
+        amountCache.Set(CWalletTxAmountCache::IMMATURE_CREDIT, nCredit);
+        return nCredit;
     }
 
     return 0;
@@ -2162,10 +2578,10 @@ CAmount CWalletTx::GetAvailableCredit(bool fUseCache) const
     if (IsCoinBase() && GetBlocksToMaturity() > 0)
         return 0;
 
-    if (fUseCache && fAvailableCreditCached)
-        return nAvailableCreditCached;
-
     CAmount nCredit = 0;
+    if (fUseCache && amountCache.Get(CWalletTxAmountCache::AVAILABLE_CREDIT, nCredit))
+        return nCredit;
+
     uint256 hashTx = GetHash();
     for (unsigned int i = 0; i < tx->vout.size(); i++)
     {
@@ -2178,8 +2594,7 @@ CAmount CWalletTx::GetAvailableCredit(bool fUseCache) const
         }
     }
 
-    nAvailableCreditCached = nCredit;
-    fAvailableCreditCached = true;
+    amountCache.Set(CWalletTxAmountCache::AVAILABLE_CREDIT, nCredit);
     return nCredit;
 }
 
@@ -2187,11 +2602,12 @@ CAmount CWalletTx::GetImmatureWatchOnlyCredit(const bool& fUseCache) const
 {
     if (IsCoinBase() && GetBlocksToMaturity() > 0 && IsInMainChain())
     {
-        if (fUseCache && fImmatureWatchCreditCached)
-            return nImmatureWatchCreditCached;
-        nImmatureWatchCreditCached = pwallet->GetCredit(*this, ISMINE_WATCH_ONLY);
-        fImmatureWatchCreditCached = true;
-        return nImmatureWatchCreditCached;
+        CAmount nCredit;
+        if (fUseCache && amountCache.Get(CWalletTxAmountCache::IMMATURE_WATCH_CREDIT, nCredit))
+            return nCredit;
+        nCredit = pwallet->GetCredit(*this, ISMINE_WATCH_ONLY);
+        amountCache.Set(CWalletTxAmountCache::IMMATURE_WATCH_CREDIT, nCredit);
+        return nCredit;
     }
 
     return 0;
@@ -2206,10 +2622,10 @@ CAmount CWalletTx::GetAvailableWatchOnlyCredit(const bool& fUseCache) const
     if (IsCoinBase() && GetBlocksToMaturity() > 0)
         return 0;
 
-    if (fUseCache && fAvailableWatchCreditCached)
-        return nAvailableWatchCreditCached;
-
     CAmount nCredit = 0;
+    if (fUseCache && amountCache.Get(CWalletTxAmountCache::AVAILABLE_WATCH_CREDIT, nCredit))
+        return nCredit;
+
     for (unsigned int i = 0; i < tx->vout.size(); i++)
     {
         if (!pwallet->IsSpent(GetHash(), i))
@@ -2221,8 +2637,7 @@ CAmount CWalletTx::GetAvailableWatchOnlyCredit(const bool& fUseCache) const
         }
     }
 
-    nAvailableWatchCreditCached = nCredit;
-    fAvailableWatchCreditCached = true;
+    amountCache.Set(CWalletTxAmountCache::AVAILABLE_WATCH_CREDIT, nCredit);
     return nCredit;
 }
 
@@ -2235,10 +2650,10 @@ CAmount CWalletTx::GetAnonymizedCredit(bool fUseCache) const
     if (IsCoinBase() && GetBlocksToMaturity() > 0)
         return 0;
 
-    if (fUseCache && fAnonymizedCreditCached)
-        return nAnonymizedCreditCached;
-
     CAmount nCredit = 0;
+    if (fUseCache && amountCache.Get(CWalletTxAmountCache::ANONYMIZED_CREDIT, nCredit))
+        return nCredit;
+
     uint256 hashTx = GetHash();
     for (unsigned int i = 0; i < tx->vout.size(); i++)
     {
@@ -2255,8 +2670,7 @@ CAmount CWalletTx::GetAnonymizedCredit(bool fUseCache) const
         }
     }
 
-    nAnonymizedCreditCached = nCredit;
-    fAnonymizedCreditCached = true;
+    amountCache.Set(CWalletTxAmountCache::ANONYMIZED_CREDIT, nCredit);
     return nCredit;
 }
 
@@ -2275,14 +2689,11 @@ CAmount CWalletTx::GetDenominatedCredit(bool unconfirmed, bool fUseCache) const
     bool isUnconfirmed = IsTrusted() && nDepth == 0;
     if(unconfirmed != isUnconfirmed) return 0;
 
-    if (fUseCache) {
-        if(unconfirmed && fDenomUnconfCreditCached)
-            return nDenomUnconfCreditCached;
-        else if (!unconfirmed && fDenomConfCreditCached)
-            return nDenomConfCreditCached;
-    }
-
+    CWalletTxAmountCache::AmountType amountType = unconfirmed ? CWalletTxAmountCache::DENOM_UNCONF_CREDIT : CWalletTxAmountCache::DENOM_CONF_CREDIT;
     CAmount nCredit = 0;
+    if (fUseCache && amountCache.Get(amountType, nCredit))
+        return nCredit;
+
     uint256 hashTx = GetHash();
     for (unsigned int i = 0; i < tx->vout.size(); i++)
     {
@@ -2295,23 +2706,25 @@ CAmount CWalletTx::GetDenominatedCredit(bool unconfirmed, bool fUseCache) const
             throw std::runtime_error(std::string(__func__) + ": value out of range");
     }
 
-    if(unconfirmed) {
-        nDenomUnconfCreditCached = nCredit;
-        fDenomUnconfCreditCached = true;
-    } else {
-        nDenomConfCreditCached = nCredit;
-        fDenomConfCreditCached = true;
-    }
+    amountCache.Set(amountType, nCredit);
     return nCredit;
 }
 
 CAmount CWalletTx::GetChange() const
 {
-    if (fChangeCached)
-        return nChangeCached;
-    nChangeCached = pwallet->GetChange(*this);
-    fChangeCached = true;
-    return nChangeCached;
+    CAmount nChange;
+    if (amountCache.Get(CWalletTxAmountCache::CHANGE, nChange))
+        return nChange;
+    nChange = pwallet->GetChange(*this);
+    amountCache.Set(CWalletTxAmountCache::CHANGE, nChange);
+    return nChange;
+}
+
+size_t CWalletTx::DynamicMemoryUsage() const
+{
+    size_t nUsage = memusage::DynamicUsage(tx) + RecursiveDynamicUsage(*tx);
+    nUsage += memusage::DynamicUsage(mapValue) + memusage::DynamicUsage(vOrderForm);
+    return nUsage + amountCache.DynamicMemoryUsage();
 }
 
 bool CWalletTx::InMempool() const
@@ -2428,9 +2841,8 @@ CAmount CWallet::GetBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        for (const CWalletTx* pcoin : GetWalletUTXOTxes())
         {
-            const CWalletTx* pcoin = &(*it).second;
             if (pcoin->IsTrusted())
                 nTotal += pcoin->GetAvailableCredit();
         }
@@ -2446,9 +2858,8 @@ CAmount CWallet::GetStake() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        for (const CWalletTx* pcoin : GetWalletUTXOTxes())
         {
-            const CWalletTx* pcoin = &(*it).second;
             auto nStakeMinAge = CurrentMinStakeAge(pcoin->GetTxTime());
             if (pcoin->IsTrusted() && GetTime() - pcoin->GetTxTime() > nStakeMinAge && pcoin->GetBlocksToMaturity() < (pcoin->tx->IsCoinStake() ? COINBASE_MATURITY : 10))
                 nTotal += pcoin->GetAvailableCredit();
@@ -2461,9 +2872,8 @@ CAmount CWallet::GetStake() const
 
 int CWallet::GetStakeInputs() const
 {
-    static StakeCoinsSet setStakeCoins;
-    int StakeInputs = (int) setStakeCoins.size();
-    return StakeInputs;
+    LOCK(cs_wallet);
+    return (int) mapStakeCandidates.size();
 }
 
 
@@ -2497,16 +2907,10 @@ CAmount CWallet::GetAnonymizedBalance() const
 
     LOCK2(cs_main, cs_wallet);
 
-    std::set<uint256> setWalletTxesCounted;
-    for (const auto& outpoint : setWalletUTXO) {
-
-        if (setWalletTxesCounted.find(outpoint.hash) != setWalletTxesCounted.end()) continue;
-        setWalletTxesCounted.insert(outpoint.hash);
-
-        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.find(outpoint.hash); it != mapWallet.end() && it->first == outpoint.hash; ++it) {
-            if (it->second.IsTrusted())
-                nTotal += it->second.GetAnonymizedCredit();
-        }
+    // only denominated outputs can be anonymized
+    for (const CWalletTx* pcoin : GetDenominatedUTXOTxes()) {
+        if (pcoin->IsTrusted())
+            nTotal += pcoin->GetAnonymizedCredit();
     }
 
     return nTotal;
@@ -2522,11 +2926,11 @@ float CWallet::GetAverageAnonymizedRounds() const
     int nCount = 0;
 
     LOCK2(cs_main, cs_wallet);
-    for (const auto& outpoint : setWalletUTXO) {
-        if(!IsDenominated(outpoint)) continue;
-
-        nTotal += GetCappedOutpointPrivateSendRounds(outpoint);
-        nCount++;
+    for (const auto& bucket : mapDenominatedUTXO) {
+        for (const auto& outpoint : bucket.second) {
+            nTotal += GetCappedOutpointPrivateSendRounds(outpoint);
+            nCount++;
+        }
     }
 
     if(nCount == 0) return 0;
@@ -2543,14 +2947,15 @@ CAmount CWallet::GetNormalizedAnonymizedBalance() const
     CAmount nTotal = 0;
 
     LOCK2(cs_main, cs_wallet);
-    for (const auto& outpoint : setWalletUTXO) {
-        std::map<uint256, CWalletTx>::const_iterator it = mapWallet.find(outpoint.hash);
-        if (it == mapWallet.end()) continue;
-        if (!IsDenominated(outpoint)) continue;
-        if (it->second.GetDepthInMainChain() < 0) continue;
+    for (const auto& bucket : mapDenominatedUTXO) {
+        for (const auto& outpoint : bucket.second) {
+            std::map<uint256, CWalletTx>::const_iterator it = mapWallet.find(outpoint.hash);
+            if (it == mapWallet.end()) continue;
+            if (it->second.GetDepthInMainChain() < 0) continue;
 
-        int nRounds = GetCappedOutpointPrivateSendRounds(outpoint);
-        nTotal += it->second.tx->vout[outpoint.n].nValue * nRounds / privateSendClient.nPrivateSendRounds;
+            int nRounds = GetCappedOutpointPrivateSendRounds(outpoint);
+            nTotal += bucket.first * nRounds / privateSendClient.nPrivateSendRounds;
+        }
     }
 
     return nTotal;
@@ -2587,10 +2992,8 @@ CAmount CWallet::GetDenominatedBalance(bool unconfirmed) const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        for (const CWalletTx* pcoin : GetDenominatedUTXOTxes())
         {
-            const CWalletTx* pcoin = &(*it).second;
-
             nTotal += pcoin->GetDenominatedCredit(unconfirmed);
         }
     }
@@ -2603,9 +3006,8 @@ CAmount CWallet::GetUnconfirmedBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        for (const CWalletTx* pcoin : GetWalletUTXOTxes())
         {
-            const CWalletTx* pcoin = &(*it).second;
             if (!pcoin->IsTrusted() && pcoin->GetDepthInMainChain() == 0 && !pcoin->IsLockedByInstantSend() && pcoin->InMempool())
                 nTotal += pcoin->GetAvailableCredit();
         }
@@ -2618,9 +3020,8 @@ CAmount CWallet::GetImmatureBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        for (const CWalletTx* pcoin : GetWalletUTXOTxes())
         {
-            const CWalletTx* pcoin = &(*it).second;
             nTotal += pcoin->GetImmatureCredit();
         }
     }
@@ -2632,9 +3033,8 @@ CAmount CWallet::GetWatchOnlyBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        for (const CWalletTx* pcoin : GetWalletUTXOTxes())
         {
-            const CWalletTx* pcoin = &(*it).second;
             if (pcoin->IsTrusted())
                 nTotal += pcoin->GetAvailableWatchOnlyCredit();
         }
@@ -2648,9 +3048,8 @@ CAmount CWallet::GetUnconfirmedWatchOnlyBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        for (const CWalletTx* pcoin : GetWalletUTXOTxes())
         {
-            const CWalletTx* pcoin = &(*it).second;
             if (!pcoin->IsTrusted() && pcoin->GetDepthInMainChain() == 0 && !pcoin->IsLockedByInstantSend() && pcoin->InMempool())
                 nTotal += pcoin->GetAvailableWatchOnlyCredit();
         }
@@ -2663,9 +3062,8 @@ CAmount CWallet::GetImmatureWatchOnlyBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        for (const CWalletTx* pcoin : GetWalletUTXOTxes())
         {
-            const CWalletTx* pcoin = &(*it).second;
             nTotal += pcoin->GetImmatureWatchOnlyCredit();
         }
     }
@@ -2674,16 +3072,26 @@ CAmount CWallet::GetImmatureWatchOnlyBalance() const
 
 void CWallet::AvailableCoins(std::vector<COutput>& vCoins, bool fOnlyConfirmed, const CCoinControl *coinControl, bool fIncludeZeroValue, AvailableCoinsType nCoinType, bool fUseInstantSend) const
 {
+    LOCK2(cs_main, cs_wallet);
+    // denominated outputs are indexed separately, no need to look at all the others
+    AvailableCoinsFromTxes(nCoinType == ONLY_DENOMINATED ? GetDenominatedUTXOTxes() : GetWalletUTXOTxes(),
+                           vCoins, fOnlyConfirmed, coinControl, fIncludeZeroValue, nCoinType, fUseInstantSend);
+}
+
+void CWallet::AvailableCoinsFromTxes(const std::vector<const CWalletTx*>& vecTxes, std::vector<COutput>& vCoins, bool fOnlyConfirmed, const CCoinControl *coinControl,
+                                     bool fIncludeZeroValue, AvailableCoinsType nCoinType, bool fUseInstantSend) const
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
+
     vCoins.clear();
 
     {
-        LOCK2(cs_main, cs_wallet);
         int nInstantSendConfirmationsRequired = Params().GetConsensus().nInstantSendConfirmationsRequired;
 
-        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        for (const CWalletTx* pcoin : vecTxes)
         {
-            const uint256& wtxid = it->first;
-            const CWalletTx* pcoin = &(*it).second;
+            const uint256& wtxid = pcoin->GetHash();
 
             if (!CheckFinalTx(*pcoin))
                 continue;
@@ -2727,9 +3135,9 @@ void CWallet::AvailableCoins(std::vector<COutput>& vCoins, bool fOnlyConfirmed,
 
                 isminetype mine = IsMine(pcoin->tx->vout[i]);
                 if (!(IsSpent(wtxid, i)) && mine != ISMINE_NO &&
-                    (!IsLockedCoin((*it).first, i) || nCoinType == ONLY_1000) &&
+                    (!IsLockedCoin(wtxid, i) || nCoinType == ONLY_1000) &&
                     (pcoin->tx->vout[i].nValue > 0 || fIncludeZeroValue) &&
-                    (!coinControl || !coinControl->HasSelected() || coinControl->fAllowOtherInputs || coinControl->IsSelected(COutPoint((*it).first, i))))
+                    (!coinControl || !coinControl->HasSelected() || coinControl->fAllowOtherInputs || coinControl->IsSelected(COutPoint(wtxid, i))))
                         vCoins.push_back(COutput(pcoin, i, nDepth,
                                                  ((mine & ISMINE_SPENDABLE) != ISMINE_NO) ||
                                                   (coinControl && coinControl->fAllowWatchOnly && (mine & ISMINE_WATCH_SOLVABLE) != ISMINE_NO),
@@ -2987,47 +3395,6 @@ bool CWallet::MintableCoins()
     }
     return false;
 }
-bool CWallet::SelectStakeCoins(StakeCoinsSet &setCoins, CAmount nTargetAmount, const CScript &scriptFilterPubKey) const
-{
-    std::vector<COutput> vCoins;
-    AvailableCoins(vCoins, scriptFilterPubKey.empty());
-    CAmount nAmountSelected = 0;
-    std::set<CScript> rejectCache;
-    for (const COutput& out : vCoins) {
-        //make sure not to outrun target amount
-        CScript scriptPubKeyKernel;
-        scriptPubKeyKernel = out.tx->tx->vout[out.i].scriptPubKey;
-        if(scriptPubKeyKernel.IsPayToScriptHash())
-            continue;
-        //     LogPrintf("scriptPubKeyKernel is good\n");
-        //for now we will comment this out
-        //        if (nAmountSelected + out.tx->vout[out.i].nValue > nTargetAmount)
-        //            continue;
-        //        LogPrintf("amount is good\n");
-        //check for min age
-        auto nStakeMinAge = CurrentMinStakeAge(out.tx->GetTxTime());
-        if (GetTime() - out.tx->GetTxTime() < nStakeMinAge)
-            continue;
-        //  LogPrintf("min age is good\n");
-        //check that it is matured
-        if (out.nDepth < (out.tx->tx->IsCoinStake() ? COINBASE_MATURITY : 10))
-            continue;
-        //  LogPrintf("maturity is good\n");
-        if (out.tx->tx->vout[out.i].nValue < nMinimumStakeValue)
-	    continue;
-        auto scriptPubKeyCoin = out.tx->tx->vout[out.i].scriptPubKey;
-        if(!scriptFilterPubKey.empty() && scriptPubKeyCoin != scriptFilterPubKey)
-            continue;
-        //   LogPrintf("filtering is good\n");
-        if(rejectCache.count(scriptPubKeyCoin))
-            continue;
-        //    LogPrintf("reject is good\n");
-        nAmountSelected += out.tx->tx->vout[out.i].nValue; //maybe change here for tpos
-        setCoins.insert(std::make_pair(out.tx, out.i));
-    }
-    return true;
-}
-
 bool CWallet::SelectCoins(const std::vector<COutput>& vAvailableCoins, const CAmount& nTargetValue, std::set<std::pair<const CWalletTx*,unsigned int> >& setCoinsRet, CAmount& nValueRet, const CCoinControl* coinControl, AvailableCoinsType nCoinType, bool fUseInstantSend) const
 {
     // Note: this function should never be used for "always free" tx types like dstx
@@ -3194,12 +3561,21 @@ bool CWallet::SelectPSInOutPairsByDenominations(int nDenom, CAmount nValueMin, C
         return false;
     }
 
-    AvailableCoins(vCoins, true, NULL, false, ONLY_DENOMINATED);
+    std::vector<CAmount> vecPrivateSendDenominations = CPrivateSend::GetStandardDenominations();
+    std::vector<CAmount> vecDenominations;
+    for (const auto& nBit : vecBits) {
+        vecDenominations.push_back(vecPrivateSendDenominations[nBit]);
+    }
+
+    {
+        LOCK2(cs_main, cs_wallet);
+        // only look at the buckets of the requested denominations
+        AvailableCoinsFromTxes(GetDenominatedUTXOTxes(vecDenominations), vCoins, true, NULL, false, ONLY_DENOMINATED, false);
+    }
     LogPrintf("CWallet::%s -- vCoins.size(): %d\n", __func__, vCoins.size());
 
     std::random_shuffle(vCoins.rbegin(), vCoins.rend(), GetRandInt);
 
-    std::vector<CAmount> vecPrivateSendDenominations = CPrivateSend::GetStandardDenominations();
     for (const auto& out : vCoins) {
         uint256 txHash = out.tx->GetHash();
         int nValue = out.tx->tx->vout[out.i].nValue;
@@ -3448,23 +3824,18 @@ int CWallet::CountInputsWithAmount(CAmount nInputAmount)
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-            if (pcoin->IsTrusted()){
-                int nDepth = pcoin->GetDepthInMainChain();
+        std::map<CAmount, std::set<COutPoint> >::const_iterator itBucket = mapDenominatedUTXO.find(nInputAmount);
+        if (itBucket == mapDenominatedUTXO.end())
+            return 0;
 
-                for (unsigned int i = 0; i < pcoin->tx->vout.size(); i++) {
-                    COutput out = COutput(pcoin, i, nDepth, true, true);
-                    COutPoint outpoint = COutPoint(out.tx->GetHash(), out.i);
+        for (const auto& outpoint : itBucket->second)
+        {
+            std::map<uint256, CWalletTx>::const_iterator it = mapWallet.find(outpoint.hash);
+            if (it == mapWallet.end() || !it->second.IsTrusted()) continue;
 
-                    if(out.tx->tx->vout[out.i].nValue != nInputAmount) continue;
-                    if(!CPrivateSend::IsDenominatedAmount(pcoin->tx->vout[i].nValue)) continue;
-                    if(IsSpent(out.tx->GetHash(), i) || IsMine(pcoin->tx->vout[i]) != ISMINE_SPENDABLE || !IsDenominated(outpoint)) continue;
+            if(IsSpent(outpoint.hash, outpoint.n) || IsMine(it->second.tx->vout[outpoint.n]) != ISMINE_SPENDABLE) continue;
 
-                    nTotal++;
-                }
-            }
+            nTotal++;
         }
     }
 
@@ -4058,82 +4429,160 @@ void CWallet::ListAccountCreditDebit(const std::string& strAccount, std::list<CA
     return walletdb.ListAccountCreditDebit(strAccount, entries);
 }
 
-bool CWallet::CreateCoinStake(unsigned int nBits,
-                              CAmount blockReward,
-                              CMutableTransaction &txNew,
-                              unsigned int &nTxNewTime,
-                              std::vector<CWalletTx*> &vwtxPrev)
+static int GetStakeMinDepth(const CWalletTx& wtx)
 {
-    // The following split & combine thresholds are important to security
-    // Should not be adjusted if you don't understand the consequences
-    //int64_t nCombineThreshold = 0;
-    CBlockIndex* pindexPrev = pindexBestHeader;
-    txNew.vin.clear();
-    txNew.vout.clear();
-    // Mark coin stake transaction
-    CScript scriptEmpty;
-    scriptEmpty.clear();
-    txNew.vout.emplace_back(CTxOut(0, scriptEmpty));
-    // Choose coins to use
-    CAmount nBalance = GetBalance();
-    //    if (mapArgs.count("-reservebalance") && !ParseMoney(mapArgs["-reservebalance"], nReserveBalance))
-    //        return error("CreateCoinStake : invalid reserve balance amount");
-    //    if (nBalance <= nReserveBalance)
-    //        return false;
-    //  presstab HyperStake - Initialize as static and don't update the set on every run of CreateCoinStake() in order to lighten resource use
-    static StakeCoinsSet setStakeCoins;
-    static int nLastStakeSetUpdate = 0;
-    if (GetTime() - nLastStakeSetUpdate > nStakeSetUpdateTime) {
-        setStakeCoins.clear();
-        CScript scriptPubKey;
-        if (!SelectStakeCoins(setStakeCoins, nBalance /*- nReserveBalance*/, scriptPubKey)) {
-            return error("Failed to select coins for staking");
-        }
-        LogPrintf("Selected %d coins for staking\n", setStakeCoins.size());
-        nLastStakeSetUpdate = GetTime();
-    }
-    if (setStakeCoins.empty())
-        return error("CreateCoinStake() : No Coins to stake");
-    //prevent staking a time that won't be accepted
-    if (GetAdjustedTime() <= chainActive.Tip()->nTime)
-        MilliSleep(10000);
-    bool fKernelFound = false;
-    CAmount nCredit = 0;
+    if (wtx.IsCoinBase())
+        return COINBASE_MATURITY + 1;
+    return wtx.tx->IsCoinStake() ? COINBASE_MATURITY : 10;
+}
 
-    for(const std::pair<const CWalletTx*, unsigned int> &pcoin : setStakeCoins)
-    {
-        //make sure that enough time has elapsed between
-        CBlockIndex* pindex = NULL;
-        BlockMap::iterator it = mapBlockIndex.find(pcoin.first->hashBlock);
-        if (it != mapBlockIndex.end())
-            pindex = it->second;
-        else {
+void CWallet::QueueStakeCoins(const CWalletTx& wtx)
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
+
+    BlockMap::iterator mi = mapBlockIndex.find(wtx.hashBlock);
+    if (mi == mapBlockIndex.end() || !chainActive.Contains(mi->second))
+        return;
+    int nHeightMature = mi->second->nHeight + GetStakeMinDepth(wtx) - 1;
+
+    for (unsigned int i = 0; i < wtx.tx->vout.size(); i++) {
+        const CTxOut& txout = wtx.tx->vout[i];
+        if (txout.nValue <= 0 || txout.nValue < nMinimumStakeValue || txout.scriptPubKey.IsPayToScriptHash())
+            continue;
+        if (!(IsMine(txout) & ISMINE_SPENDABLE))
+            continue;
+        COutPoint outpoint(wtx.GetHash(), i);
+        mapStakeCandidates.erase(outpoint);
+        mapStakeDepthQueue.emplace(nHeightMature, outpoint);
+    }
+}
+
+void CWallet::UpdateStakeCandidates()
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
+
+    if (!fStakeCandidatesInitialized) {
+        mapStakeDepthQueue.clear();
+        mapStakeAgeQueue.clear();
+        mapStakeCandidates.clear();
+        for (const auto& pair : mapWallet) {
+            QueueStakeCoins(pair.second);
+        }
+        fStakeCandidatesInitialized = true;
+    }
+
+    int nHeight = chainActive.Height();
+    while (!mapStakeDepthQueue.empty() && mapStakeDepthQueue.begin()->first <= nHeight) {
+        int nHeightMature = mapStakeDepthQueue.begin()->first;
+        COutPoint outpoint = mapStakeDepthQueue.begin()->second;
+        mapStakeDepthQueue.erase(mapStakeDepthQueue.begin());
+
+        const CWalletTx* pwtx = GetWalletTx(outpoint.hash);
+        if (!pwtx || IsSpent(outpoint.hash, outpoint.n))
+            continue;
+        // transactions which were reorganized into another block were queued again for their new height
+        int nDepth = pwtx->GetDepthInMainChain();
+        if (nDepth <= 0 || nHeight - nDepth + GetStakeMinDepth(*pwtx) != nHeightMature)
+            continue;
+        int64_t nTxTime = pwtx->GetTxTime();
+        mapStakeAgeQueue.emplace(nTxTime + CurrentMinStakeAge(nTxTime), outpoint);
+    }
+
+    int64_t nNow = GetTime();
+    while (!mapStakeAgeQueue.empty() && mapStakeAgeQueue.begin()->first <= nNow) {
+        COutPoint outpoint = mapStakeAgeQueue.begin()->second;
+        mapStakeAgeQueue.erase(mapStakeAgeQueue.begin());
+
+        const CWalletTx* pwtx = GetWalletTx(outpoint.hash);
+        if (!pwtx || IsSpent(outpoint.hash, outpoint.n) || pwtx->GetDepthInMainChain() < GetStakeMinDepth(*pwtx))
+            continue;
+        BlockMap::iterator mi = mapBlockIndex.find(pwtx->hashBlock);
+        if (mi == mapBlockIndex.end()) {
             LogPrintf("failed to find block index ");
             continue;
         }
-        // Read block header
-        CBlockHeader block = pindex->GetBlockHeader();
-        COutPoint prevoutStake = COutPoint(pcoin.first->GetHash(), pcoin.second);
-        nTxNewTime = GetAdjustedTime();
-        //iterates each utxo inside of CheckStakeKernelHash()
-        CScript kernelScript;
-        auto stakeScript = pcoin.first->tx->vout[pcoin.second].scriptPubKey;
-        fKernelFound = CreateCoinStakeKernel(kernelScript, stakeScript, nBits,
-                                             block, sizeof(CBlock), pcoin.first->tx,
-                                             prevoutStake, nTxNewTime, false);
-        if(fKernelFound)
-        {
-            FillCoinStakePayments(txNew, kernelScript, prevoutStake, blockReward);
-            break;
+        CStakeCandidate candidate;
+        candidate.prevout = outpoint;
+        candidate.txout = pwtx->tx->vout[outpoint.n];
+        candidate.nTimeBlockFrom = mi->second->GetBlockTime();
+        if (!GetKernelStakeModifier(pwtx->hashBlock, candidate.nStakeModifier)) {
+            // not enough blocks on top of it to select the modifier yet
+            mapStakeAgeQueue.emplace(nNow + nStakeSetUpdateTime, outpoint);
+            continue;
         }
+        mapStakeCandidates[outpoint] = candidate;
     }
-    if(!fKernelFound)
-    {
-        LogPrintf("Failed to find coinstake kernel");
+}
+
+bool CWallet::GetStakeCandidates(std::vector<CStakeCandidate>& vCandidatesRet)
+{
+    LOCK2(cs_main, cs_wallet);
+    UpdateStakeCandidates();
+
+    vCandidatesRet.clear();
+    for (const auto& pair : mapStakeCandidates) {
+        // spent by an unconfirmed transaction or locked by the user
+        if (IsSpent(pair.first.hash, pair.first.n) || IsLockedCoin(pair.first.hash, pair.first.n))
+            continue;
+        // not in the chain anymore
+        const CWalletTx* pwtx = GetWalletTx(pair.first.hash);
+        if (!pwtx || pwtx->GetDepthInMainChain() < 1)
+            continue;
+        vCandidatesRet.push_back(pair.second);
+    }
+    if (vCandidatesRet.empty()) {
+        LogPrint("staking", "GetStakeCandidates() : No Coins to stake\n");
         return false;
     }
+    return true;
+}
 
-    nLastStakeSetUpdate = 0;
+bool CWallet::FindStakeKernel(const std::vector<CStakeCandidate>& vCandidates, unsigned int nBits, unsigned int nTimeFrom,
+                              unsigned int nTimeTo, int64_t nMedianTimePast, CStakeKernel& kernelRet) const
+{
+    uint256 hashProofOfStake;
+    for (const CStakeCandidate& candidate : vCandidates) {
+        auto nStakeMinAge = CurrentMinStakeAge(candidate.nTimeBlockFrom);
+        if (candidate.nTimeBlockFrom + nStakeMinAge + nHashDrift > nTimeFrom) // Min age requirement
+            continue;
+        for (unsigned int nTryTime = nTimeTo; nTryTime > nTimeFrom; --nTryTime) {
+            if (!CheckStakeKernelHash(nBits, candidate, sizeof(CBlock), nTryTime, hashProofOfStake))
+                continue;
+            //Double check that this will pass time requirements
+            if (nTryTime <= nMedianTimePast) {
+                LogPrintf("FindStakeKernel() : kernel found, but it is too far in the past \n");
+                continue;
+            }
+            if (fDebug && GetBoolArg("-printcoinstake", false))
+                LogPrintf("FindStakeKernel : kernel found\n");
+            kernelRet.candidate = candidate;
+            kernelRet.nTime = nTryTime;
+            return true;
+        }
+    }
+    LogPrint("staking", "Failed to find coinstake kernel\n");
+    return false;
+}
+
+bool CWallet::CreateCoinStake(const CStakeKernel& kernel, CAmount blockReward, CMutableTransaction& txNew)
+{
+    AssertLockHeld(cs_main);
+    LOCK(cs_wallet);
+    const COutPoint& prevoutStake = kernel.candidate.prevout;
+    // the kernel was searched without locks, make sure the coin is still ours and unspent
+    const CWalletTx* pwtx = GetWalletTx(prevoutStake.hash);
+    if (!pwtx || prevoutStake.n >= pwtx->tx->vout.size() || IsSpent(prevoutStake.hash, prevoutStake.n))
+        return error("CreateCoinStake() : stake input %s is not available anymore", prevoutStake.ToStringShort());
+
+    txNew.vin.clear();
+    txNew.vout.clear();
+    // Mark coin stake transaction
+    CScript scriptEmpty;
+    scriptEmpty.clear();
+    txNew.vout.emplace_back(CTxOut(0, scriptEmpty));
+    FillCoinStakePayments(txNew, kernel.candidate.txout.scriptPubKey, prevoutStake, blockReward);
     return true;
 }
 
@@ -4208,12 +4657,11 @@ DBErrors CWallet::LoadWallet(bool& fFirstRunRet)
 
     {
         LOCK2(cs_main, cs_wallet);
-        for (auto& pair : mapWallet) {
-            for(unsigned int i = 0; i < pair.second.tx->vout.size(); ++i) {
-                if (IsMine(pair.second.tx->vout[i]) && !IsSpent(pair.first, i)) {
-                    setWalletUTXO.insert(COutPoint(pair.first, i));
-                }
-            }
+        RebuildWalletUTXO();
+
+        // transactions were added after the rounds were written, possibly by a version not invalidating them
+        if (nPrivateSendRoundsOrderPos != nOrderPosNext) {
+            mapOutpointPrivateSendRounds.clear();
         }
     }
 
@@ -4391,6 +4839,52 @@ size_t CWallet::KeypoolCountInternalKeys()
     return setInternalKeyPool.size();
 }
 
+void CWallet::TopUpHDKeyPool(CWalletDB& walletdb, int64_t nMissingExternal, int64_t nMissingInternal, unsigned int nTargetSize)
+{
+    AssertLockHeld(cs_wallet);
+
+    int64_t nEnd = 1;
+    if (!setInternalKeyPool.empty()) {
+        nEnd = *(--setInternalKeyPool.end()) + 1;
+    }
+    if (!setExternalKeyPool.empty()) {
+        nEnd = std::max(nEnd, *(--setExternalKeyPool.end()) + 1);
+    }
+
+    for (bool fInternal : {false, true}) {
+        int64_t nMissing = fInternal ? nMissingInternal : nMissingExternal;
+        while (nMissing > 0) {
+            size_t nBatchSize = std::min(nMissing, (int64_t)HD_KEYPOOL_BATCH_SIZE);
+            // keys, pool entries and the chain counters of a batch are written in one transaction
+            bool fTxn = walletdb.TxnBegin();
+
+            std::vector<CPubKey> vecPubKeys;
+            // TODO: implement keypools for all accounts?
+            DeriveNewChildKeys(CKeyMetadata(GetTime()), 0, fInternal, nBatchSize, vecPubKeys, &walletdb);
+            for (const CPubKey& pubkey : vecPubKeys) {
+                if (!walletdb.WritePool(nEnd, CKeyPool(pubkey, fInternal)))
+                    throw std::runtime_error(std::string(__func__) + ": writing generated key failed");
+                if (fInternal) {
+                    setInternalKeyPool.insert(nEnd);
+                } else {
+                    setExternalKeyPool.insert(nEnd);
+                }
+                nEnd++;
+            }
+
+            if (fTxn && !walletdb.TxnCommit())
+                throw std::runtime_error(std::string(__func__) + ": committing generated keys failed");
+            nMissing -= nBatchSize;
+
+            LogPrintf("keypool added %d keys, last key %d, size=%u, internal=%d\n", vecPubKeys.size(), nEnd - 1, setInternalKeyPool.size() + setExternalKeyPool.size(), fInternal);
+
+            double dProgress = 100.f * (nEnd - 1) / (nTargetSize + 1);
+            std::string strMsg = strprintf(_("Loading wallet... (%3.2f %%)"), dProgress);
+            uiInterface.InitMessage(strMsg);
+        }
+    }
+}
+
 bool CWallet::TopUpKeyPool(unsigned int kpSize)
 {
     {
@@ -4420,8 +4914,13 @@ bool CWallet::TopUpKeyPool(unsigned int kpSize)
         } else {
             nTargetSize *= 2;
         }
-        bool fInternal = false;
         CWalletDB walletdb(strWalletFile);
+        if (IsHDEnabled()) {
+            TopUpHDKeyPool(walletdb, missingExternal, missingInternal, nTargetSize);
+            return true;
+        }
+
+        bool fInternal = false;
         for (int64_t i = missingInternal + missingExternal; i--;)
         {
             int64_t nEnd = 1;
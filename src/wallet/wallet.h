@@ -9,6 +9,8 @@
 
 #include "amount.h"
 #include "base58.h"
+#include "kernel.h"
+#include "memusage.h"
 #include "streams.h"
 #include "tinyformat.h"
 #include "ui_interface.h"
@@ -24,6 +26,7 @@
 #include <algorithm>
 #include <atomic>
 #include <map>
+#include <memory>
 #include <set>
 #include <stdexcept>
 #include <stdint.h>
@@ -78,6 +81,16 @@ extern const char * DEFAULT_WALLET_DAT;
 //! if set, all keys will be derived by using BIP39/BIP44
 static const bool DEFAULT_USE_HD_WALLET = false;
 
+//! Blocks read and filtered in parallel per step of a rescan, locks are released between steps
+static const int RESCAN_CHUNK_SIZE = 256;
+//! Maximum number of threads reading and filtering blocks during a rescan
+static const int MAX_RESCAN_THREADS = 8;
+//! HD keys derived and written per database transaction when topping up the keypool
+static const unsigned int HD_KEYPOOL_BATCH_SIZE = 1000;
+//! Maximum number of threads deriving HD keys, each gets at least MIN_KEYS_PER_DERIVATION_THREAD keys
+static const int MAX_KEY_DERIVATION_THREADS = 8;
+static const unsigned int MIN_KEYS_PER_DERIVATION_THREAD = 64;
+
 bool AutoBackupWallet (CWallet* wallet, const std::string& strWalletFile_, std::string& strBackupWarningRet, std::string& strBackupErrorRet);
 
 class CBlockIndex;
@@ -290,6 +303,69 @@ public:
 
 };
 
+/**
+ * Amounts cached by a CWalletTx. The storage is only allocated once the first amount is cached and
+ * is freed again by Clear, so transactions whose balances are never asked for (e.g. fully spent ones)
+ * don't pay for it. Copies start out empty since the cache is memory only anyway.
+ */
+class CWalletTxAmountCache
+{
+public:
+    enum AmountType
+    {
+        DEBIT,
+        CREDIT,
+        IMMATURE_CREDIT,
+        AVAILABLE_CREDIT,
+        ANONYMIZED_CREDIT,
+        DENOM_UNCONF_CREDIT,
+        DENOM_CONF_CREDIT,
+        WATCH_DEBIT,
+        WATCH_CREDIT,
+        IMMATURE_WATCH_CREDIT,
+        AVAILABLE_WATCH_CREDIT,
+        CHANGE,
+        AMOUNT_TYPE_COUNT
+    };
+
+private:
+    struct Amounts
+    {
+        uint32_t nCachedMask;
+        CAmount vAmounts[AMOUNT_TYPE_COUNT];
+
+        Amounts() : nCachedMask(0) {}
+    };
+    std::unique_ptr<Amounts> pAmounts;
+
+public:
+    CWalletTxAmountCache() {}
+    CWalletTxAmountCache(const CWalletTxAmountCache&) {}
+    CWalletTxAmountCache(CWalletTxAmountCache&&) = default;
+    CWalletTxAmountCache& operator=(const CWalletTxAmountCache&) { Clear(); return *this; }
+    CWalletTxAmountCache& operator=(CWalletTxAmountCache&&) = default;
+
+    bool Get(AmountType type, CAmount& nAmountRet) const
+    {
+        if (!pAmounts || !(pAmounts->nCachedMask & (1U << type)))
+            return false;
+        nAmountRet = pAmounts->vAmounts[type];
+        return true;
+    }
+
+    void Set(AmountType type, CAmount nAmount)
+    {
+        if (!pAmounts)
+            pAmounts.reset(new Amounts());
+        pAmounts->vAmounts[type] = nAmount;
+        pAmounts->nCachedMask |= 1U << type;
+    }
+
+    void Clear() { pAmounts.reset(); }
+
+    size_t DynamicMemoryUsage() const { return pAmounts ? memusage::MallocUsage(sizeof(Amounts)) : 0; }
+};
+
 /** 
  * A transaction with a bunch of additional info that only the owner cares about.
  * It includes any unrecorded transactions needed to link it back to the block chain.
@@ -315,30 +391,7 @@ public:
     int64_t nOrderPos; //!< position in ordered transaction list
 
     // memory only
-    mutable bool fDebitCached;
-    mutable bool fCreditCached;
-    mutable bool fImmatureCreditCached;
-    mutable bool fAvailableCreditCached;
-    mutable bool fAnonymizedCreditCached;
-    mutable bool fDenomUnconfCreditCached;
-    mutable bool fDenomConfCreditCached;
-    mutable bool fWatchDebitCached;
-    mutable bool fWatchCreditCached;
-    mutable bool fImmatureWatchCreditCached;
-    mutable bool fAvailableWatchCreditCached;
-    mutable bool fChangeCached;
-    mutable CAmount nDebitCached;
-    mutable CAmount nCreditCached;
-    mutable CAmount nImmatureCreditCached;
-    mutable CAmount nAvailableCreditCached;
-    mutable CAmount nAnonymizedCreditCached;
-    mutable CAmount nDenomUnconfCreditCached;
-    mutable CAmount nDenomConfCreditCached;
-    mutable CAmount nWatchDebitCached;
-    mutable CAmount nWatchCreditCached;
-    mutable CAmount nImmatureWatchCreditCached;
-    mutable CAmount nAvailableWatchCreditCached;
-    mutable CAmount nChangeCached;
+    mutable CWalletTxAmountCache amountCache;
 
     CWalletTx()
     {
@@ -360,30 +413,7 @@ public:
         nTimeSmart = 0;
         fFromMe = false;
         strFromAccount.clear();
-        fDebitCached = false;
-        fCreditCached = false;
-        fImmatureCreditCached = false;
-        fAvailableCreditCached = false;
-        fAnonymizedCreditCached = false;
-        fDenomUnconfCreditCached = false;
-        fDenomConfCreditCached = false;
-        fWatchDebitCached = false;
-        fWatchCreditCached = false;
-        fImmatureWatchCreditCached = false;
-        fAvailableWatchCreditCached = false;
-        fChangeCached = false;
-        nDebitCached = 0;
-        nCreditCached = 0;
-        nImmatureCreditCached = 0;
-        nAvailableCreditCached = 0;
-        nAnonymizedCreditCached = 0;
-        nDenomUnconfCreditCached = 0;
-        nDenomConfCreditCached = 0;
-        nWatchDebitCached = 0;
-        nWatchCreditCached = 0;
-        nAvailableWatchCreditCached = 0;
-        nImmatureWatchCreditCached = 0;
-        nChangeCached = 0;
+        amountCache.Clear();
         nOrderPos = -1;
     }
 
@@ -434,18 +464,7 @@ public:
     //! make sure balances are recalculated
     void MarkDirty()
     {
-        fCreditCached = false;
-        fAvailableCreditCached = false;
-        fImmatureCreditCached = false;
-        fAnonymizedCreditCached = false;
-        fDenomUnconfCreditCached = false;
-        fDenomConfCreditCached = false;
-        fWatchDebitCached = false;
-        fWatchCreditCached = false;
-        fAvailableWatchCreditCached = false;
-        fImmatureWatchCreditCached = false;
-        fDebitCached = false;
-        fChangeCached = false;
+        amountCache.Clear();
     }
 
     void BindWallet(CWallet *pwalletIn)
@@ -489,6 +508,9 @@ public:
     bool RelayWalletTransaction(CConnman* connman, const std::string& strCommand="tx");
 
     std::set<uint256> GetConflicts() const;
+
+    //! Approximate heap usage of this transaction and its caches, not counting the wallet's map node
+    size_t DynamicMemoryUsage() const;
 };
 
 
@@ -634,6 +656,8 @@ private:
 class CWallet : public CCryptoKeyStore, public CValidationInterface
 {
 private:
+    friend class CWalletScanFilter;
+
     static std::atomic<bool> fFlushThreadRunning;
 
     /**
@@ -673,20 +697,50 @@ private:
     void AddToSpends(const COutPoint& outpoint, const uint256& wtxid);
     void AddToSpends(const uint256& wtxid);
 
+    /**
+     * Our outputs which are not spent. May also contain outputs which were spent meanwhile, users
+     * have to check IsSpent. Outputs get back in when their spend is abandoned or conflicted.
+     * Balances and AvailableCoins only look at the transactions in here instead of all of mapWallet.
+     */
     std::set<COutPoint> setWalletUTXO;
+    /** The denominated outputs of setWalletUTXO, bucketed by denomination, so that mixing only looks at those */
+    std::map<CAmount, std::set<COutPoint> > mapDenominatedUTXO;
+    /** Insert into setWalletUTXO and, if it's a denomination, into its bucket of mapDenominatedUTXO */
+    void InsertWalletUTXO(const COutPoint& outpoint, CAmount nValue);
+    void EraseWalletUTXO(const COutPoint& outpoint);
+    /** Add the output to setWalletUTXO again if it's ours and not spent, e.g. after its spend was abandoned */
+    void AddToWalletUTXO(const COutPoint& outpoint);
+    /** Recreate setWalletUTXO from mapWallet, requires cs_main and cs_wallet */
+    void RebuildWalletUTXO();
+    /** Transactions with outputs in setWalletUTXO, each one once */
+    std::vector<const CWalletTx*> GetWalletUTXOTxes() const;
+    /** Transactions with outputs in the given buckets of mapDenominatedUTXO (all if empty), each one once */
+    std::vector<const CWalletTx*> GetDenominatedUTXOTxes(const std::vector<CAmount>& vecDenominations = std::vector<CAmount>()) const;
+    /** AvailableCoins looking at the given transactions only, requires cs_main and cs_wallet */
+    void AvailableCoinsFromTxes(const std::vector<const CWalletTx*>& vecTxes, std::vector<COutput>& vCoins, bool fOnlyConfirmed, const CCoinControl *coinControl,
+                                bool fIncludeZeroValue, AvailableCoinsType nCoinType, bool fUseInstantSend) const;
+
+    /**
+     * PrivateSend rounds of our outputs computed so far, see GetRealOutpointPrivateSendRounds. An entry only
+     * depends on the ancestors of its transaction, so entries are dropped when an ancestor gets into the wallet
+     * later (InvalidatePrivateSendRounds) and all of them on rescans, which may make more inputs ours.
+     */
+    mutable std::map<COutPoint, int> mapOutpointPrivateSendRounds;
+    /** nOrderPosNext at the time the loaded mapOutpointPrivateSendRounds was written, -1 if none was loaded */
+    int64_t nPrivateSendRoundsOrderPos;
+    /** Drop the cached rounds of the outputs of the given transaction and of all its in-wallet descendants */
+    void InvalidatePrivateSendRounds(const uint256& hashTx);
+    /** Rounds of the outpoint from the cached rounds of its inputs, returns false and queues the inputs which aren't cached yet if there are any */
+    bool ComputeOutpointPrivateSendRounds(const COutPoint& outpoint, std::vector<COutPoint>& vecMissing, int& nRoundsRet) const;
 
     /* Mark a transaction (and its in-wallet descendants) as conflicting with a particular block. */
     void MarkConflicted(const uint256& hashBlock, const uint256& hashTx);
 
     void SyncMetaData(std::pair<TxSpends::iterator, TxSpends::iterator>);
 
-    /* HD derive new child key (on internal or external chain) */
-    void DeriveNewChildKey(const CKeyMetadata& metadata, CKey& secretRet, uint32_t nAccountIndex, bool fInternal /*= false*/);
+    /** Derive the missing HD keypool keys in batches of HD_KEYPOOL_BATCH_SIZE, each written in one transaction */
+    void TopUpHDKeyPool(CWalletDB& walletdb, int64_t nMissingExternal, int64_t nMissingInternal, unsigned int nTargetSize);
 
-    bool CreateCoinStakeKernel(CScript &kernelScript, const CScript &stakeScript,
-                               unsigned int nBits, const CBlock& blockFrom,
-                               unsigned int nTxPrevOffset, const CTransactionRef &txPrev,
-                               const COutPoint& prevout, unsigned int &nTimeTx, bool fPrintProofOfStake) const;
     void FillCoinStakePayments(CMutableTransaction &transaction,
                                const CScript &kernelScript,
                                const COutPoint &stakePrevout, CAmount blockReward) const;
@@ -708,6 +762,22 @@ private:
      */
     bool AddWatchOnly(const CScript& dest) override;
 
+protected:
+    // Stake candidates are maintained from wallet events instead of scanning mapWallet on every
+    // search, see UpdateStakeCandidates. All protected by cs_wallet.
+    bool fStakeCandidatesInitialized;
+    // outputs which don't have enough confirmations yet, keyed by the height at which they will have them
+    std::multimap<int, COutPoint> mapStakeDepthQueue;
+    // outputs with enough confirmations which are too young yet, keyed by the time they reach the min stake age
+    std::multimap<int64_t, COutPoint> mapStakeAgeQueue;
+    // outputs which may be staked, might include outputs spent by unconfirmed transactions
+    std::map<COutPoint, CStakeCandidate> mapStakeCandidates;
+
+    /** Queue the outputs of a confirmed transaction which may be staked once they are old enough */
+    void QueueStakeCoins(const CWalletTx& wtx);
+    /** Move queued outputs which reached the required depth and age into mapStakeCandidates */
+    void UpdateStakeCandidates();
+
 public:
     /*
      * Main wallet lock.
@@ -771,6 +841,7 @@ public:
         nMasterKeyMaxID = 0;
         pwalletdbEncryption = NULL;
         nOrderPosNext = 0;
+        nPrivateSendRoundsOrderPos = -1;
         nNextResend = 0;
         nLastResend = 0;
         nTimeFirstKey = 0;
@@ -785,6 +856,7 @@ public:
         nStakeSplitThreshold = 2000;
         nHashInterval = 22;
         nStakeSetUpdateTime = 300; // 5 minutes
+        fStakeCandidatesInitialized = false;
     }
 
     std::map<uint256, CWalletTx> mapWallet;
@@ -825,9 +897,7 @@ public:
      * assembled
      */
     bool SelectCoinsMinConf(const CAmount& nTargetValue, int nConfMine, int nConfTheirs, uint64_t nMaxAncestors, std::vector<COutput> vCoins, std::set<std::pair<const CWalletTx*,unsigned int> >& setCoinsRet, CAmount& nValueRet, AvailableCoinsType nCoinType=ALL_COINS, bool fUseInstantSend = false) const;
-    using StakeCoinsSet = std::set<std::pair<const CWalletTx*, unsigned int> >;
     bool MintableCoins();
-    bool SelectStakeCoins(StakeCoinsSet& setCoins, CAmount nTargetAmount, const CScript &scriptFilterPubKey = CScript()) const;
     // Coin selection
     bool SelectPSInOutPairsByDenominations(int nDenom, CAmount nValueMin, CAmount nValueMax, std::vector< std::pair<CTxDSIn, CTxOut> >& vecPSInOutPairsRet);
     bool GetCollateralTxDSIn(CTxDSIn& txdsinRet, CAmount& nValueRet) const;
@@ -844,7 +914,7 @@ public:
     int  CountInputsWithAmount(CAmount nInputAmount);
 
     // get the PrivateSend chain depth for a given input
-    int GetRealOutpointPrivateSendRounds(const COutPoint& outpoint, int nRounds = 0) const;
+    int GetRealOutpointPrivateSendRounds(const COutPoint& outpoint) const;
     // respect current settings
     int GetCappedOutpointPrivateSendRounds(const COutPoint& outpoint) const;
 
@@ -864,6 +934,12 @@ public:
      * Generate a new key
      */
     CPubKey GenerateNewKey(uint32_t nAccountIndex, bool fInternal /*= false*/);
+    /**
+     * HD derive nCount new child keys (on internal or external chain) and append their pubkeys to vecPubKeysRet.
+     * The account and change keys are derived only once, the children in parallel for larger batches.
+     * Keys and the updated chain are written through pwalletdb if given, callers may wrap this in a transaction.
+     */
+    void DeriveNewChildKeys(const CKeyMetadata& metadata, uint32_t nAccountIndex, bool fInternal, size_t nCount, std::vector<CPubKey>& vecPubKeysRet, CWalletDB* pwalletdb = NULL);
     //! HaveKey implementation that also checks the mapHdPubKeys
     bool HaveKey(const CKeyID &address) const override;
     //! GetPubKey implementation that also checks the mapHdPubKeys
@@ -871,7 +947,7 @@ public:
     //! GetKey implementation that can derive a HD private key on the fly
     bool GetKey(const CKeyID &address, CKey& keyOut) const override;
     //! Adds a HDPubKey into the wallet(database)
-    bool AddHDPubKey(const CExtPubKey &extPubKey, bool fInternal);
+    bool AddHDPubKey(const CExtPubKey &extPubKey, bool fInternal, const uint256& hdchainID, CWalletDB* pwalletdb = NULL);
     //! loads a HDPubKey into the wallets memory
     bool LoadHDPubKey(const CHDPubKey &hdPubKey);
     //! Adds a key to the store, and saves it to disk.
@@ -904,6 +980,7 @@ public:
     bool AddWatchOnly(const CScript& dest, int64_t nCreateTime);
 
     bool RemoveWatchOnly(const CScript &dest) override;
+    bool RemoveWatchOnly(const CScript &dest, CWalletDB* pwalletdb);
     //! Adds a watch-only address to the store, without saving it to disk (used by LoadWallet)
     bool LoadWatchOnly(const CScript &dest);
 
@@ -925,6 +1002,10 @@ public:
     void MarkDirty();
     bool AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose=true);
     bool LoadToWallet(const CWalletTx& wtxIn);
+    /** Cached PrivateSend rounds written by the last shutdown, only used if no transaction was added since (nOrderPosNext is unchanged) */
+    void LoadPrivateSendRounds(int64_t nOrderPosNextWritten, const std::map<COutPoint, int>& mapRounds);
+    /** Forget all cached PrivateSend rounds, they are computed again when needed */
+    void ClearPrivateSendRounds();
     void SyncTransaction(const CTransaction& tx, const CBlockIndex *pindex, int posInBlock) override;
     bool AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlockIndex* pIndex, int posInBlock, bool fUpdate);
     CBlockIndex* ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate = false);
@@ -963,9 +1044,19 @@ public:
     bool CreateTransaction(const std::vector<CRecipient>& vecSend, CWalletTx& wtxNew, CReserveKey& reservekey, CAmount& nFeeRet, int& nChangePosInOut,
                            std::string& strFailReason, const CCoinControl *coinControl = NULL, bool sign = true, AvailableCoinsType nCoinType=ALL_COINS, bool fUseInstantSend=false, int nExtraPayloadSize = 0);
     bool CommitTransaction(CWalletTx& wtxNew, CReserveKey& reservekey, CConnman* connman, CValidationState& state, const std::string& strCommand="tx");
-    bool CreateCoinStake(unsigned int nBits, CAmount blockReward,
-                         CMutableTransaction& txNew, unsigned int& nTxNewTime,
-                         std::vector<CWalletTx *> &vwtxPrev);
+    /**
+     * Snapshot of the coins which may be staked, takes cs_main and cs_wallet.
+     * The result can be searched for a kernel with FindStakeKernel without holding any lock.
+     * Only coins which became old enough since the last call are looked at, not all of mapWallet.
+     */
+    bool GetStakeCandidates(std::vector<CStakeCandidate>& vCandidatesRet);
+    /** How many seconds ahead of the current time kernels are searched */
+    unsigned int GetHashDrift() const { return nHashDrift; }
+    /** Look for a candidate meeting the target at a time in (nTimeFrom, nTimeTo], doesn't lock anything */
+    bool FindStakeKernel(const std::vector<CStakeCandidate>& vCandidates, unsigned int nBits, unsigned int nTimeFrom,
+                         unsigned int nTimeTo, int64_t nMedianTimePast, CStakeKernel& kernelRet) const;
+    /** Build the coinstake for a kernel found by FindStakeKernel, requires cs_main, fails if the coin was spent meanwhile */
+    bool CreateCoinStake(const CStakeKernel& kernel, CAmount blockReward, CMutableTransaction& txNew);
     bool CreateCollateralTransaction(CMutableTransaction& txCollateral, std::string& strReason);
     bool ConvertList(std::vector<CTxIn> vecTxIn, std::vector<CAmount>& vecAmounts);
 
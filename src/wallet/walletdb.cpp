@@ -16,7 +16,10 @@
 #include "utiltime.h"
 #include "wallet/wallet.h"
 
+#include "ctpl.h"
+
 #include <atomic>
+#include <future>
 
 #include <boost/filesystem.hpp>
 #include <boost/foreach.hpp>
@@ -153,6 +156,12 @@ bool CWalletDB::WriteOrderPosNext(int64_t nOrderPosNext)
     return Write(std::string("orderposnext"), nOrderPosNext);
 }
 
+bool CWalletDB::WritePrivateSendRounds(int64_t nOrderPosNext, const std::map<COutPoint, int>& mapRounds)
+{
+    nWalletDBUpdateCounter++;
+    return Write(std::string("psrounds"), std::make_pair(nOrderPosNext, mapRounds));
+}
+
 bool CWalletDB::WriteDefaultKey(const CPubKey& vchPubKey)
 {
     nWalletDBUpdateCounter++;
@@ -276,6 +285,121 @@ public:
     }
 };
 
+/** Deserializes and checks a "tx" record, this doesn't touch the wallet and may run on any thread */
+static bool DecodeTxRecord(CDataStream& ssKey, CDataStream& ssValue, uint256& hash, CWalletTx& wtx, bool& fUpgradedRet, std::string& strErr)
+{
+    ssKey >> hash;
+    ssValue >> wtx;
+    CValidationState state;
+    if (!(CheckTransaction(wtx, state) && (wtx.GetHash() == hash) && state.IsValid()))
+        return false;
+
+    fUpgradedRet = false;
+    // Undo serialize changes in 31600
+    if (31404 <= wtx.fTimeReceivedIsTxTime && wtx.fTimeReceivedIsTxTime <= 31703)
+    {
+        if (!ssValue.empty())
+        {
+            char fTmp;
+            char fUnused;
+            ssValue >> fTmp >> fUnused >> wtx.strFromAccount;
+            strErr = strprintf("LoadWallet() upgrading tx ver=%d %d '%s' %s",
+                               wtx.fTimeReceivedIsTxTime, fTmp, wtx.strFromAccount, hash.ToString());
+            wtx.fTimeReceivedIsTxTime = fTmp;
+        }
+        else
+        {
+            strErr = strprintf("LoadWallet() repairing tx ver=%d %s", wtx.fTimeReceivedIsTxTime, hash.ToString());
+            wtx.fTimeReceivedIsTxTime = 0;
+        }
+        fUpgradedRet = true;
+    }
+    return true;
+}
+
+static void LoadTxRecord(CWallet* pwallet, CWalletScanState& wss, const uint256& hash, const CWalletTx& wtx, bool fUpgraded)
+{
+    if (fUpgraded)
+        wss.vWalletUpgrade.push_back(hash);
+
+    if (wtx.nOrderPos == -1)
+        wss.fAnyUnordered = true;
+
+    pwallet->LoadToWallet(wtx);
+}
+
+/** Deserializes and verifies a "key" or "wkey" record, this doesn't touch the wallet and may run on any thread */
+static bool DecodeKeyRecord(const std::string& strType, CDataStream& ssKey, CDataStream& ssValue, CPubKey& vchPubKey, CKey& key, std::string& strErr)
+{
+    ssKey >> vchPubKey;
+    if (!vchPubKey.IsValid())
+    {
+        strErr = "Error reading wallet database: CPubKey corrupt";
+        return false;
+    }
+    CPrivKey pkey;
+    uint256 hash;
+
+    if (strType == "key")
+    {
+        ssValue >> pkey;
+    } else {
+        CWalletKey wkey;
+        ssValue >> wkey;
+        pkey = wkey.vchPrivKey;
+    }
+
+    // Old wallets store keys as "key" [pubkey] => [privkey]
+    // ... which was slow for wallets with lots of keys, because the public key is re-derived from the private key
+    // using EC operations as a checksum.
+    // Newer wallets store keys as "key"[pubkey] => [privkey][hash(pubkey,privkey)], which is much faster while
+    // remaining backwards-compatible.
+    try
+    {
+        ssValue >> hash;
+    }
+    catch (...) {}
+
+    bool fSkipCheck = false;
+
+    if (!hash.IsNull())
+    {
+        // hash pubkey/privkey to accelerate wallet load
+        std::vector<unsigned char> vchKey;
+        vchKey.reserve(vchPubKey.size() + pkey.size());
+        vchKey.insert(vchKey.end(), vchPubKey.begin(), vchPubKey.end());
+        vchKey.insert(vchKey.end(), pkey.begin(), pkey.end());
+
+        if (Hash(vchKey.begin(), vchKey.end()) != hash)
+        {
+            strErr = "Error reading wallet database: CPubKey/CPrivKey corrupt";
+            return false;
+        }
+
+        fSkipCheck = true;
+    }
+
+    if (!key.Load(pkey, vchPubKey, fSkipCheck))
+    {
+        strErr = "Error reading wallet database: CPrivKey corrupt";
+        return false;
+    }
+    return true;
+}
+
+static bool LoadKeyRecord(CWallet* pwallet, CWalletScanState& wss, const std::string& strType, const CPubKey& vchPubKey, const CKey& key, std::string& strErr)
+{
+    if (strType == "key")
+        wss.nKeys++;
+
+    if (!pwallet->LoadKey(key, vchPubKey))
+    {
+        strErr = "Error reading wallet database: LoadKey failed";
+        return false;
+    }
+    return true;
+}
+
 bool
 ReadKeyValue(CWallet* pwallet, CDataStream& ssKey, CDataStream& ssValue,
              CWalletScanState &wss, std::string& strType, std::string& strErr)
@@ -300,37 +424,11 @@ ReadKeyValue(CWallet* pwallet, CDataStream& ssKey, CDataStream& ssValue,
         else if (strType == "tx")
         {
             uint256 hash;
-            ssKey >> hash;
             CWalletTx wtx;
-            ssValue >> wtx;
-            CValidationState state;
-            if (!(CheckTransaction(wtx, state) && (wtx.GetHash() == hash) && state.IsValid()))
+            bool fUpgraded;
+            if (!DecodeTxRecord(ssKey, ssValue, hash, wtx, fUpgraded, strErr))
                 return false;
-
-            // Undo serialize changes in 31600
-            if (31404 <= wtx.fTimeReceivedIsTxTime && wtx.fTimeReceivedIsTxTime <= 31703)
-            {
-                if (!ssValue.empty())
-                {
-                    char fTmp;
-                    char fUnused;
-                    ssValue >> fTmp >> fUnused >> wtx.strFromAccount;
-                    strErr = strprintf("LoadWallet() upgrading tx ver=%d %d '%s' %s",
-                                       wtx.fTimeReceivedIsTxTime, fTmp, wtx.strFromAccount, hash.ToString());
-                    wtx.fTimeReceivedIsTxTime = fTmp;
-                }
-                else
-                {
-                    strErr = strprintf("LoadWallet() repairing tx ver=%d %s", wtx.fTimeReceivedIsTxTime, hash.ToString());
-                    wtx.fTimeReceivedIsTxTime = 0;
-                }
-                wss.vWalletUpgrade.push_back(hash);
-            }
-
-            if (wtx.nOrderPos == -1)
-                wss.fAnyUnordered = true;
-
-            pwallet->LoadToWallet(wtx);
+            LoadTxRecord(pwallet, wss, hash, wtx, fUpgraded);
         }
         else if (strType == "acentry")
         {
@@ -362,66 +460,11 @@ ReadKeyValue(CWallet* pwallet, CDataStream& ssKey, CDataStream& ssValue,
         else if (strType == "key" || strType == "wkey")
         {
             CPubKey vchPubKey;
-            ssKey >> vchPubKey;
-            if (!vchPubKey.IsValid())
-            {
-                strErr = "Error reading wallet database: CPubKey corrupt";
-                return false;
-            }
             CKey key;
-            CPrivKey pkey;
-            uint256 hash;
-
-            if (strType == "key")
-            {
-                wss.nKeys++;
-                ssValue >> pkey;
-            } else {
-                CWalletKey wkey;
-                ssValue >> wkey;
-                pkey = wkey.vchPrivKey;
-            }
-
-            // Old wallets store keys as "key" [pubkey] => [privkey]
-            // ... which was slow for wallets with lots of keys, because the public key is re-derived from the private key
-            // using EC operations as a checksum.
-            // Newer wallets store keys as "key"[pubkey] => [privkey][hash(pubkey,privkey)], which is much faster while
-            // remaining backwards-compatible.
-            try
-            {
-                ssValue >> hash;
-            }
-            catch (...) {}
-
-            bool fSkipCheck = false;
-
-            if (!hash.IsNull())
-            {
-                // hash pubkey/privkey to accelerate wallet load
-                std::vector<unsigned char> vchKey;
-                vchKey.reserve(vchPubKey.size() + pkey.size());
-                vchKey.insert(vchKey.end(), vchPubKey.begin(), vchPubKey.end());
-                vchKey.insert(vchKey.end(), pkey.begin(), pkey.end());
-
-                if (Hash(vchKey.begin(), vchKey.end()) != hash)
-                {
-                    strErr = "Error reading wallet database: CPubKey/CPrivKey corrupt";
-                    return false;
-                }
-
-                fSkipCheck = true;
-            }
-
-            if (!key.Load(pkey, vchPubKey, fSkipCheck))
-            {
-                strErr = "Error reading wallet database: CPrivKey corrupt";
+            if (!DecodeKeyRecord(strType, ssKey, ssValue, vchPubKey, key, strErr))
                 return false;
-            }
-            if (!pwallet->LoadKey(key, vchPubKey))
-            {
-                strErr = "Error reading wallet database: LoadKey failed";
+            if (!LoadKeyRecord(pwallet, wss, strType, vchPubKey, key, strErr))
                 return false;
-            }
         }
         else if (strType == "mkey")
         {
@@ -514,6 +557,13 @@ ReadKeyValue(CWallet* pwallet, CDataStream& ssKey, CDataStream& ssValue,
         {
             ssValue >> pwallet->nOrderPosNext;
         }
+        else if (strType == "psrounds")
+        {
+            int64_t nOrderPosNextWritten;
+            std::map<COutPoint, int> mapRounds;
+            ssValue >> nOrderPosNextWritten >> mapRounds;
+            pwallet->LoadPrivateSendRounds(nOrderPosNextWritten, mapRounds);
+        }
         else if (strType == "destdata")
         {
             std::string strAddress, strKey, strValue;
@@ -579,6 +629,51 @@ static bool IsKeyType(std::string strType)
             strType == "hdchain" || strType == "chdchain");
 }
 
+/** A record read by LoadWallet, tx and key records are decoded in parallel before they are loaded in order */
+class CWalletLoadRecord
+{
+public:
+    CDataStream ssKey;
+    CDataStream ssValue;
+
+    //! Set if the record was decoded by DecodeRecord, other records are read by ReadKeyValue
+    bool fDecoded;
+    bool fDecodeOk;
+    std::string strType;
+    std::string strErr;
+
+    // "tx"
+    uint256 hash;
+    CWalletTx wtx;
+    bool fUpgraded;
+
+    // "key" and "wkey"
+    CPubKey vchPubKey;
+    CKey key;
+
+    CWalletLoadRecord() : ssKey(SER_DISK, CLIENT_VERSION), ssValue(SER_DISK, CLIENT_VERSION), fDecoded(false), fDecodeOk(false), fUpgraded(false) {}
+};
+
+static void DecodeRecord(CWalletLoadRecord& record)
+{
+    try {
+        CDataStream::size_type nKeySize = record.ssKey.size();
+        record.ssKey >> record.strType;
+        if (record.strType == "tx") {
+            record.fDecodeOk = DecodeTxRecord(record.ssKey, record.ssValue, record.hash, record.wtx, record.fUpgraded, record.strErr);
+        } else if (record.strType == "key" || record.strType == "wkey") {
+            record.fDecodeOk = DecodeKeyRecord(record.strType, record.ssKey, record.ssValue, record.vchPubKey, record.key, record.strErr);
+        } else {
+            // cheap to read, leave it to ReadKeyValue
+            record.ssKey.Rewind(nKeySize - record.ssKey.size());
+            return;
+        }
+    } catch (...) {
+        record.fDecodeOk = false;
+    }
+    record.fDecoded = true;
+}
+
 DBErrors CWalletDB::LoadWallet(CWallet* pwallet)
 {
     pwallet->vchDefaultKey = CPubKey();
@@ -604,39 +699,94 @@ DBErrors CWalletDB::LoadWallet(CWallet* pwallet)
             return DB_CORRUPT;
         }
 
+        // Records are read in batches. While a batch is decoded by the worker threads the next one is read
+        // from the cursor, then the decoded batch is loaded into the wallet in the original order.
+        std::vector<CWalletLoadRecord> vecRead;
+        std::vector<CWalletLoadRecord> vecDecoding;
+        std::vector<std::future<void> > vecFutures;
+        int nThreads = std::max(1, std::min(GetNumCores(), MAX_WALLET_LOAD_THREADS));
+        // declared last so that it's destroyed (waiting for its jobs) first on early returns
+        ctpl::thread_pool workerPool(nThreads);
+        RenameThreadPool(workerPool, "walletload");
+
+        bool fCursorDone = false;
         while (true)
         {
-            // Read next record
-            CDataStream ssKey(SER_DISK, CLIENT_VERSION);
-            CDataStream ssValue(SER_DISK, CLIENT_VERSION);
-            int ret = ReadAtCursor(pcursor, ssKey, ssValue);
-            if (ret == DB_NOTFOUND)
-                break;
-            else if (ret != 0)
+            vecRead.reserve(WALLET_LOAD_BATCH_SIZE);
+            while (!fCursorDone && vecRead.size() < WALLET_LOAD_BATCH_SIZE)
             {
-                LogPrintf("Error reading next record from wallet database\n");
-                return DB_CORRUPT;
+                // Read next record
+                vecRead.emplace_back();
+                CWalletLoadRecord& record = vecRead.back();
+                int ret = ReadAtCursor(pcursor, record.ssKey, record.ssValue);
+                if (ret == DB_NOTFOUND)
+                {
+                    vecRead.pop_back();
+                    fCursorDone = true;
+                }
+                else if (ret != 0)
+                {
+                    LogPrintf("Error reading next record from wallet database\n");
+                    pcursor->close();
+                    return DB_CORRUPT;
+                }
             }
 
-            // Try to be tolerant of single corrupt records:
-            std::string strType, strErr;
-            if (!ReadKeyValue(pwallet, ssKey, ssValue, wss, strType, strErr))
+            for (auto& future : vecFutures)
+                future.get();
+            vecFutures.clear();
+
+            for (CWalletLoadRecord& record : vecDecoding)
             {
-                // losing keys is considered a catastrophic error, anything else
-                // we assume the user can live with:
-                if (IsKeyType(strType))
-                    result = DB_CORRUPT;
-                else
+                // Try to be tolerant of single corrupt records:
+                std::string strType, strErr;
+                bool fReadOK;
+                if (record.fDecoded) {
+                    strType = record.strType;
+                    strErr = record.strErr;
+                    if (strType == "tx") {
+                        fReadOK = record.fDecodeOk;
+                        if (fReadOK)
+                            LoadTxRecord(pwallet, wss, record.hash, record.wtx, record.fUpgraded);
+                    } else {
+                        fReadOK = record.fDecodeOk && LoadKeyRecord(pwallet, wss, strType, record.vchPubKey, record.key, strErr);
+                    }
+                } else {
+                    fReadOK = ReadKeyValue(pwallet, record.ssKey, record.ssValue, wss, strType, strErr);
+                }
+                if (!fReadOK)
                 {
-                    // Leave other errors alone, if we try to fix them we might make things worse.
-                    fNoncriticalErrors = true; // ... but do warn the user there is something wrong.
-                    if (strType == "tx")
-                        // Rescan if there is a bad transaction record:
-                        SoftSetBoolArg("-rescan", true);
+                    // losing keys is considered a catastrophic error, anything else
+                    // we assume the user can live with:
+                    if (IsKeyType(strType))
+                        result = DB_CORRUPT;
+                    else
+                    {
+                        // Leave other errors alone, if we try to fix them we might make things worse.
+                        fNoncriticalErrors = true; // ... but do warn the user there is something wrong.
+                        if (strType == "tx")
+                            // Rescan if there is a bad transaction record:
+                            SoftSetBoolArg("-rescan", true);
+                    }
                 }
+                if (!strErr.empty())
+                    LogPrintf("%s\n", strErr);
+            }
+
+            if (vecRead.empty())
+                break;
+
+            vecDecoding.swap(vecRead);
+            vecRead.clear();
+            size_t nRecords = vecDecoding.size();
+            for (int i = 0; i < nThreads; i++) {
+                size_t nBegin = nRecords * i / nThreads;
+                size_t nEnd = nRecords * (i + 1) / nThreads;
+                vecFutures.emplace_back(workerPool.push([&vecDecoding, nBegin, nEnd](int) {
+                    for (size_t j = nBegin; j < nEnd; j++)
+                        DecodeRecord(vecDecoding[j]);
+                }));
             }
-            if (!strErr.empty())
-                LogPrintf("%s\n", strErr);
         }
         pcursor->close();
 
@@ -12,18 +12,24 @@
 #include "key.h"
 
 #include <list>
+#include <map>
 #include <stdint.h>
 #include <string>
 #include <utility>
 #include <vector>
 
 static const bool DEFAULT_FLUSHWALLET = true;
+//! Records read from the database per step of LoadWallet, decoded in parallel while the next step is read
+static const size_t WALLET_LOAD_BATCH_SIZE = 4096;
+//! Maximum number of threads decoding wallet records in LoadWallet
+static const int MAX_WALLET_LOAD_THREADS = 8;
 
 class CAccount;
 class CAccountingEntry;
 struct CBlockLocator;
 class CKeyPool;
 class CMasterKey;
+class COutPoint;
 class CScript;
 class CWallet;
 class CWalletTx;
@@ -103,6 +109,8 @@ public:
     bool ReadBestBlock(CBlockLocator& locator);
 
     bool WriteOrderPosNext(int64_t nOrderPosNext);
+    /// PrivateSend rounds of our outputs, valid as long as nOrderPosNext didn't change
+    bool WritePrivateSendRounds(int64_t nOrderPosNext, const std::map<COutPoint, int>& mapRounds);
 
     bool WriteDefaultKey(const CPubKey& vchPubKey);
 
@@ -26,6 +26,11 @@ bool CZMQAbstractNotifier::NotifyTransactionLock(const CTransaction &/*transacti
     return true;
 }
 
+bool CZMQAbstractNotifier::NotifyTransactionLockLatency(const CTransaction &/*transaction*/, int64_t /*nLatencyMillis*/)
+{
+    return true;
+}
+
 bool CZMQAbstractNotifier::NotifyGovernanceVote(const CGovernanceVote& /*vote*/)
 {
     return true;
@@ -13,6 +13,7 @@ static std::multimap<std::string, CZMQAbstractPublishNotifier*> mapPublishNotifi
 static const char *MSG_HASHBLOCK  = "hashblock";
 static const char *MSG_HASHTX     = "hashtx";
 static const char *MSG_HASHTXLOCK = "hashtxlock";
+static const char *MSG_TXLOCKLAT  = "txlocklatency";
 static const char *MSG_HASHGVOTE  = "hashgovernancevote";
 static const char *MSG_HASHGOBJ   = "hashgovernanceobject";
 static const char *MSG_HASHISCON  = "hashinstantsenddoublespend";
@@ -182,6 +183,18 @@ bool CZMQPublishHashTransactionLockNotifier::NotifyTransactionLock(const CTransa
     return SendMessage(MSG_HASHTXLOCK, data, 32);
 }
 
+bool CZMQPublishTransactionLockLatencyNotifier::NotifyTransactionLockLatency(const CTransaction &transaction, int64_t nLatencyMillis)
+{
+    uint256 hash = transaction.GetHash();
+    LogPrint("zmq", "zmq: Publish txlocklatency %s %d ms\n", hash.GetHex(), nLatencyMillis);
+    /* transaction hash followed by the latency in milliseconds as LE 8byte integer */
+    char data[40];
+    for (unsigned int i = 0; i < 32; i++)
+        data[31 - i] = hash.begin()[i];
+    WriteLE64((unsigned char*)&data[32], nLatencyMillis);
+    return SendMessage(MSG_TXLOCKLAT, data, 40);
+}
+
 bool CZMQPublishHashGovernanceVoteNotifier::NotifyGovernanceVote(const CGovernanceVote &vote)
 {
     uint256 hash = vote.GetHash();
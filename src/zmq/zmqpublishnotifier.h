@@ -48,6 +48,12 @@ public:
     bool NotifyTransactionLock(const CTransaction &transaction) override;
 };
 
+class CZMQPublishTransactionLockLatencyNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyTransactionLockLatency(const CTransaction &transaction, int64_t nLatencyMillis) override;
+};
+
 class CZMQPublishHashGovernanceVoteNotifier : public CZMQAbstractPublishNotifier
 {
 public: